@@ -5,6 +5,7 @@
 #include "quic/connection.hpp"
 #include "quic/connection_ids.hpp"
 #include "quic/context.hpp"
+#include "quic/coro.hpp"
 #include "quic/crypto.hpp"
 #include "quic/datagram.hpp"
 #include "quic/endpoint.hpp"
@@ -19,8 +20,11 @@
 #include "quic/messages.hpp"
 #include "quic/network.hpp"
 #include "quic/opt.hpp"
+#include "quic/pool.hpp"
+#include "quic/qlog.hpp"
 #include "quic/stream.hpp"
 #include "quic/types.hpp"
 #include "quic/udp.hpp"
 #include "quic/utils.hpp"
 #include "quic/version.hpp"
+#include "quic/worker_pool.hpp"
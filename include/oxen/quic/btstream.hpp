@@ -1,8 +1,12 @@
 #include <oxenc/bt.h>
 
+#include <array>
+#include <queue>
+
 #include "endpoint.hpp"
 #include "stream.hpp"
 #include "utils.hpp"
+#include "worker_pool.hpp"
 
 namespace oxen::quic
 {
@@ -18,6 +22,25 @@ namespace oxen::quic
     // enough to hold `MAX_REQ_LEN` followed by a `:`.
     inline constexpr size_t MAX_REQ_LEN_ENCODED = 9;  // "10000000:"
 
+    // Request bodies passed to `command` by rvalue that are at least this large are not copied into
+    // the encoded request; instead they are sent from their own buffer after the encoded header.
+    inline constexpr size_t MIN_EXTERNAL_BODY = 1024;
+
+    // Streamed request and response bodies (see `BTRequestStream::command_stream` and
+    // `message::respond_stream`) are sent as a sequence of independent frames carrying at most this
+    // much of the body each; larger chunks returned by the body producer are split across frames.
+    inline constexpr size_t MAX_STREAM_CHUNK = 256_ki;
+
+    // Number of frames of a streamed body that are queued on the stream at once: the next frame is
+    // only produced once an earlier one has been acknowledged, which bounds the memory used by a
+    // streamed body regardless of its total size.
+    inline constexpr int STREAM_FRAMES_IN_FLIGHT = 4;
+
+    // Maximum number of streamed commands being received at once on a stream (counting rejected
+    // ones, whose chunks are still being discarded).  A remote that starts another one before
+    // finishing any of these has the stream closed on it.
+    inline constexpr size_t MAX_INCOMING_STREAMED_REQS = 64;
+
     class BTRequestStream;
 
     // Exception type to throw from a handler to have a method-not-found error returned as a
@@ -30,6 +53,62 @@ namespace oxen::quic
         const char* what() const noexcept override { return "endpoint does not exist"; }
     };
 
+    /// Execution policy of a request handler registered with `BTRequestStream::register_handler`.
+    /// The default policy invokes the handler inline, on the event loop thread; handlers that can
+    /// block (database lookups, expensive signature checks, etc.) should instead be given a worker
+    /// pool so that they do not stall packet processing for every connection on the endpoint.
+    struct handler_policy
+    {
+        // If set, the handler is invoked on one of the threads of this pool.
+        std::shared_ptr<WorkerPool> pool;
+
+        // If true (and `pool` is set) then the requests of a single stream dispatched to this pool
+        // are handled one at a time, in the order they were received.  Handlers on different pools
+        // are not ordered with respect to each other.
+        bool ordered{false};
+
+        handler_policy() = default;
+        explicit handler_policy(std::shared_ptr<WorkerPool> workers, bool in_order = false) :
+                pool{std::move(workers)}, ordered{in_order}
+        {}
+    };
+
+    /// Snapshot of the call counters and handler latencies of a registered request endpoint.  The
+    /// latency of a call is measured from the dispatch of the request to its handler until the
+    /// handler returns; for handlers run on a worker pool it thus includes the time spent waiting
+    /// in the pool's queue.
+    struct endpoint_stats
+    {
+        static constexpr size_t LATENCY_BUCKETS = 24;
+
+        uint64_t calls{0};
+        // Number of calls in which the handler threw an exception
+        uint64_t errors{0};
+        std::chrono::nanoseconds total_latency{0};
+        std::chrono::nanoseconds max_latency{0};
+
+        // Power-of-two latency histogram: bucket 0 counts calls faster than 1us, and bucket i > 0
+        // counts calls that took [2^(i-1), 2^i) microseconds.  The last bucket also counts
+        // everything slower than that.
+        std::array<uint64_t, LATENCY_BUCKETS> latency_histogram{};
+
+        std::chrono::nanoseconds mean_latency() const
+        {
+            return calls ? total_latency / calls : std::chrono::nanoseconds{0};
+        }
+
+        // Returns an upper bound (at the histogram's resolution) of the latency of the given
+        // fraction (e.g. 0.99) of calls.
+        std::chrono::microseconds latency_percentile(double fraction) const;
+    };
+
+    /// Optional argument for `BTRequestStream::command` and `command_stream`: requests that a
+    /// streamed response (see `message::respond_stream`) be delivered to the response callback one
+    /// chunk at a time, as it arrives.  Without it, a streamed response is reassembled (up to
+    /// MAX_REQ_LEN) and delivered to the callback as a single, ordinary response.
+    struct chunked_response
+    {};
+
     struct message
     {
         friend class BTRequestStream;
@@ -37,11 +116,15 @@ namespace oxen::quic
 
       private:
         int64_t req_id;
-        bstring data;
+
+        // The encoded request is a view into `storage`, which is either a buffer owned solely by
+        // this message, or a receive chunk shared by all the requests that arrived whole in it.
+        std::shared_ptr<const void> storage;
+        bstring_view data;
 
         // We keep the locations of variables fields as relative positions inside `data` *rather*
-        // than using std::string_view members because the string_views are more difficult to
-        // maintain when the object gets moved or copied.
+        // than using std::string_view members so that the field accessors are trivially correct
+        // regardless of how `data` is held.
         using substr_location = std::pair<std::ptrdiff_t, std::size_t>;
         substr_location req_type{};
         substr_location ep{};
@@ -56,14 +139,39 @@ namespace oxen::quic
         //   as the connection closing.
         message(BTRequestStream& bp, bstring req, bool is_timeout = false);
 
+        // Constructs a message from a request located inside a shared buffer, which is kept alive for
+        // as long as the message (or any copy of it) exists.
+        message(BTRequestStream& bp, bstring_view req, std::shared_ptr<const void> owner);
+
+        void parse();
+
       public:
         inline static constexpr auto TYPE_REPLY = "R"sv;
         inline static constexpr auto TYPE_ERROR = "E"sv;
         inline static constexpr auto TYPE_COMMAND = "C"sv;
+        inline static constexpr auto TYPE_STREAM_COMMAND = "S"sv;
+        inline static constexpr auto TYPE_STREAM_REPLY = "P"sv;
 
         void respond(bstring_view body, bool error = false) const;
         void respond(std::string_view body, bool error = false) const { respond(convert_sv<std::byte>(body), error); }
 
+        /// Sends a streamed response: `next_chunk()` is called (on the event loop thread) to
+        /// produce successive chunks of the response body, as earlier chunks get acknowledged, until
+        /// it returns an empty container.  It can return any contiguous container of single-byte
+        /// values (std::string, bstring, std::vector<std::byte>, ...) by value.  If it throws, an
+        /// error response is sent in place of the rest of the body.
+        template <typename NextChunk>
+        void respond_stream(NextChunk next_chunk) const;
+
+        // True if this message is one chunk of a streamed command or response, in which case
+        // `body()` is just the chunk.  The last chunk of a streamed body is always empty.
+        bool is_chunk() const
+        {
+            auto t = type();
+            return t == TYPE_STREAM_COMMAND || t == TYPE_STREAM_REPLY;
+        }
+        bool is_last_chunk() const { return is_chunk() && req_body.second == 0; }
+
         const bool timed_out{false};
         bool is_error() const { return type() == TYPE_ERROR; }
 
@@ -121,11 +229,21 @@ namespace oxen::quic
     {
         // parsed request data
         int64_t req_id;
+        // The encoded, length-prefixed request.  If the body is held externally (see below) then
+        // this contains everything up to (but not including) the body data.
         std::string data;
+        // Externally owned request body, and the trailing list terminator, to be sent after `data`
+        bstring_view body;
+        shared_buffer body_keep_alive;
         std::function<void(message)> cb = nullptr;
         BTRequestStream& return_sender;
 
-        // total length of the request; is at the beginning of the request
+        // If set then the chunks of a streamed response are passed to `cb` as they arrive;
+        // otherwise they are reassembled into `partial`.
+        bool chunked{false};
+        bstring partial;
+
+        // total length of the request, including the length prefix
         size_t total_len;
 
         time_point req_time;
@@ -135,17 +253,27 @@ namespace oxen::quic
         bool is_empty() const { return data.empty() && total_len == 0; }
 
         template <typename... Opt>
-        sent_request(BTRequestStream& bp, std::string_view d, int64_t rid, Opt&&... opts) :
+        sent_request(BTRequestStream& bp, std::string encoded, int64_t rid, Opt&&... opts) :
+                sent_request{bp, std::move(encoded), bstring_view{}, shared_buffer{}, rid, std::forward<Opt>(opts)...}
+        {}
+
+        template <typename... Opt>
+        sent_request(
+                BTRequestStream& bp,
+                std::string header,
+                bstring_view ext_body,
+                shared_buffer keep_alive,
+                int64_t rid,
+                Opt&&... opts) :
                 req_id{rid},
-                data{oxenc::bt_serialize(d)},
+                data{std::move(header)},
+                body{ext_body},
+                body_keep_alive{std::move(keep_alive)},
                 return_sender{bp},
-                total_len{data.size()},
+                total_len{data.size() + (body.empty() ? 0 : body.size() + 1)},
                 req_time{get_time()},
                 expiry{req_time}
         {
-            if (total_len > MAX_REQ_LEN)
-                throw std::invalid_argument{"Request body too long!"};
-
             ((void)handle_req_opts(std::forward<Opt>(opts)), ...);
             expiry += timeout.value_or(DEFAULT_TIMEOUT);
         }
@@ -157,6 +285,7 @@ namespace oxen::quic
       private:
         void handle_req_opts(std::function<void(message)> func) { cb = std::move(func); }
         void handle_req_opts(std::chrono::milliseconds exp) { timeout = exp; }
+        void handle_req_opts(chunked_response) { chunked = true; }
 
         template <typename Opt>
         void handle_req_opts(std::optional<Opt> option)
@@ -171,13 +300,58 @@ namespace oxen::quic
         friend class TestHelper;
 
       private:
-        // outgoing requests awaiting response
+        // outgoing requests awaiting response, keyed by request id
         // We use shared_ptr's so we can lambda capture it, though it is not actually shared
-        std::deque<std::shared_ptr<sent_request>> sent_reqs;
+        std::unordered_map<int64_t, std::shared_ptr<sent_request>> sent_reqs;
 
-        std::unordered_map<std::string, std::function<void(message)>> func_map;
+        // Min-heap of [expiry, rid] of the requests in `sent_reqs`.  Entries are not removed when a
+        // request is answered; instead entries whose rid is no longer in `sent_reqs` are discarded
+        // when they reach the top (or when the heap is compacted).
+        using expiry_entry = std::pair<time_point, int64_t>;
+        std::priority_queue<expiry_entry, std::vector<expiry_entry>, std::greater<>> sent_expiries;
+
+        // Live, thread-safe counterpart of `endpoint_stats`, updated after every call of a handler
+        struct endpoint_counters
+        {
+            std::atomic<uint64_t> calls{0};
+            std::atomic<uint64_t> errors{0};
+            std::atomic<int64_t> total_latency_ns{0};
+            std::atomic<int64_t> max_latency_ns{0};
+            std::array<std::atomic<uint64_t>, endpoint_stats::LATENCY_BUCKETS> latency_histogram{};
+
+            void record(std::chrono::nanoseconds latency, bool error);
+            endpoint_stats snapshot() const;
+        };
+
+        struct registered_handler
+        {
+            std::function<void(message)> func;
+            handler_policy policy;
+            // Accepts streamed commands (see `register_stream_handler`)
+            bool streamed{false};
+            // Shared with the handler's worker pool jobs, and retained if the handler is replaced
+            std::shared_ptr<endpoint_counters> counters = std::make_shared<endpoint_counters>();
+        };
+
+        std::unordered_map<std::string, registered_handler, string_hash, std::equal_to<>> func_map;
         std::function<void(message)> generic_handler;
 
+        // Streamed commands currently being received, keyed by request id; the value is false for
+        // rejected streams, the remaining chunks of which are discarded.  Holds at most
+        // MAX_INCOMING_STREAMED_REQS entries.
+        std::unordered_map<int64_t, bool> incoming_streams;
+
+        // Used to serialize the `ordered` pool-dispatched handlers of this stream, one queue per
+        // pool (as a serial_queue drains on a single pool); created on first use.  A queue left
+        // behind by a destroyed pool is idle, so reusing it for a new pool at the same address is
+        // harmless.
+        std::vector<std::pair<WorkerPool*, std::shared_ptr<serial_queue>>> handler_queues;
+
+        // Responses produced off the event loop (i.e. by pool-dispatched handlers) waiting to be
+        // sent; they are all flushed by a single event loop job.
+        std::mutex queued_responses_mutex;
+        std::vector<std::string> queued_responses;
+
         bstring buf;
         std::string size_buf;
 
@@ -219,15 +393,7 @@ namespace oxen::quic
         void command(std::string ep, bstring_view body, Opt&&... opts)
         {
             auto rid = next_rid++;
-            auto req = std::make_shared<sent_request>(*this, encode_command(ep, rid, body), rid, std::forward<Opt>(opts)...);
-
-            if (req->cb)
-                endpoint.call([this, r = std::move(req)]() mutable {
-                    if (auto* req = add_sent_request(std::move(r)))
-                        send(std::move(req->data));
-                });
-            else
-                send(std::move(*req).data);
+            dispatch(std::make_shared<sent_request>(*this, encode_command(ep, rid, body), rid, std::forward<Opt>(opts)...));
         }
         // Same as above, but takes a regular string_view
         template <typename... Opt>
@@ -235,12 +401,94 @@ namespace oxen::quic
         {
             command(std::move(ep), convert_sv<std::byte>(body), std::forward<Opt>(opts)...);
         }
+        // Same as above, but takes ownership of the body.  Large bodies are not copied into the
+        // encoded request, but rather are sent directly from the given string once the encoded
+        // request header has been sent.
+        template <oxenc::basic_char Char, typename... Opt>
+        void command(std::string ep, std::basic_string<Char>&& body, Opt&&... opts)
+        {
+            if (body.size() < MIN_EXTERNAL_BODY)
+                return command(
+                        std::move(ep),
+                        convert_sv<std::byte>(std::basic_string_view<Char>{body}),
+                        std::forward<Opt>(opts)...);
+
+            auto rid = next_rid++;
+            auto owned = shared_buffer::make<std::basic_string<Char>>(buffer_pool(), std::move(body));
+            auto view = owned.view();
+            dispatch(std::make_shared<sent_request>(
+                    *this, encode_command(ep, rid, view, false), view, std::move(owned), rid, std::forward<Opt>(opts)...));
+        }
+
+        /** API: ::command_async
+
+            Coroutine counterpart of `command` for requests: `co_await s->command_async(ep, body)`
+            sends the request and evaluates to the response (or timeout) message, resuming the
+            coroutine on the event loop without blocking any thread.  Takes the same optional
+            arguments as `command`, other than the callback.  The body is taken by value (so
+            passing an rvalue string avoids a copy), and is sent when the awaitable is awaited.
+        */
+        template <typename Body, typename... Opt>
+        auto command_async(std::string ep, Body&& body, Opt&&... opts)
+        {
+            return make_callback_awaitable<message>(
+                    [this, ep = std::move(ep), body = std::forward<Body>(body), ... opts = std::forward<Opt>(opts)](
+                            std::function<void(message)> done) mutable {
+                        command(std::move(ep), std::move(body), std::move(done), std::move(opts)...);
+                    });
+        }
 
+        /// Sends a response to the request `rid`.  This may be called from any thread; responses
+        /// sent from outside the event loop are batched together and handed to the event loop in
+        /// a single job.
         void respond(int64_t rid, bstring_view body, bool error = false);
 
+        /** API: ::command_stream
+
+            Invokes a remote RPC endpoint with a streamed body, which is not subject to MAX_REQ_LEN
+            and is never held in memory as a whole on either side.  `next_chunk()` is called on the
+            event loop thread to produce successive chunks of the body, as earlier chunks get
+            acknowledged, until it returns an empty container; it can return any contiguous
+            container of single-byte values by value.  If it throws, the stream is closed.
+
+            The remote endpoint must have been set up with `register_stream_handler`.  Takes the
+            same optional arguments as `command`, plus `chunked_response`.
+        */
+        template <typename NextChunk, typename... Opt>
+        void command_stream(std::string ep, NextChunk next_chunk, Opt&&... opts)
+        {
+            auto rid = next_rid++;
+            auto req = std::make_shared<sent_request>(*this, std::string{}, rid, std::forward<Opt>(opts)...);
+            endpoint.call([this, rid, ep = std::move(ep), req = std::move(req), next = std::move(next_chunk)]() mutable {
+                if (req->cb ? !add_sent_request(std::move(req)) : is_closing())
+                    return;
+                send_stream(message::TYPE_STREAM_COMMAND, rid, std::move(ep), std::move(next));
+            });
+        }
+
+        // Sends a streamed response to the request `rid`; see `message::respond_stream`.  This may
+        // be called from any thread.
+        template <typename NextChunk>
+        void respond_stream(int64_t rid, NextChunk next_chunk)
+        {
+            endpoint.call([this, rid, next = std::move(next_chunk)]() mutable {
+                send_stream(message::TYPE_STREAM_REPLY, rid, std::nullopt, std::move(next));
+            });
+        }
+
         /// Registers an individual endpoint to be recognized by this BTRequestStream object.  Can be
         /// called multiple times to set up multiple commands.  See also register_generic_handler.
-        void register_handler(std::string endpoint, std::function<void(message)>);
+        ///
+        /// The optional `policy` selects where the handler runs: by default it is invoked inline on
+        /// the event loop thread; see `handler_policy` for dispatching it to a worker pool instead.
+        void register_handler(std::string endpoint, std::function<void(message)>, handler_policy policy = {});
+
+        /// Registers an endpoint that accepts streamed commands (see `command_stream`).  The
+        /// handler is invoked once for each chunk of the body as it arrives (see
+        /// `message::is_chunk`), ending with an empty last chunk; chunks of the same request are
+        /// always handled in order, even on a worker pool.  It is also invoked, once, for
+        /// ordinary commands sent to the endpoint.  The handler can respond at any time.
+        void register_stream_handler(std::string endpoint, std::function<void(message)>, handler_policy policy = {});
 
         /// Registered (or replaces) the generic handler that is invoked if the requested endpoint
         /// does not match any endpoint set up with `register_handler`.  If no individual
@@ -249,6 +497,14 @@ namespace oxen::quic
         /// exception if the endpoint in this message should be considered not found.
         void register_generic_handler(std::function<void(message)> request_handler);
 
+        /// Returns a snapshot of the call statistics of every endpoint set up with
+        /// `register_handler`, keyed by endpoint name.
+        std::unordered_map<std::string, endpoint_stats> handler_stats() const;
+
+        /// Returns a snapshot of the call statistics of a single endpoint, or nullopt if there is no
+        /// handler registered for it.
+        std::optional<endpoint_stats> handler_stats(std::string_view endpoint) const;
+
         size_t num_pending() const;
 
       protected:
@@ -269,16 +525,113 @@ namespace oxen::quic
 
         void handle_input(message msg);
 
-        void process_incoming(std::string_view req);
+        // Invokes a request handler, responding with an error if it throws.  Called on the event
+        // loop for inline handlers, and on a worker thread for pool-dispatched handlers.  Returns
+        // false if the handler threw.
+        bool invoke_handler(const std::function<void(message)>& func, message msg);
+
+        // Runs a registered handler inline, or hands it to the worker pool of its policy
+        void run_handler(const registered_handler& handler, message msg, bool ordered = false);
+
+        // Hands a request to the worker pool of its handler's policy
+        void dispatch_handler(const registered_handler& handler, message msg, bool ordered);
+
+        void handle_command_chunk(message msg);
+        void handle_response_chunk(message msg);
+
+        // Calls the response callback of a request that is complete (successfully or not)
+        void complete_request(std::shared_ptr<sent_request> req, message msg);
+
+        // Sends the chunks produced by `next_chunk` as a sequence of `type` frames for request
+        // `rid`, terminated by an empty frame.  Must be called from the event loop.
+        template <typename NextChunk>
+        void send_stream(std::string_view type, int64_t rid, std::optional<std::string> ep, NextChunk next_chunk)
+        {
+            using Container = std::remove_cvref_t<decltype(next_chunk())>;
+            static_assert(sizeof(*std::declval<Container>().data()) == 1, "streamed bodies require bytes data");
+
+            struct producer
+            {
+                NextChunk next;
+                Container current{};
+                size_t offset{0};
+                std::optional<std::string> error;
+
+                bstring_view remaining() const
+                {
+                    return bstring_view{reinterpret_cast<const std::byte*>(current.data()), current.size()}.substr(
+                            offset);
+                }
+            };
+            auto p = std::make_shared<producer>(producer{std::move(next_chunk)});
+
+            send_chunks(
+                    [this, type, rid, ep, p](const Stream&) -> std::string {
+                        try
+                        {
+                            if (p->remaining().empty())
+                            {
+                                p->current = p->next();
+                                p->offset = 0;
+                                if (p->remaining().empty())
+                                    return {};
+                            }
+                            auto chunk = p->remaining().substr(0, MAX_STREAM_CHUNK);
+                            p->offset += chunk.size();
+                            return encode_stream_frame(type, rid, ep, chunk);
+                        }
+                        catch (const std::exception& e)
+                        {
+                            p->error = e.what();
+                            return {};
+                        }
+                    },
+                    [this, type, rid, ep, p](Stream&) { finish_stream(type, rid, ep, std::move(p->error)); },
+                    STREAM_FRAMES_IN_FLIGHT);
+        }
+
+        std::string encode_stream_frame(
+                std::string_view type, int64_t rid, const std::optional<std::string>& ep, bstring_view chunk);
 
-        std::string encode_command(std::string_view endpoint, int64_t rid, bstring_view body);
+        // Sends the terminating frame of a streamed body, or handles the failure of its producer
+        void finish_stream(
+                std::string_view type, int64_t rid, const std::optional<std::string>& ep, std::optional<std::string> error);
+
+        // Sends the responses queued by `respond` from outside the event loop
+        void flush_responses();
+
+        void process_incoming(bstring_view req);
+
+        // Encodes a command into a single, length-prefixed buffer.  If `include_body` is false then
+        // the returned buffer ends just before the body data: the body itself and the list
+        // terminator must be sent immediately after it (see `send_request`).
+        std::string encode_command(std::string_view endpoint, int64_t rid, bstring_view body, bool include_body = true);
 
         std::string encode_response(int64_t rid, bstring_view body, bool error);
 
         sent_request* add_sent_request(std::shared_ptr<sent_request> req);
 
+        // Rebuilds `sent_expiries` without the stale entries of already-answered requests
+        void compact_expiries();
+
+        // Queues a newly encoded request for sending (and, if expecting a response, tracking)
+        void dispatch(std::shared_ptr<sent_request> req);
+
+        // Sends the encoded request, followed by the external body, if any.  Must be called from
+        // the event loop so that the parts are not interleaved with other writes to the stream.
+        void send_request(sent_request& req);
+
         size_t parse_length(std::string_view req);
 
         size_t num_pending_impl() const { return user_buffers.size(); }
     };
+
+    template <typename NextChunk>
+    void message::respond_stream(NextChunk next_chunk) const
+    {
+        if (auto ptr = return_sender.lock())
+            ptr->respond_stream(req_id, std::move(next_chunk));
+        else
+            throw std::runtime_error{"Cannot access expired pointer to BT stream!"};
+    }
 }  // namespace oxen::quic
@@ -21,9 +21,13 @@ namespace oxen::quic
 {
     struct dgram_interface;
     class Network;
+    class QlogWriter;
 
     inline constexpr uint64_t MAX_ACTIVE_CIDS{8};
     inline constexpr size_t NGTCP2_RETRY_SCIDLEN{18};
+    // Maximum number of incoming packets held while a deferred key_verify call is running; further
+    // packets are dropped (and retransmitted by the peer)
+    inline constexpr size_t MAX_HELD_PACKETS{64};
 
     template <typename T>
     concept StreamDerived = std::derived_from<T, Stream>;
@@ -129,20 +133,32 @@ namespace oxen::quic
         template <oxenc::basic_char Char>
         void send_datagram(std::vector<Char>&& buf)
         {
-            auto keep_alive = std::make_shared<std::vector<Char>>(std::move(buf));
-            std::basic_string_view<Char> view{keep_alive->data(), keep_alive->size()};
-            send_datagram(view, std::move(keep_alive));
+            send_datagram(shared_buffer::make<std::vector<Char>>(buffer_pool(), std::move(buf)));
         }
 
         template <oxenc::basic_char CharType>
         void send_datagram(std::basic_string<CharType>&& data)
         {
-            auto keep_alive = std::make_shared<std::basic_string<CharType>>(std::move(data));
-            std::basic_string_view<CharType> view{*keep_alive};
-            send_datagram(view, std::move(keep_alive));
+            send_datagram(shared_buffer::make<std::basic_string<CharType>>(buffer_pool(), std::move(data)));
         }
 
-        virtual void send_datagram(bstring_view data, std::shared_ptr<void> keep_alive = nullptr) = 0;
+        void send_datagram(bstring_view data, std::shared_ptr<void> keep_alive = nullptr)
+        {
+            send_datagram(data, shared_buffer::wrap(std::move(keep_alive)));
+        }
+
+        // Sends the data owned by `buf`
+        void send_datagram(shared_buffer buf)
+        {
+            auto data = buf.view();
+            send_datagram(data, std::move(buf));
+        }
+
+        // Sends `data`, which must be kept alive by `keep_alive`
+        virtual void send_datagram(bstring_view data, shared_buffer keep_alive) = 0;
+
+        // The memory pool of the connection's event loop, for allocating shared_buffers
+        virtual const std::shared_ptr<memory_pool>& buffer_pool() const = 0;
 
         virtual Endpoint& endpoint() = 0;
         virtual const Endpoint& endpoint() const = 0;
@@ -151,8 +167,17 @@ namespace oxen::quic
 
         virtual bool datagrams_enabled() const = 0;
         virtual bool packet_splitting_enabled() const = 0;
+        // Returns the datagram FEC group size configured via opt::datagram_fec, or 0 if FEC is off
+        virtual int datagram_fec_group_size() const = 0;
         virtual const ConnectionID& reference_id() const = 0;
         virtual bool is_validated() const = 0;
+        // True if the TLS session was resumed from a ticket issued on an earlier connection
+        virtual bool is_resumed() const = 0;
+        // True if stream data sent by the client before handshake completion (0-RTT) was accepted.
+        // Clients attempt 0-RTT whenever they hold a ticket from an earlier connection to the same
+        // remote pubkey; if the server rejects it, the data is resent (on streams with new IDs) once
+        // the handshake completes.
+        virtual bool early_data_accepted() const = 0;
         virtual Direction direction() const = 0;
         virtual ustring_view remote_key() const = 0;
         virtual bool is_inbound() const = 0;
@@ -241,6 +266,7 @@ namespace oxen::quic
     {
         friend class TestHelper;
         friend struct rotating_buffer;
+        friend struct Callbacks;
 
       public:
         // Non-movable/non-copyable; you must always hold a Connection in a shared_ptr
@@ -316,13 +342,18 @@ namespace oxen::quic
 
         bool datagrams_enabled() const override { return _datagrams_enabled; }
         bool packet_splitting_enabled() const override { return _packet_splitting; }
+        int datagram_fec_group_size() const override { return _fec_group_size; }
+        std::chrono::milliseconds datagram_fec_flush_timeout() const { return _fec_flush_timeout; }
 
         std::optional<size_t> max_datagram_size_changed() override;
 
         // public debug functions; to be removed with friend test fixture class
         int last_cleared() const override;
 
-        void send_datagram(bstring_view data, std::shared_ptr<void> keep_alive = nullptr) override;
+        using connection_interface::send_datagram;
+        void send_datagram(bstring_view data, shared_buffer keep_alive) override;
+
+        const std::shared_ptr<memory_pool>& buffer_pool() const override;
 
         void close_connection(uint64_t error_code = 0) override;
 
@@ -331,6 +362,16 @@ namespace oxen::quic
 
         bool is_validated() const override { return _is_validated; }
 
+        bool is_resumed() const override { return _is_resumed; }
+
+        bool early_data_accepted() const override { return _early_data_accepted; }
+
+        // True while the server waits for a key_verify call deferred to a worker pool
+        bool key_verify_pending() const { return _key_verify_pending; }
+
+        // Called from the gnutls code when the server sends a session ticket (client only)
+        void store_session_ticket(ustring_view ticket);
+
         // These are public so we can access them from the ngtcp free floating functions
         // (on_handshake_completed and on_handshake_confirmed) and when the connection is closed
         connection_established_callback conn_established_cb;
@@ -399,19 +440,34 @@ namespace oxen::quic
         const uint64_t _max_streams{DEFAULT_MAX_BIDI_STREAMS};
         const bool _datagrams_enabled{false};
         const bool _packet_splitting{false};
+        const int _fec_group_size{0};
+        const std::chrono::milliseconds _fec_flush_timeout{0};
         size_t _last_max_dgram_size{0};
         std::atomic<bool> _max_dgram_size_changed{true};
 
         std::atomic<bool> _close_quietly{false};
         std::atomic<bool> _is_validated{false};
+        std::atomic<bool> _is_resumed{false};
+        std::atomic<bool> _early_data_accepted{false};
+        bool _early_data_attempted{false};
 
         ustring remote_pubkey;
 
+        // Client only: identifies the session tickets and 0-RTT transport parameters this
+        // connection may use and store: the local and remote pubkeys and the offered ALPNs, so that
+        // connections made with different creds or ALPNs don't resume each other's sessions.
+        ustring resumption_id;
+
         struct connection_deleter
         {
             inline void operator()(ngtcp2_conn* c) const { ngtcp2_conn_del(c); }
         };
 
+        // qlog trace output (see opt::qlog); declared before `conn` so that it is still around for
+        // the final trace write made when the ngtcp2 connection is deleted
+        std::shared_ptr<QlogWriter> qlog_writer;
+        uint64_t qlog_id{0};
+
         // underlying ngtcp2 connection object
         std::unique_ptr<ngtcp2_conn, connection_deleter> conn;
 
@@ -420,19 +476,27 @@ namespace oxen::quic
 
         event_ptr packet_retransmit_timer;
         event_ptr packet_io_trigger;
+        // When the retransmit timer is due to fire; only tracked while loop statistics are enabled
+        std::optional<std::chrono::steady_clock::time_point> packet_retransmit_due;
 
         void on_packet_io_ready();
+        void on_packet_io_ready(std::chrono::steady_clock::time_point now);
 
         struct pkt_tx_timer_updater;
         bool send(pkt_tx_timer_updater* pkt_updater = nullptr);
 
         void flush_packets(std::chrono::steady_clock::time_point tp);
 
-        std::array<std::byte, MAX_PMTUD_UDP_PAYLOAD * DATAGRAM_BATCH_SIZE> send_buffer;
+        // Allocated on first use (and released again by slim_if_idle), as it is by far the largest
+        // part of an idle connection.
+        std::unique_ptr<std::byte[]> send_buffer;
         std::array<size_t, DATAGRAM_BATCH_SIZE> send_buffer_size;
         uint8_t send_ecn = 0;
         size_t n_packets = 0;
 
+        // Timestamp (as in get_timestamp()) of the last packet read or sent
+        std::chrono::nanoseconds last_io{get_timestamp()};
+
         void schedule_packet_retransmit(std::chrono::steady_clock::time_point ts);
 
         bool draining = false;
@@ -474,6 +538,49 @@ namespace oxen::quic
 
         io_result read_packet(const Packet& pkt);
 
+        // Records whether the session was resumed and any early data accepted, and (for resumed
+        // sessions, where GnuTLS skips certificate verification) re-validates the remote key from
+        // the resumed session.  Returns false if the connection must be rejected.
+        bool handshake_resumption_state();
+
+        // Server only: set while the key_verify callback runs on the creds' worker pool (see
+        // GNUTLSCreds::set_key_verify_pool), during which incoming packets are held rather than
+        // processed (and the stream events of packets already being read are held in
+        // held_stream_events).
+        bool _key_verify_pending{false};
+        std::vector<Packet> held_packets;
+
+        // Server only: stream events from the client that arrive before its key has been verified
+        // (0-RTT stream data, and stream data arriving while the key_verify callback runs on a
+        // worker pool, including data read along with the handshake packet that started it) are
+        // held here, and only delivered to the application once the key has been accepted.  Their
+        // amount is bounded by the initial stream flow control limits, which aren't extended for
+        // held data until it is delivered.
+        struct held_stream_event
+        {
+            enum class type : uint8_t { OPEN, DATA, CLOSE };
+
+            type kind;
+            int64_t id;
+            bstring data{};
+            bool fin{false};
+            uint64_t app_code{0};
+        };
+        std::vector<held_stream_event> held_stream_events;
+
+        bool holding_stream_events() const { return is_inbound() && !_is_validated; }
+
+        // Delivers the held stream events; called once the connection is validated and reported as
+        // established.
+        void release_held_stream_events();
+
+        // Submits the deferred key_verify call to the worker pool
+        void start_deferred_key_verify();
+
+        // Called on the event loop with the deferred key_verify verdict: reports the connection as
+        // established and processes the held packets, or closes the connection.
+        void finish_deferred_key_verify(bool accepted);
+
         std::shared_ptr<dgram_interface> di;
 
         /********* TEST SUITE FUNCTIONALITY *********/
@@ -494,6 +601,7 @@ namespace oxen::quic
         void close_all_streams();
         void check_pending_streams(uint64_t available);
         int recv_datagram(bstring_view data, bool fin);
+        int deliver_datagram(bstring data);
         int ack_datagram(uint64_t dgram_id);
         int recv_token(const uint8_t* token, size_t tokenlen);
 
@@ -519,6 +627,18 @@ namespace oxen::quic
         // externally.
         void check_stream_timeouts();
 
+        // Called (from Endpoint, with opt::idle_slimming) to release this connection's send and
+        // datagram reassembly buffers if it hasn't sent or received anything for `idle`.
+        void slim_if_idle(std::chrono::nanoseconds now, std::chrono::nanoseconds idle);
+
+        // Set while a flush of this connection is deferred to the end of the endpoint's current
+        // receive batch (see Endpoint::defer_flush).
+        bool rx_flush_pending{false};
+
+        // Called (from Endpoint) at the end of a receive batch to perform the deferred flush.
+        // Returns false if the connection is closing (or draining), and so wasn't flushed.
+        bool flush_deferred(std::chrono::steady_clock::time_point now);
+
         ~Connection() override;
     };
 
@@ -29,6 +29,10 @@ namespace oxen::quic
         bool split_packet{false};
         // splitting policy
         Splitting policy{Splitting::NONE};
+        // datagram FEC group size; 0 means disabled
+        int fec_group_size{0};
+        // how long a partial FEC group may stay open before its parity is sent; 0 means never
+        std::chrono::milliseconds fec_flush_timeout{0};
 
         user_config() = default;
     };
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace oxen::quic
+{
+    /// Coroutine return type for fire-and-forget coroutines, e.g.:
+    ///
+    ///     detached_task fetch_all(std::shared_ptr<BTRequestStream> s)
+    ///     {
+    ///         auto a = co_await s->command_async("a", ""sv);
+    ///         auto b = co_await s->command_async("b", a.body());
+    ///         ...
+    ///     }
+    ///
+    /// The coroutine starts running immediately, in the calling thread, and its frame is freed once
+    /// it finishes.  After a `co_await` on one of the libquic awaitables the coroutine continues on
+    /// the event loop thread, so it must not block.  As with a thread function, an exception
+    /// escaping the coroutine terminates the program.
+    struct detached_task
+    {
+        struct promise_type
+        {
+            detached_task get_return_object() noexcept { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() noexcept {}
+            void unhandled_exception() noexcept { std::terminate(); }
+        };
+    };
+
+    namespace detail
+    {
+        // Holds the value (or exception) produced by an awaited operation until the awaiting
+        // coroutine resumes and collects it.
+        template <typename T>
+        struct await_result
+        {
+            std::optional<T> value;
+            std::exception_ptr error;
+
+            void set(T v) { value.emplace(std::move(v)); }
+
+            template <typename Callable>
+            void run(Callable& f)
+            {
+                try
+                {
+                    value.emplace(f());
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+            }
+
+            T get()
+            {
+                if (error)
+                    std::rethrow_exception(error);
+                return std::move(*value);
+            }
+        };
+
+        template <>
+        struct await_result<void>
+        {
+            std::exception_ptr error;
+
+            template <typename Callable>
+            void run(Callable& f)
+            {
+                try
+                {
+                    f();
+                }
+                catch (...)
+                {
+                    error = std::current_exception();
+                }
+            }
+
+            void get()
+            {
+                if (error)
+                    std::rethrow_exception(error);
+            }
+        };
+    }  // namespace detail
+
+    /// Awaitable returned by `Loop::call_async` (and the Network/Endpoint equivalents): invokes `f`
+    /// on the event loop, then resumes the awaiting coroutine on the event loop with its result (or
+    /// exception).  If awaited from the event loop thread then `f` is invoked immediately without
+    /// suspending.
+    template <typename Executor, typename Callable>
+    struct loop_call_awaitable
+    {
+        using result_type = std::invoke_result_t<Callable&>;
+
+        Executor& loop;
+        Callable f;
+        detail::await_result<result_type> result{};
+
+        bool await_ready()
+        {
+            if (!loop.in_event_loop())
+                return false;
+            result.run(f);
+            return true;
+        }
+
+        void await_suspend(std::coroutine_handle<> h)
+        {
+            loop.call_soon([this, h] {
+                result.run(f);
+                h.resume();
+            });
+        }
+
+        result_type await_resume() { return result.get(); }
+    };
+
+    namespace detail
+    {
+        // Marks the coroutine (if any) whose callback_awaitable is currently starting its operation
+        // on this thread, so that a completion callback invoked before the operation's `start`
+        // returns can tell that it doesn't need to (and mustn't) resume the coroutine itself.
+        struct inline_completion
+        {
+            std::coroutine_handle<> h;
+            bool completed = false;
+
+            static inline thread_local inline_completion* current = nullptr;
+
+            // Returns true (and flags the completion) if called from within `h`'s `start`
+            static bool claim(std::coroutine_handle<> h)
+            {
+                if (!current || current->h != h)
+                    return false;
+                current->completed = true;
+                return true;
+            }
+        };
+    }  // namespace detail
+
+    /// Awaitable adapter for callback-based operations: when awaited, `start` is invoked with a
+    /// one-shot completion callback, and the coroutine is resumed (in whichever thread invokes the
+    /// callback -- for libquic operations, the event loop) with the value passed to it.  If the
+    /// callback is invoked from within `start` then the coroutine simply continues without
+    /// suspending, so that awaiting operations that often complete immediately (such as
+    /// `Stream::writable()`) in a loop doesn't grow the stack.
+    template <typename T, typename Start>
+    struct callback_awaitable
+    {
+        Start start;
+        detail::await_result<T> result{};
+
+        bool await_ready() const noexcept { return false; }
+
+        bool await_suspend(std::coroutine_handle<> h)
+        {
+            // NB: the callback may be invoked from another thread (resuming, and possibly
+            // destroying, the coroutine) before `start` returns, so nothing may touch `this` after
+            // it; whether it completed inline is tracked on our own stack instead.
+            detail::inline_completion self{h};
+            auto* prev = std::exchange(detail::inline_completion::current, &self);
+            try
+            {
+                if constexpr (std::is_void_v<T>)
+                    start([h] {
+                        if (!detail::inline_completion::claim(h))
+                            h.resume();
+                    });
+                else
+                    start([this, h](T v) {
+                        result.set(std::move(v));
+                        if (!detail::inline_completion::claim(h))
+                            h.resume();
+                    });
+            }
+            catch (...)
+            {
+                detail::inline_completion::current = prev;
+                throw;
+            }
+            detail::inline_completion::current = prev;
+            return !self.completed;
+        }
+
+        T await_resume() { return result.get(); }
+    };
+
+    template <typename T, typename Start>
+    callback_awaitable<T, std::decay_t<Start>> make_callback_awaitable(Start&& start)
+    {
+        return {std::forward<Start>(start)};
+    }
+}  // namespace oxen::quic
@@ -34,6 +34,14 @@ namespace oxen::quic
         virtual void* get_anti_replay() const = 0;
         virtual const void* get_session_ticket_key() const = 0;
         virtual bool get_early_data_accepted() const = 0;
+        virtual bool is_resumed() const = 0;
+        // Whether the creds the session was made from allow session resumption, and 0-RTT early
+        // data on resumed sessions
+        virtual bool resumption_enabled() const = 0;
+        virtual bool early_data_enabled() const = 0;
+        // Client only: resume the session described by a ticket from an earlier connection; must be
+        // called before the handshake starts.
+        virtual bool set_resumption_ticket(ustring_view ticket) = 0;
         virtual ustring_view selected_alpn() = 0;
         virtual ustring_view remote_key() const = 0;
         virtual void set_expected_remote_key(ustring key) = 0;
@@ -36,24 +36,28 @@ namespace oxen::quic
         template <oxenc::basic_char Char>
         void send_datagram(std::vector<Char>&& buf)
         {
-            reply(std::basic_string_view<Char>{buf.data(), buf.size()}, std::make_shared<std::vector<Char>>(std::move(buf)));
+            reply(shared_buffer::make<std::vector<Char>>(buffer_pool(), std::move(buf)));
         }
 
         template <oxenc::basic_char CharType>
         void reply(std::basic_string<CharType>&& data)
         {
-            auto keep_alive = std::make_shared<std::basic_string<CharType>>(std::move(data));
-            std::basic_string_view<CharType> view{*keep_alive};
-            reply(view, std::move(keep_alive));
+            reply(shared_buffer::make<std::basic_string<CharType>>(buffer_pool(), std::move(data)));
         }
 
         void reply(bstring_view data, std::shared_ptr<void> keep_alive = nullptr);
+
+        // Sends the data owned by `buf`
+        void reply(shared_buffer buf);
+
+        // The memory pool of the connection's event loop, for allocating shared_buffers
+        const std::shared_ptr<memory_pool>& buffer_pool() const;
     };
 
     // IO callbacks
     using dgram_data_callback = std::function<void(dgram_interface&, bstring)>;
 
-    using dgram_buffer = std::deque<std::pair<uint16_t, std::pair<bstring_view, std::shared_ptr<void>>>>;
+    using dgram_buffer = std::deque<std::pair<uint16_t, std::pair<bstring_view, shared_buffer>>>;
 
     class DatagramIO : public IOChannel
     {
@@ -141,6 +145,12 @@ namespace oxen::quic
         // dgram_buffer send_buffer;
         buffer_que send_buffer;
 
+        /// Forward error correction state; only engaged when the endpoint was configured with
+        /// opt::datagram_fec. FEC framing is applied to the whole datagram before any packet splitting
+        /// on the sending side, and reversed after split datagrams are rejoined on the receiving side.
+        std::optional<fec_encoder> fec_tx;
+        std::optional<fec_decoder> fec_rx;
+
         prepared_datagram pending_datagram(bool r) override;
 
         bool is_stream() const override { return false; }
@@ -156,10 +166,22 @@ namespace oxen::quic
       private:
         const bool _packet_splitting{false};
 
+        // Fires opt::datagram_fec's flush timeout for the FEC group `fec_flush_group`, closing it
+        // early if it is still the (partial) current group
+        event_ptr fec_flush_timer;
+        uint16_t fec_flush_group{0};
+
+        // Assigns a datagram ID to `data` and queues it for sending, splitting it if required
+        void queue_datagram(bstring_view data, shared_buffer keep_alive, size_t max_size);
+
+        void queue_fec_parity(bstring parity, size_t wire_max);
+
+        void flush_fec_group();
+
       protected:
         bool is_empty_impl() const override { return send_buffer.empty(); }
 
-        void send_impl(bstring_view data, std::shared_ptr<void> keep_alive) override;
+        void send_impl(bstring_view data, shared_buffer keep_alive) override;
 
         bool is_closing_impl() const override;
         bool sent_fin() const override;
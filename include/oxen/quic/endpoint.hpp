@@ -25,10 +25,12 @@ extern "C"
 #include <random>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "connection.hpp"
 #include "context.hpp"
 #include "network.hpp"
+#include "qlog.hpp"
 #include "udp.hpp"
 #include "utils.hpp"
 
@@ -42,6 +44,21 @@ namespace oxen::quic
                 "Endpoint listen/connect require exactly one std::shared_ptr<TLSCreds> argument");
     }
 
+    // Counters for the inbound admission control configured via opt::admission_control
+    struct admission_stats
+    {
+        // Inbound connections accepted
+        uint64_t accepted{0};
+        // Initials answered with a Retry because the retry threshold was reached
+        uint64_t retried{0};
+        // Initials dropped because the maximum number of half-open connections was reached
+        uint64_t rejected_half_open{0};
+        // Initials dropped by their source prefix's rate limit
+        uint64_t rejected_rate_limited{0};
+        // Inbound connections currently mid-handshake
+        size_t half_open{0};
+    };
+
     class Endpoint : public std::enable_shared_from_this<Endpoint>
     {
       public:
@@ -158,6 +175,8 @@ namespace oxen::quic
 
         Splitting splitting_policy() const { return _policy; }
 
+        int datagram_fec_group_size() const { return _fec_group_size; }
+
         void close_connection(Connection& conn, io_error ec = io_error{0}, std::optional<std::string> msg = std::nullopt);
 
         void close_conns(std::optional<Direction> d = std::nullopt);
@@ -176,6 +195,14 @@ namespace oxen::quic
             return net.call_get(std::forward<Args>(args)...);
         }
 
+        template <typename... Args>
+        auto call_async(Args&&... args)
+        {
+            return net.call_async(std::forward<Args>(args)...);
+        }
+
+        auto resume_on_loop() { return net.resume_on_loop(); }
+
         template <typename... Args>
         void call_soon(Args&&... args)
         {
@@ -193,6 +220,9 @@ namespace oxen::quic
             return net.make_shared<T>(std::forward<Args>(args)...);
         }
 
+        // The memory pool of the network's event loop
+        const std::shared_ptr<memory_pool>& pool() const { return net.pool(); }
+
         bool in_event_loop() const;
 
         // Returns a random value suitable for use as the Endpoint static secret value.
@@ -200,6 +230,13 @@ namespace oxen::quic
 
         void manually_receive_packet(Packet&& pkt);
 
+        // For endpoints using opt::manual_routing with a batched send hook: tells the endpoint that
+        // the application's transport can take packets again after the hook reported being blocked,
+        // so that the held-back packets are re-offered.
+        void manually_signal_writeable();
+
+        admission_stats get_admission_stats();
+
       private:
         friend class Network;
         friend class Loop;
@@ -216,9 +253,23 @@ namespace oxen::quic
         bool _packet_splitting{false};
         Splitting _policy{Splitting::NONE};
         int _rbufsize{4096};
+        int _fec_group_size{0};
+        std::chrono::milliseconds _fec_flush_timeout{0};
+        std::optional<std::chrono::nanoseconds> _idle_slimming;
+
+        // While a batch of packets received on the socket is being processed: the time the batch
+        // was received, used as the timestamp for all of its packets, and the connections that
+        // received packets, which get flushed once at the end of the batch.
+        std::optional<std::chrono::steady_clock::time_point> _rx_batch_time;
+        std::vector<ConnectionID> _rx_batch_conns;
 
         opt::manual_routing _manual_routing;
 
+        // Shared with the endpoint's connections, so that it outlives their final trace writes
+        std::shared_ptr<QlogWriter> qlog_writer;
+        // Sends waiting on manually_signal_writeable()
+        std::vector<std::function<void()>> manual_writeable_callbacks;
+
         uint64_t _next_rid{0};
 
         ustring _static_secret;
@@ -230,7 +281,34 @@ namespace oxen::quic
         std::vector<ustring> inbound_alpns;
         std::chrono::nanoseconds handshake_timeout{DEFAULT_HANDSHAKE_TIMEOUT};
 
-        std::map<ustring, ustring> anti_replay_db;
+        // Maximum number of source prefixes tracked for Initial rate limiting; prefixes beyond this
+        // are not rate limited (but are still subject to the half-open and Retry limits).
+        static constexpr size_t MAX_ADMISSION_PREFIXES = 65'536;
+
+        struct prefix_hash
+        {
+            size_t operator()(const std::pair<uint64_t, uint64_t>& p) const noexcept
+            {
+                return std::hash<uint64_t>{}(p.first ^ (p.second * 0x9e3779b97f4a7c15ULL));
+            }
+        };
+
+        struct initial_bucket
+        {
+            double tokens;
+            std::chrono::steady_clock::time_point updated;
+        };
+
+        opt::admission_control _admission;
+        admission_stats _admission_stats;
+        // Inbound connections that have not yet completed their handshake
+        std::unordered_set<ConnectionID> half_open_conns;
+        // Initial rate limiting token buckets, keyed by masked source address
+        std::unordered_map<std::pair<uint64_t, uint64_t>, initial_bucket, prefix_hash> initial_buckets;
+        std::chrono::steady_clock::time_point last_bucket_sweep{};
+
+        // Keyed by the Connection::resumption_id of the outbound connections that stored them
+        std::map<ustring, ustring> session_tickets;
         std::map<ustring, ustring> encoded_transport_params;
         std::map<ustring, ustring> path_validation_tokens;
 
@@ -238,10 +316,15 @@ namespace oxen::quic
 
         const std::unique_ptr<UDPSocket>& get_socket() { return socket; }
 
+        // Queues `cb` to be invoked once sending is possible again after a blocked send, either on
+        // the UDP socket or through the manual routing hook.
+        void when_writeable(std::function<void()> cb);
+
         // Does the non-templated bit of `listen()`
         void _listen();
 
         void handle_ep_opt(opt::enable_datagrams dc);
+        void handle_ep_opt(opt::datagram_fec fec);
         void handle_ep_opt(opt::outbound_alpns alpns);
         void handle_ep_opt(opt::inbound_alpns alpns);
         void handle_ep_opt(opt::alpns alpns);
@@ -251,6 +334,9 @@ namespace oxen::quic
         void handle_ep_opt(connection_closed_callback conn_closed_cb);
         void handle_ep_opt(opt::static_secret ssecret);
         void handle_ep_opt(opt::manual_routing mrouting);
+        void handle_ep_opt(opt::admission_control ac);
+        void handle_ep_opt(opt::qlog q);
+        void handle_ep_opt(opt::idle_slimming slim);
 
         // Takes a std::optional-wrapped option that does nothing if the optional is empty,
         // otherwise passes it through to the above.  This is here to allow runtime-dependent
@@ -264,6 +350,23 @@ namespace oxen::quic
 
         void handle_packet(Packet&& pkt);
 
+        // Receive and batch-end callbacks of the UDP socket.  finish_rx_batch returns the number of
+        // connections it flushed.
+        void handle_socket_packet(Packet&& pkt);
+        size_t finish_rx_batch();
+
+        // Returns the receive time of the packets currently being processed (see
+        // handle_socket_packet), or the current time if not processing a received batch.  Anything
+        // that can hand a connection's ngtcp2_conn a timestamp in the middle of a batch (reading a
+        // packet, flushing, closing) takes it from here rather than from get_time(), as a later
+        // timestamp followed by the next packet's (earlier) batch timestamp would make the
+        // connection's time go backwards.
+        std::chrono::steady_clock::time_point rx_time() const { return _rx_batch_time ? *_rx_batch_time : get_time(); }
+
+        // If a batch of received packets is being processed then this defers flushing `conn` until
+        // the end of the batch and returns true; otherwise returns false.
+        bool defer_flush(Connection& conn);
+
         /// Attempts to send up to `n_pkts` packets to an address over this endpoint's socket.
         ///
         /// Upon success, updates n_pkts to 0 and returns an io_result with `.success()` true.
@@ -291,11 +394,22 @@ namespace oxen::quic
 
         void connection_established(connection_interface& conn);
 
-        int validate_anti_replay(ustring key, ustring data, time_t exp);
+        // Called when an inbound connection completes its handshake
+        void inbound_handshake_completed(Connection& conn);
+
+        // Takes a token from the rate limiting bucket of `source`'s prefix; returns false if there
+        // is none left.
+        bool take_initial_token(const Address& source);
+
+        void store_session_ticket(ustring resumption_id, ustring ticket);
+
+        // Removes and returns the session ticket stored for `resumption_id`, if any.  Tickets are
+        // only used once: the server issues a fresh one on every connection.
+        std::optional<ustring> take_session_ticket(const ustring& resumption_id);
 
-        void store_0rtt_transport_params(ustring remote_pk, ustring encoded_params);
+        void store_0rtt_transport_params(ustring resumption_id, ustring encoded_params);
 
-        std::optional<ustring> get_0rtt_transport_params(ustring remote_pk);
+        std::optional<ustring> get_0rtt_transport_params(const ustring& resumption_id);
 
         void store_path_validation_token(ustring remote_pk, ustring token);
 
@@ -50,6 +50,9 @@ namespace oxen::quic
     inline constexpr uint64_t CONN_SEND_FAIL = ERROR_BASE + 1002;
     // Connection closing because it reached idle timeout
     inline constexpr uint64_t CONN_IDLE_CLOSED = ERROR_BASE + 1003;
+    // Connection closing because the key_verify callback, deferred to a worker pool, rejected the
+    // remote key
+    inline constexpr uint64_t CONN_KEY_VERIFY_FAILED = ERROR_BASE + 1004;
 
     inline std::string quic_strerror(uint64_t e)
     {
@@ -73,6 +76,8 @@ namespace oxen::quic
                 return "Error - Failed to send packet"s;
             case CONN_IDLE_CLOSED:
                 return "Connection closed by idle timeout"s;
+            case CONN_KEY_VERIFY_FAILED:
+                return "Connection closed by remote key verification failure"s;
             default:
                 return "Application error code " + std::to_string(e);
         }
@@ -3,11 +3,18 @@
 #include <oxenc/base64.h>
 #include <oxenc/hex.h>
 
+#include <ctime>
+#include <deque>
+#include <list>
+#include <mutex>
 #include <optional>
+#include <unordered_map>
+#include <unordered_set>
 #include <variant>
 
 #include "crypto.hpp"
 #include "utils.hpp"
+#include "worker_pool.hpp"
 
 namespace oxen::quic
 {
@@ -25,6 +32,8 @@ namespace oxen::quic
     {
         int cert_verify_callback_gnutls(gnutls_session_t g_session);
 
+        int anti_replay_db_add_func(void* dbf, time_t exp_time, const gnutls_datum_t* key, const gnutls_datum_t* data);
+
         void gnutls_log(int level, const char* str);
 
         struct gnutls_log_setter
@@ -259,6 +268,118 @@ namespace oxen::quic
         }
     };
 
+    // Default interval after which a GNUTLSCreds replaces its session ticket key.  (GnuTLS itself
+    // also rotates the ticket encryption keys it derives from this key much more frequently).
+    inline constexpr std::chrono::seconds DEFAULT_TICKET_KEY_ROTATION{24h};
+
+    // Session ticket key shared by all of the server sessions created from a GNUTLSCreds, so that a
+    // ticket issued on one connection can be used to resume another.
+    struct session_ticket_key
+    {
+        gnutls_datum_t key{};
+        const std::chrono::steady_clock::time_point created;
+
+        // Generates a new random key; throws on failure
+        session_ticket_key();
+        ~session_ticket_key();
+
+        session_ticket_key(const session_ticket_key&) = delete;
+        session_ticket_key& operator=(const session_ticket_key&) = delete;
+    };
+
+    // Default maximum number of 0-RTT ClientHellos remembered by an anti_replay_window
+    inline constexpr size_t DEFAULT_ANTI_REPLAY_ENTRIES{100'000};
+
+    // Record of the 0-RTT ClientHellos accepted within GnuTLS's anti-replay window, used to refuse
+    // early data from a replayed ClientHello.  Entries are dropped once they expire, at which point
+    // GnuTLS itself rejects the ClientHello as too old.  If the record fills up then further early
+    // data is refused (the handshake still proceeds, at 1-RTT) until entries expire.
+    class anti_replay_window
+    {
+      public:
+        explicit anti_replay_window(size_t max_entries = DEFAULT_ANTI_REPLAY_ENTRIES) : max_entries{max_entries} {}
+
+        // Records `key` until (wall clock) time `expiry`.  Returns false, without recording
+        // anything, if `key` is already recorded or if the record is full.
+        bool add(ustring_view key, time_t expiry, time_t now = std::time(nullptr));
+
+        size_t size() const;
+
+      private:
+        mutable std::mutex mutex;
+        const size_t max_entries;
+        // Insertion order, which is also expiry order as GnuTLS uses a fixed window
+        std::deque<std::pair<time_t, std::string>> entries;
+        // Views into `entries`
+        std::unordered_set<std::string_view> seen;
+
+        void expire(time_t now);
+    };
+
+    struct key_verify_cache_stats
+    {
+        uint64_t hits{0};
+        uint64_t misses{0};
+        size_t size{0};
+    };
+
+    // Bounded LRU cache of key_verify verdicts, keyed by (remote key, ALPN), so that a burst of
+    // reconnections from the same peers doesn't repeat the verification for each one.  Both
+    // acceptances and rejections are cached, each for `ttl` after the verification.  Disabled (i.e.
+    // never stores anything) while `max_entries` is 0, which is the default.
+    class key_verify_cache
+    {
+      public:
+        using clock = std::chrono::steady_clock;
+
+        // Sets the capacity and TTL, dropping all cached verdicts.  `max_entries` of 0 disables the
+        // cache.
+        void configure(size_t max_entries, std::chrono::seconds ttl);
+
+        // Returns the cached verdict for `key`/`alpn`, if there is an unexpired one, counting the
+        // lookup as a hit or miss.  Always returns nullopt (without counting) when disabled.
+        std::optional<bool> get(ustring_view key, ustring_view alpn, clock::time_point now = get_time());
+
+        // Caches `verdict` for `key`/`alpn`, evicting the least recently used entry if full.  The
+        // verdict is dropped if the cache was cleared or reconfigured since `gen` was obtained from
+        // generation(), so that a verification still running when the acceptable keys change
+        // cannot put back a verdict reached under the old policy.
+        void put(ustring_view key,
+                 ustring_view alpn,
+                 bool verdict,
+                 uint64_t gen,
+                 clock::time_point now = get_time());
+
+        // Drops all cached verdicts, e.g. after the set of acceptable keys changes
+        void clear();
+
+        // Incremented by each clear() or configure(); see put()
+        uint64_t generation() const;
+
+        bool enabled() const;
+
+        key_verify_cache_stats stats() const;
+
+      private:
+        struct entry
+        {
+            std::string id;  // remote key followed by the ALPN
+            bool verdict;
+            clock::time_point expiry;
+        };
+
+        mutable std::mutex mutex;
+        size_t max_entries{0};
+        std::chrono::seconds ttl{0};
+        // Most recently used first
+        std::list<entry> lru;
+        // Views into the `id`s in `lru`
+        std::unordered_map<std::string_view, std::list<entry>::iterator> index;
+        uint64_t gen{0};
+        uint64_t hits{0};
+        uint64_t misses{0};
+    };
+
     class GNUTLSCreds : public TLSCreds
     {
         friend class GNUTLSSession;
@@ -267,6 +388,20 @@ namespace oxen::quic
         // Construct from raw Ed25519 keys
         GNUTLSCreds(std::string_view ed_seed, std::string_view ed_pubkey);
 
+        // The creds can be shared by endpoints running on different event loops, so the ticket key
+        // state is guarded.
+        std::mutex ticket_key_mutex;
+        std::shared_ptr<const session_ticket_key> ticket_key;
+        std::chrono::seconds ticket_key_rotation{DEFAULT_TICKET_KEY_ROTATION};
+
+        bool session_resumption{true};
+        bool early_data{false};
+
+        // Set from the application's thread, but called from the event loop and the key verify
+        // pool; see get_key_verify().
+        mutable std::mutex key_verify_mutex;
+        key_verify_callback key_verify;
+
       public:
         gnutls_pcert_st pcrt;
         gnutls_privkey_t pkey;
@@ -275,15 +410,97 @@ namespace oxen::quic
 
         const bool using_raw_pk{false};
 
+        // The raw Ed25519 pubkey the creds were made from
+        const ustring pubkey;
+
         gnutls_certificate_credentials_t cred;
 
-        key_verify_callback key_verify;
+        // Verdicts of `key_verify`; see set_key_verify_cache().  Mutable as it is used through the
+        // const creds reference held by sessions.
+        mutable key_verify_cache verify_cache;
+
+        // If set, uncached key_verify calls run on this pool instead of the event loop; see
+        // set_key_verify_pool().
+        std::shared_ptr<WorkerPool> key_verify_pool;
 
         gnutls_priority_t priority_cache;
 
+        // Anti-replay context shared by all of the server sessions created from these creds, and
+        // the record of accepted 0-RTT ClientHellos that backs it.
+        gnutls_anti_replay_t anti_replay;
+        anti_replay_window anti_replay_db;
+
         void load_keys(x509_loader& seed, x509_loader& pk);
 
-        void set_key_verify_callback(key_verify_callback cb) { key_verify = std::move(cb); }
+        // Returns the current session ticket key, first replacing it with a new one if it is older
+        // than the rotation interval.
+        std::shared_ptr<const session_ticket_key> current_ticket_key();
+
+        // Replaces the session ticket key immediately.  Tickets issued under the old key can no
+        // longer be used for resumption.
+        void rotate_ticket_key();
+
+        // Sets the interval after which the session ticket key is replaced
+        void set_ticket_key_rotation(std::chrono::seconds interval);
+
+        // Enables or disables TLS session resumption: servers issue session tickets, and clients
+        // use the tickets they are issued to resume later connections to the same remote.  Enabled
+        // by default.  Must be set before the creds are used.
+        void set_session_resumption(bool enabled) { session_resumption = enabled; }
+
+        // Enables or disables 0-RTT on resumed sessions: clients send their first stream data along
+        // with the ClientHello, and servers accept it (subject to the anti-replay window).  Early
+        // data can be replayed by an attacker, so this is disabled by default and should only be
+        // enabled by applications whose early requests are safe to repeat.  Servers only deliver
+        // early stream data to the application once the client key has been verified.  Has no
+        // effect without session resumption.  Must be set before the creds are used.
+        void set_early_data(bool enabled) { early_data = enabled; }
+
+        // Sets the callback used by servers to verify client keys.  Clears any cached verdicts.
+        // Verifications already running finish with the previous callback, but their verdicts are
+        // not cached.
+        void set_key_verify_callback(key_verify_callback cb)
+        {
+            std::lock_guard lock{key_verify_mutex};
+            key_verify = std::move(cb);
+            verify_cache.clear();
+        }
+
+        // A copy of the key_verify callback, along with the verdict cache generation to pass to
+        // verify_cache.put() with its verdict.
+        struct key_verify_snapshot
+        {
+            key_verify_callback verify;
+            uint64_t cache_generation;
+        };
+
+        key_verify_snapshot get_key_verify() const
+        {
+            std::lock_guard lock{key_verify_mutex};
+            return {key_verify, verify_cache.generation()};
+        }
+
+        // Enables caching of up to `max_entries` key_verify verdicts, each reused for up to `ttl`;
+        // `max_entries` of 0 disables the cache again.  Applications whose set of acceptable keys
+        // changes should call clear_key_verify_cache() when it does (or keep the TTL short).
+        void set_key_verify_cache(size_t max_entries, std::chrono::seconds ttl) { verify_cache.configure(max_entries, ttl); }
+
+        void clear_key_verify_cache() { verify_cache.clear(); }
+
+        // Runs the key_verify callback of server handshakes on `pool` rather than on the event loop,
+        // so that slow verification (e.g. consulting an external allow-list) doesn't stall every
+        // other connection on the endpoint.  The handshake completes provisionally; the connection
+        // is only reported as established (and its incoming packets only processed) once the
+        // callback accepts the key, and it is closed with CONN_KEY_VERIFY_FAILED if the callback
+        // rejects it.  Cached verdicts are still used directly.  Pass nullptr to verify on the event
+        // loop again.  Must be set before the creds are used.
+        void set_key_verify_pool(std::shared_ptr<WorkerPool> pool) { key_verify_pool = std::move(pool); }
+
+        key_verify_cache_stats get_key_verify_cache_stats() const { return verify_cache.stats(); }
+
+        // Returns the key_verify verdict for a client key, from the cache if enabled and possible.
+        // Accepts any key if there is no key_verify callback.
+        bool verify_remote_key(ustring_view key, ustring_view alpn) const;
 
         static std::shared_ptr<GNUTLSCreds> make_from_ed_keys(std::string_view seed, std::string_view pubkey);
 
@@ -299,8 +516,8 @@ namespace oxen::quic
 
       private:
         gnutls_session_t session;
-        gnutls_datum_t session_ticket_key;
-        gnutls_anti_replay_t anti_replay;
+        // Server only: the creds' ticket key at the time the session was created
+        std::shared_ptr<const session_ticket_key> ticket_key;
 
         bool is_client;
 
@@ -308,6 +525,10 @@ namespace oxen::quic
 
         gnutls_key _remote_key{};
 
+        // Server only: the remote key was accepted provisionally, pending a key_verify call on the
+        // creds' key_verify_pool
+        bool _key_verify_deferred{false};
+
       public:
         GNUTLSSession(
                 GNUTLSCreds& creds,
@@ -319,21 +540,31 @@ namespace oxen::quic
 
         void* get_session() override { return session; }
 
-        void* get_anti_replay() const override { return anti_replay; }
+        void* get_anti_replay() const override { return is_client || !early_data_enabled() ? nullptr : creds.anti_replay; }
 
-        const void* get_session_ticket_key() const override { return &session_ticket_key; }
+        const void* get_session_ticket_key() const override { return ticket_key ? &ticket_key->key : nullptr; }
 
         bool get_early_data_accepted() const override
         {
             return gnutls_session_get_flags(session) & GNUTLS_SFLAGS_EARLY_DATA;
         }
 
+        bool is_resumed() const override { return gnutls_session_is_resumed(session); }
+
+        bool resumption_enabled() const override { return creds.session_resumption; }
+
+        bool early_data_enabled() const override { return creds.session_resumption && creds.early_data; }
+
+        bool set_resumption_ticket(ustring_view ticket) override;
+
         ustring_view remote_key() const override { return _remote_key.view(); }
 
         ustring_view selected_alpn() override;
 
         bool validate_remote_key();
 
+        bool key_verify_deferred() const { return _key_verify_deferred; }
+
         int send_session_ticket() override;
 
         void set_expected_remote_key(ustring key) override { _expected_remote_key(key); }
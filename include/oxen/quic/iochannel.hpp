@@ -47,24 +47,35 @@ namespace oxen::quic
         Address local() const;
         Address remote() const;
 
+        // The memory pool of the endpoint's event loop, for allocating shared_buffers
+        const std::shared_ptr<memory_pool>& buffer_pool() const;
+
         template <oxenc::basic_char CharType>
         void send(std::basic_string_view<CharType> data, std::shared_ptr<void> keep_alive = nullptr)
         {
-            send_impl(convert_sv<std::byte>(data), std::move(keep_alive));
+            send_impl(convert_sv<std::byte>(data), shared_buffer::wrap(std::move(keep_alive)));
+        }
+
+        // Sends `data`, which must be kept alive by `keep_alive`
+        void send(bstring_view data, shared_buffer keep_alive) { send_impl(data, std::move(keep_alive)); }
+
+        // Sends the data owned by `buf`
+        void send(shared_buffer buf)
+        {
+            auto data = buf.view();
+            send_impl(data, std::move(buf));
         }
 
         template <oxenc::basic_char CharType>
         void send(std::basic_string<CharType>&& data)
         {
-            auto keep_alive = std::make_shared<std::basic_string<CharType>>(std::move(data));
-            std::basic_string_view<CharType> view{*keep_alive};
-            send(view, std::move(keep_alive));
+            send(shared_buffer::make<std::basic_string<CharType>>(buffer_pool(), std::move(data)));
         }
 
         template <oxenc::basic_char Char>
         void send(std::vector<Char>&& buf)
         {
-            send(std::basic_string_view<Char>{buf.data(), buf.size()}, std::make_shared<std::vector<Char>>(std::move(buf)));
+            send(shared_buffer::make<std::vector<Char>>(buffer_pool(), std::move(buf)));
         }
 
       protected:
@@ -75,7 +86,7 @@ namespace oxen::quic
 
         // This is the (single) send implementation that implementing classes must provide; other
         // calls to send are converted into calls to this.
-        virtual void send_impl(bstring_view, std::shared_ptr<void> keep_alive) = 0;
+        virtual void send_impl(bstring_view, shared_buffer keep_alive) = 0;
 
         virtual std::vector<ngtcp2_vec> pending() = 0;
         virtual prepared_datagram pending_datagram(bool) = 0;
@@ -6,15 +6,20 @@ extern "C"
 #include <event2/thread.h>
 }
 
+#include <array>
 #include <atomic>
 #include <cstdint>
 #include <forward_list>
 #include <future>
 #include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 #include "context.hpp"
+#include "coro.hpp"
 #include "crypto.hpp"
+#include "pool.hpp"
 #include "utils.hpp"
 
 namespace oxen::quic
@@ -67,9 +72,39 @@ namespace oxen::quic
         bool stop();
     };
 
+    /// Snapshot of the event loop statistics collected while Loop::enable_stats is on.  Every value
+    /// accumulates from when the statistics were (most recently) enabled.
+    struct loop_stats
+    {
+        // Upper bounds of the job execution time histogram buckets; the final bucket of
+        // `job_times` counts the jobs that took longer than all of them.
+        static constexpr std::array<std::chrono::microseconds, 5> job_time_bounds{10us, 100us, 1ms, 10ms, 100ms};
+
+        // Jobs run from the job queue (i.e. `call`/`call_soon`/`call_get` from outside the loop)
+        uint64_t jobs{0};
+        // Most jobs found waiting when the job queue was processed
+        size_t job_queue_high_water{0};
+        std::array<uint64_t, job_time_bounds.size() + 1> job_times{};
+        std::chrono::nanoseconds job_time_max{0};
+
+        // How late the periodic probe timer fired: a measure of how long events wait for the loop
+        uint64_t lag_samples{0};
+        std::chrono::nanoseconds lag_total{0};
+        std::chrono::nanoseconds lag_max{0};
+
+        // How late one-shot timers (`call_later` and connection expiry timers) fired
+        uint64_t timers{0};
+        std::chrono::nanoseconds timer_slip_total{0};
+        std::chrono::nanoseconds timer_slip_max{0};
+
+        std::string to_string() const;
+        static constexpr bool to_string_formattable = true;
+    };
+
     class Loop
     {
         friend class Network;
+        friend class Connection;
 
       protected:
         std::atomic<bool> running{false};
@@ -87,11 +122,17 @@ namespace oxen::quic
             auto handler = make_shared<Ticker>();
             auto& h = *handler;
 
+            std::optional<std::chrono::steady_clock::time_point> due;
+            if (stats_enabled())
+                due = get_time() + delay;
+
             h.init_event(
                     loop(),
                     delay,
-                    [hndlr = std::move(handler), func = std::move(hook)]() mutable {
+                    [this, due, hndlr = std::move(handler), func = std::move(hook)]() mutable {
                         auto h = std::move(hndlr);
+                        if (due)
+                            record_timer_slip(get_time() - *due);
                         func();
                         h.reset();
                     },
@@ -107,6 +148,29 @@ namespace oxen::quic
 
         std::shared_ptr<Ticker> make_handler(caller_id_t _id);
 
+        // Statistics; `_stats` is updated from the loop thread, and guarded so that it can be read
+        // from any thread.
+        std::atomic<bool> _stats_enabled{false};
+        mutable std::mutex stats_mutex;
+        loop_stats _stats;
+        event_ptr stats_probe;
+        std::chrono::microseconds stats_probe_interval{0};
+        std::chrono::microseconds stats_log_interval{0};
+        std::chrono::steady_clock::time_point stats_probe_due{};
+        std::chrono::steady_clock::time_point stats_last_log{};
+
+        // Backs the objects created by make_shared (and their control blocks), along with stream
+        // send buffer blocks; see `memory_pool`.
+        std::shared_ptr<memory_pool> _pool = memory_pool::make();
+
+        // Helper threads waiting to be joined once the loop thread stops (see `join_later`)
+        std::mutex retired_mutex;
+        std::vector<std::thread> retired_threads;
+
+        void arm_stats_probe();
+        void stats_probe_fired();
+        void record_timer_slip(std::chrono::nanoseconds slip);
+
       public:
         Loop();
 
@@ -121,6 +185,28 @@ namespace oxen::quic
 
         bool in_event_loop() const { return std::this_thread::get_id() == loop_thread_id; }
 
+        /// Starts (or, if `enable` is false, stops) collecting statistics about how busy the event
+        /// loop is; see `loop_stats`.  A probe timer fires every `probe_interval` to measure the
+        /// loop lag, and if `log_interval` is non-zero the statistics are also logged (at info
+        /// level) that often.  Enabling the statistics resets them.  Collection is off by default,
+        /// and costs next to nothing while off.
+        void enable_stats(
+                bool enable = true,
+                std::chrono::milliseconds probe_interval = 100ms,
+                std::chrono::milliseconds log_interval = 0ms);
+
+        bool stats_enabled() const { return _stats_enabled.load(std::memory_order_relaxed); }
+
+        /// Returns a snapshot of the statistics collected since they were enabled.  Can be called
+        /// from any thread.
+        loop_stats get_stats() const;
+
+        const std::shared_ptr<memory_pool>& pool() const { return _pool; }
+
+        // Takes over `t` and joins it once the loop thread has stopped; for retiring helper threads
+        // (such as a qlog writer's) from the loop thread without blocking it.
+        void join_later(std::thread t);
+
         // Returns a pointer deleter that defers the actual destruction call to this network
         // object's event loop.
         template <typename T>
@@ -138,14 +224,46 @@ namespace oxen::quic
             };
         }
 
+        // Returns a pointer deleter, for objects allocated from this loop's memory pool, that
+        // defers destruction and the release of the memory to this network object's event loop.
+        template <typename T>
+        auto pooled_deleter()
+        {
+            return [this, pool = _pool](T* ptr) {
+                call([ptr, pool] {
+                    ptr->~T();
+                    pool->deallocate(ptr, sizeof(T));
+                });
+            };
+        }
+
         // Similar in concept to std::make_shared<T>, but it creates the shared pointer with a
         // custom deleter that dispatches actual object destruction to the network's event loop for
-        // thread safety.
+        // thread safety.  Both the object and the shared_ptr control block come from the loop's
+        // memory pool (where small enough), as streams are created and destroyed at a high rate.
         template <typename T, typename... Args>
         std::shared_ptr<T> make_shared(Args&&... args)
         {
-            auto* ptr = new T{std::forward<Args>(args)...};
-            return std::shared_ptr<T>{ptr, loop_deleter<T>()};
+            if constexpr (!memory_pool::pooled(sizeof(T), alignof(T)))
+            {
+                auto* ptr = new T{std::forward<Args>(args)...};
+                return std::shared_ptr<T>{ptr, loop_deleter<T>()};
+            }
+            else
+            {
+                void* mem = _pool->allocate(sizeof(T));
+                T* ptr;
+                try
+                {
+                    ptr = ::new (mem) T{std::forward<Args>(args)...};
+                }
+                catch (...)
+                {
+                    _pool->deallocate(mem, sizeof(T));
+                    throw;
+                }
+                return std::shared_ptr<T>{ptr, pooled_deleter<T>(), pool_allocator<T>{_pool}};
+            }
         }
 
         // Similar to the above make_shared, but instead of forwarding arguments for the
@@ -201,6 +319,22 @@ namespace oxen::quic
             return fut.get();
         }
 
+        /// Coroutine counterpart of `call_get`: `co_await loop.call_async(f)` invokes `f` on the
+        /// event loop and evaluates to its result.  Rather than blocking the calling thread on a
+        /// future, the coroutine is suspended and resumed on the event loop once `f` has run.
+        template <std::invocable Callable>
+        auto call_async(Callable f)
+        {
+            return loop_call_awaitable<Loop, Callable>{*this, std::move(f)};
+        }
+
+        /// `co_await loop.resume_on_loop()` moves the coroutine onto the event loop thread (without
+        /// suspending it at all if it is already there).
+        auto resume_on_loop()
+        {
+            return call_async([] {});
+        }
+
         /** This invocation of `call_every` will return an EventHandler object from which the application can start and stop
             the repeated event. It is NOT tied to the lifetime of the caller via a weak_ptr.
 
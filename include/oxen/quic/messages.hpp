@@ -56,11 +56,11 @@ namespace oxen::quic
         uint16_t pload_id;
         std::optional<uint16_t> add_id;
         std::optional<bstring_view> payload, addendum;
-        std::shared_ptr<void> keep_alive;
+        shared_buffer keep_alive;
         dgram type;
 
         static datagram_storage make(
-                bstring_view pload, uint16_t d_id, std::shared_ptr<void> data, dgram type, size_t max_size = 0);
+                bstring_view pload, uint16_t d_id, shared_buffer data, dgram type, size_t max_size = 0);
 
         bool empty() const { return !(payload || addendum); }
 
@@ -69,12 +69,12 @@ namespace oxen::quic
         size_t size() const { return payload->length() + addendum->length(); }
 
       private:
-        explicit datagram_storage(bstring_view pload, uint16_t p_id, std::shared_ptr<void> data) :
+        explicit datagram_storage(bstring_view pload, uint16_t p_id, shared_buffer data) :
                 pload_id{p_id}, payload{pload}, keep_alive{std::move(data)}, type{dgram::STANDARD}
         {}
 
         explicit datagram_storage(
-                bstring_view pload, bstring_view add, uint16_t p_id, uint16_t a_id, std::shared_ptr<void> data) :
+                bstring_view pload, bstring_view add, uint16_t p_id, uint16_t a_id, shared_buffer data) :
                 pload_id{p_id},
                 add_id{a_id},
                 payload{pload},
@@ -100,6 +100,9 @@ namespace oxen::quic
 
         std::optional<bstring> receive(bstring_view data, uint16_t dgid);
         void clear_row(int index);
+        // Frees the buffer rows (dropping any unmatched split datagrams); they are re-allocated on the
+        // next receive.  Returns false if they were not allocated.
+        bool release();
         int datagrams_stored() const;
     };
 
@@ -114,7 +117,78 @@ namespace oxen::quic
 
         prepared_datagram prepare(bool b, int is_splitting);
 
-        void emplace(bstring_view pload, uint16_t p_id, std::shared_ptr<void> data, dgram type, size_t max_size = 0);
+        void emplace(bstring_view pload, uint16_t p_id, shared_buffer data, dgram type, size_t max_size = 0);
+    };
+
+    /// XORs `len` bytes of `src` into `dst`. This is the parity kernel for datagram FEC; it works on
+    /// machine words so that the compiler can vectorise the loop for the target architecture.
+    void xor_into(std::byte* dst, const std::byte* src, size_t len);
+
+    /// Datagram FEC framing:
+    ///
+    ///     [group id (2B, big endian)][index (1B)][group size K (1B)][payload]
+    ///
+    /// Data datagrams use indices [0, K); the parity datagram of a group uses index K, and its payload
+    /// is the XOR of the lengths of the K data payloads (2B, big endian) followed by the XOR of the K
+    /// data payloads, each zero-padded to the longest of them.
+    ///
+    /// A group that is flushed before it fills holds only n < K data datagrams, which still carry K
+    /// as their group size; its parity datagram uses n as both its index and its group size.
+    struct fec_encoder
+    {
+        const uint8_t group_size;
+        uint16_t group{0};
+        uint8_t index{0};
+        uint16_t len_xor{0};
+        bstring parity;
+
+        explicit fec_encoder(int k) : group_size{static_cast<uint8_t>(k)} {}
+
+        // Frames `data` as the next member of the current group, writing the framed datagram into
+        // `out`. If `data` completes the group then the group's parity datagram is returned.
+        std::optional<bstring> encode(bstring_view data, bstring& out);
+
+        // Closes the current group early, returning the parity datagram of the data datagrams it
+        // holds so far (or nullopt if it holds none).
+        std::optional<bstring> flush();
+
+      private:
+        bstring finish_group();
+    };
+
+    struct fec_decoder
+    {
+        // Number of consecutive groups for which recovery state is retained
+        static constexpr size_t WINDOW = 16;
+
+        struct group_state
+        {
+            std::optional<uint16_t> group;
+            uint8_t group_size{0};
+            uint64_t received{0};  // bitmask of data indices seen (or recovered)
+            uint16_t len_xor{0};
+            bstring acc;  // XOR of every data payload seen, and of the parity payload once seen
+            bool have_parity{false};
+
+            void reset(uint16_t g, uint8_t k);
+        };
+
+        struct result
+        {
+            // The payload of the datagram just received (unset for parity datagrams or duplicates)
+            std::optional<bstring> data;
+            // A datagram of the same group that was reconstructed thanks to this datagram
+            std::optional<bstring> recovered;
+        };
+
+        std::array<group_state, WINDOW> groups{};
+        uint64_t recovered_count{0};
+
+        result receive(bstring_view framed);
+
+      private:
+        void accumulate(group_state& gs, bstring_view data);
+        std::optional<bstring> try_recover(group_state& gs);
     };
 
 }  // namespace oxen::quic
@@ -64,6 +64,8 @@ namespace oxen::quic
             return _loop->make_shared<T>(std::forward<Args>(args)...);
         }
 
+        const std::shared_ptr<memory_pool>& pool() const { return _loop->pool(); }
+
         void set_shutdown_immediate(bool b = true) { shutdown_immediate = b; }
 
         template <typename Callable>
@@ -78,6 +80,14 @@ namespace oxen::quic
             return _loop->call_get(std::forward<Callable>(f));
         }
 
+        template <typename Callable>
+        auto call_async(Callable f)
+        {
+            return _loop->call_async(std::move(f));
+        }
+
+        auto resume_on_loop() { return _loop->resume_on_loop(); }
+
         void reset_soon(std::shared_ptr<void> ptr)
         {
             call_soon([ptr = std::move(ptr)]() mutable { ptr.reset(); });
@@ -107,6 +117,18 @@ namespace oxen::quic
             _loop->call_later(delay, std::forward<Callable>(hook));
         }
 
+        /// Starts or stops collecting event loop statistics; see Loop::enable_stats.  Networks
+        /// sharing an event loop also share its statistics.
+        void enable_loop_stats(
+                bool enable = true,
+                std::chrono::milliseconds probe_interval = 100ms,
+                std::chrono::milliseconds log_interval = 0ms)
+        {
+            _loop->enable_stats(enable, probe_interval, log_interval);
+        }
+
+        loop_stats get_loop_stats() const { return _loop->get_stats(); }
+
       private:
         std::shared_ptr<Loop> _loop;
         std::atomic<bool> shutdown_immediate{false};
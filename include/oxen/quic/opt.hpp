@@ -1,5 +1,6 @@
 #pragma once
 
+#include <filesystem>
 #include <stdexcept>
 
 #include "address.hpp"
@@ -123,6 +124,45 @@ namespace oxen::quic
             }
         };
 
+        /// Enables forward error correction on the datagram channel of the endpoint. Outgoing datagrams
+        /// are grouped into blocks of `group_size` datagrams, and once a group is full a single XOR
+        /// parity datagram covering the group is also sent. A receiver that gets all but one datagram of
+        /// a group plus the parity datagram reconstructs the missing datagram before handing it to the
+        /// datagram data callback, trading one extra datagram per group for resilience against
+        /// isolated losses.
+        ///
+        /// If a group is still not full `flush_timeout` after its first datagram was sent then it is
+        /// closed early, and a parity datagram covering just the datagrams sent so far is sent, so
+        /// that the tail of a burst is protected too.  A zero timeout disables this, leaving the
+        /// datagrams of a partial group unprotected until enough further datagrams are sent.
+        ///
+        /// Each datagram carries FEC_HEADER_SIZE bytes of framing, and room is reserved for the parity
+        /// length field, so the value returned by connection_interface::get_max_datagram_size() is
+        /// reduced by FEC_OVERHEAD when this is enabled.
+        ///
+        /// Note: this option requires opt::enable_datagrams, and (like packet splitting) must be
+        /// configured identically on both endpoints of a connection.
+        struct datagram_fec
+        {
+            static constexpr int MAX_GROUP_SIZE = 64;
+            static constexpr std::chrono::milliseconds DEFAULT_FLUSH_TIMEOUT{10};
+
+            int group_size{8};
+            std::chrono::milliseconds flush_timeout{DEFAULT_FLUSH_TIMEOUT};
+
+            datagram_fec() = default;
+            explicit datagram_fec(int k, std::chrono::milliseconds flush = DEFAULT_FLUSH_TIMEOUT) :
+                    group_size{k}, flush_timeout{flush}
+            {
+                if (k < 1)
+                    throw std::out_of_range{"FEC group size must be positive"};
+                if (k > MAX_GROUP_SIZE)
+                    throw std::out_of_range{"FEC group size too large"};
+                if (flush < 0ms)
+                    throw std::out_of_range{"FEC flush timeout must not be negative"};
+            }
+        };
+
         // Used to provide precalculated static secret data for an endpoint to use for validation
         // tokens.  If not provided, 32 random bytes are generated during endpoint construction.  The
         // data provided must be (at least) SECRET_MIN_SIZE long (longer values are ignored).  For a
@@ -145,9 +185,20 @@ namespace oxen::quic
         // Used to provide a callback that bypasses sending packets out through the UDP socket. The passing of
         // this opt will also bypass the creation of the UDP socket entirely. The application will also need to
         // take responsibility for passing packets into the Endpoint via Endpoint::manually_receive_packet(...)
+        //
+        // The hook is either a per-packet `send_handler_t`, invoked once for each outgoing packet, or a
+        // `batch_send_handler_t`, which is handed each batch of packets exactly as UDPSocket::send would be:
+        // `n_pkts` packets stored back-to-back in `bufs`, with sizes `bufsize[0]` through `bufsize[n_pkts-1]`,
+        // all for the same path and with the same ECN value.  It returns the result and the number of packets
+        // (from the front of the batch) that it took.  If it cannot take them all it should return a blocked
+        // result (i.e. `io_result{EAGAIN}`); the remaining packets are then offered again (and no further
+        // packets produced for the affected connections) once the application calls
+        // Endpoint::manually_signal_writeable().  Any other failure drops the connection.
         struct manual_routing
         {
             using send_handler_t = std::function<void(const Path&, bstring_view)>;
+            using batch_send_handler_t = std::function<std::pair<io_result, size_t>(
+                    const Path& path, const std::byte* bufs, const size_t* bufsize, uint8_t ecn, size_t n_pkts)>;
 
           private:
             friend Endpoint;
@@ -155,6 +206,7 @@ namespace oxen::quic
             manual_routing() = default;
 
             send_handler_t send_hook = nullptr;
+            batch_send_handler_t batch_send_hook = nullptr;
 
           public:
             explicit manual_routing(send_handler_t cb) : send_hook{std::move(cb)}
@@ -163,14 +215,81 @@ namespace oxen::quic
                     throw std::runtime_error{"opt::manual_routing must be constructed with a send handler hook!"};
             }
 
-            io_result operator()(const Path& p, bstring_view data, size_t& n)
+            explicit manual_routing(batch_send_handler_t cb) : batch_send_hook{std::move(cb)}
+            {
+                if (not batch_send_hook)
+                    throw std::runtime_error{"opt::manual_routing must be constructed with a send handler hook!"};
+            }
+
+            std::pair<io_result, size_t> operator()(
+                    const Path& p, const std::byte* bufs, const size_t* bufsize, uint8_t ecn, size_t n_pkts)
             {
-                send_hook(p, data);
-                n = 0;
-                return io_result{};
+                if (batch_send_hook)
+                    return batch_send_hook(p, bufs, bufsize, ecn, n_pkts);
+
+                for (size_t i = 0; i < n_pkts; i++)
+                {
+                    send_hook(p, bstring_view{bufs, bufsize[i]});
+                    bufs += bufsize[i];
+                }
+                return {io_result{}, n_pkts};
             }
 
-            explicit operator bool() const { return send_hook != nullptr; }
+            explicit operator bool() const { return send_hook != nullptr || batch_send_hook != nullptr; }
+        };
+
+        /// Admission control for inbound connections, which keeps an endpoint (and its established
+        /// connections) responsive under a flood of handshake attempts by refusing Initial packets
+        /// before any connection state is allocated for them.  Every limit is off (0) by default:
+        ///
+        /// - `max_half_open`: the maximum number of inbound connections that may be mid-handshake at
+        ///   once.  Initials beyond that are dropped; legitimate clients retransmit them.
+        /// - `retry_threshold`: once this many inbound connections are mid-handshake, Initials
+        ///   without an address validation token are answered with a stateless Retry instead of a
+        ///   connection, so that sources must prove they can receive at their address before costing
+        ///   any state.
+        /// - `initial_rate`: the sustained rate (per second) of new connections allowed from each
+        ///   source prefix (IPv4 /`ipv4_prefix`, IPv6 /`ipv6_prefix`), with bursts of up to
+        ///   `initial_burst`.  Initials beyond that are dropped.
+        ///
+        /// Refused Initials are counted in Endpoint::get_admission_stats().
+        struct admission_control
+        {
+            size_t max_half_open{0};
+            size_t retry_threshold{0};
+            double initial_rate{0};
+            double initial_burst{10};
+            uint8_t ipv4_prefix{24};
+            uint8_t ipv6_prefix{48};
+        };
+
+        /// Writes a qlog (JSON-SEQ) trace of each of the endpoint's connections into `directory`
+        /// (which is created if needed), one `<source cid>-<client|server>.sqlog` file per
+        /// connection, for offline analysis of congestion control, loss recovery and pacing with
+        /// standard qlog tools.  Trace records are buffered in memory, up to `buffer_size` bytes, and
+        /// written out by a background thread so that the event loop never blocks on the disk;
+        /// records that don't fit in the buffer are dropped.
+        struct qlog
+        {
+            std::filesystem::path directory;
+            size_t buffer_size;
+
+            explicit qlog(std::filesystem::path dir, size_t bufsize = 4 * 1024 * 1024) :
+                    directory{std::move(dir)}, buffer_size{bufsize}
+            {}
+        };
+
+        /// Releases the per-connection packet send buffer and datagram reassembly buffer of any of the
+        /// endpoint's connections that have neither sent nor received a packet for `idle` (they are
+        /// re-allocated when next needed).  This is meant for endpoints holding very large numbers of
+        /// mostly idle connections, trading an allocation when a connection wakes up for a much
+        /// smaller resident footprint per idle connection.  Idle connections are checked four times a
+        /// second, so intervals much shorter than that are not useful.
+        struct idle_slimming
+        {
+            std::chrono::milliseconds idle;
+
+            explicit idle_slimming(std::chrono::milliseconds val = 5s) : idle{val} {}
         };
 
         // Used to provide callbacks for stream buffer watermarking. Application can pass an optional second parameter to
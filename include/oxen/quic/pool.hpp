@@ -0,0 +1,265 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace oxen::quic
+{
+    /// Size-class free-list allocator for the small, frequently created and destroyed objects of
+    /// an event loop: streams and their shared_ptr control blocks (see Loop::make_shared), stream
+    /// send buffer blocks, and send data buffers (see shared_buffer).  Memory is carved out of
+    /// chunks that are only returned to the system when the pool itself is destroyed, so that
+    /// opening and closing streams in steady state doesn't touch the system allocator at all.
+    ///
+    /// Almost all allocations and deallocations happen on the loop thread, but shared_ptr control
+    /// blocks can be released from any thread, so the pool is guarded by an (in practice
+    /// uncontended) mutex.
+    ///
+    /// Pools are created with `make()`.  Blocks handed out by a pool may be returned after the last
+    /// shared_ptr to it is released (shared_buffers only hold a plain pointer to their pool): the
+    /// pool then stays alive until all of its blocks have been returned.
+    class memory_pool
+    {
+      public:
+        // Block sizes are multiples of `granularity`, up to `max_block`
+        static constexpr size_t granularity = 64;
+        static constexpr size_t max_block = 2048;
+
+        // Whether an allocation of the given size and alignment is served by the pool; other
+        // allocations are passed through to the global operator new.
+        static constexpr bool pooled(size_t size, size_t align)
+        {
+            return size > 0 && size <= max_block && align <= alignof(std::max_align_t);
+        }
+
+        static std::shared_ptr<memory_pool> make();
+
+        memory_pool(const memory_pool&) = delete;
+        memory_pool& operator=(const memory_pool&) = delete;
+
+        // Allocates/frees a block for `size` bytes; `pooled(size, ...)` must be true, and
+        // `deallocate` must be given the same size as the `allocate` call.
+        void* allocate(size_t size);
+        void deallocate(void* p, size_t size) noexcept;
+
+        // Total bytes of chunks allocated by the pool (whether currently handed out or not)
+        size_t reserved() const;
+
+      private:
+        struct free_block
+        {
+            free_block* next;
+        };
+
+        mutable std::mutex mutex;
+        std::array<free_block*, max_block / granularity> free_lists{};
+        std::vector<std::byte*> chunks;
+        size_t _reserved{0};
+        // Blocks currently handed out, and whether the last shared_ptr to the pool is gone (in which
+        // case the last returned block deletes the pool)
+        size_t outstanding{0};
+        bool released{false};
+
+        memory_pool() = default;
+        ~memory_pool();
+
+        // The shared_ptr deleter of `make()`
+        void release() noexcept;
+
+        static constexpr size_t size_class(size_t size) { return (size - 1) / granularity; }
+    };
+
+    /// Standard allocator interface over a shared memory_pool; allocations the pool doesn't serve
+    /// (too large or over-aligned) go to the global operator new.
+    template <typename T>
+    struct pool_allocator
+    {
+        using value_type = T;
+
+        std::shared_ptr<memory_pool> pool;
+
+        explicit pool_allocator(std::shared_ptr<memory_pool> p) : pool{std::move(p)} {}
+
+        template <typename U>
+        pool_allocator(const pool_allocator<U>& other) : pool{other.pool}
+        {}
+
+        T* allocate(size_t n)
+        {
+            if (memory_pool::pooled(n * sizeof(T), alignof(T)))
+                return static_cast<T*>(pool->allocate(n * sizeof(T)));
+            return std::allocator<T>{}.allocate(n);
+        }
+
+        void deallocate(T* p, size_t n) noexcept
+        {
+            if (memory_pool::pooled(n * sizeof(T), alignof(T)))
+                pool->deallocate(p, n * sizeof(T));
+            else
+                std::allocator<T>{}.deallocate(p, n);
+        }
+
+        template <typename U>
+        bool operator==(const pool_allocator<U>& other) const
+        {
+            return pool == other.pool;
+        }
+    };
+
+    // Contiguous containers of single-byte values, such as std::string or std::vector<std::byte>
+    template <typename T>
+    concept ByteContainer = requires(const T& c) {
+        c.data();
+        c.size();
+    } && sizeof(*std::declval<const T&>().data()) == 1;
+
+    template <typename T>
+    concept ByteViewable = requires(const T& c) { std::basic_string_view<std::byte>{c.view()}; };
+
+    /// Intrusively reference counted, immutable buffer of data to be sent, used to keep send data
+    /// alive until it has been sent (datagrams) or acknowledged (streams).  The reference count and
+    /// the owned data (or the object owning the data) share a single allocation which, when small
+    /// enough, comes from an event loop's memory_pool.
+    ///
+    /// Copies are thread-safe, but the send path only ever moves these along, and releasing the
+    /// last reference of a buffer that was never copied doesn't need an atomic read-modify-write,
+    /// which makes it considerably cheaper than a `std::shared_ptr<void>` keep-alive.  A buffer can
+    /// also just carry such a keep-alive (see `wrap`), which costs no allocation at all.
+    class shared_buffer
+    {
+      public:
+        using view_t = std::basic_string_view<std::byte>;
+
+        shared_buffer() = default;
+
+        shared_buffer(const shared_buffer& other) noexcept : h{other.h}, keep_alive{other.keep_alive}
+        {
+            if (h)
+                h->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        shared_buffer(shared_buffer&& other) noexcept :
+                h{std::exchange(other.h, nullptr)}, keep_alive{std::move(other.keep_alive)}
+        {}
+
+        shared_buffer& operator=(const shared_buffer& other) noexcept
+        {
+            if (this != &other)
+                *this = shared_buffer{other};
+            return *this;
+        }
+        shared_buffer& operator=(shared_buffer&& other) noexcept
+        {
+            if (this != &other)
+            {
+                reset();
+                h = std::exchange(other.h, nullptr);
+                keep_alive = std::move(other.keep_alive);
+            }
+            return *this;
+        }
+
+        ~shared_buffer() { reset(); }
+
+        /// Allocates a buffer holding a copy of `data`.  `pool` may be nullptr, in which case (or if
+        /// the data is too large for the pool) the buffer is allocated with operator new.
+        static shared_buffer copy(const std::shared_ptr<memory_pool>& pool, view_t data);
+
+        /// Allocates a buffer that owns a T constructed from `args`.  If T is a contiguous
+        /// container of single-byte values (std::string, std::vector<std::byte>, etc.) then the
+        /// buffer's view() is its contents; otherwise, if T has a `view()` method returning a
+        /// byte view, then the buffer's view() is that.
+        template <typename T, typename... Args>
+        static shared_buffer make(const std::shared_ptr<memory_pool>& pool, Args&&... args)
+        {
+            static_assert(alignof(T) <= alignof(std::max_align_t));
+
+            shared_buffer b;
+            b.h = allocate(pool, sizeof(T));
+            T* obj;
+            try
+            {
+                obj = ::new (b.payload()) T(std::forward<Args>(args)...);
+            }
+            catch (...)
+            {
+                deallocate(std::exchange(b.h, nullptr));
+                throw;
+            }
+            if constexpr (!std::is_trivially_destructible_v<T>)
+                b.h->destroy = [](void* p) noexcept { std::launder(static_cast<T*>(p))->~T(); };
+
+            if constexpr (ByteContainer<T>)
+                b.h->data = view_t{reinterpret_cast<const std::byte*>(obj->data()), obj->size()};
+            else if constexpr (ByteViewable<T>)
+                b.h->data = obj->view();
+
+            return b;
+        }
+
+        /// Wraps a `std::shared_ptr<void>` keep-alive (as accepted by the public send methods) in a
+        /// buffer with an empty view(); the keep-alive is held as is, without allocating.  Returns an
+        /// empty buffer if `keep_alive` is empty.
+        static shared_buffer wrap(std::shared_ptr<void> keep_alive)
+        {
+            shared_buffer b;
+            b.keep_alive = std::move(keep_alive);
+            return b;
+        }
+
+        /// The data owned by this buffer (empty for a null buffer)
+        view_t view() const { return h ? h->data : view_t{}; }
+
+        explicit operator bool() const { return h || keep_alive; }
+
+        // Number of references to this buffer (0 if null)
+        uint32_t use_count() const
+        {
+            return h ? h->refs.load(std::memory_order_relaxed) : static_cast<uint32_t>(keep_alive.use_count());
+        }
+
+        void reset() noexcept
+        {
+            keep_alive.reset();
+            if (!h)
+                return;
+            // If we hold the only reference then nothing else can be copying or releasing it
+            // concurrently, so the (common) last release can skip the atomic decrement.
+            if (h->refs.load(std::memory_order_acquire) == 1 || h->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                deallocate(h);
+            h = nullptr;
+        }
+
+      private:
+        struct header
+        {
+            std::atomic<uint32_t> refs{1};
+            size_t alloc_size;
+            // The pool the header came from, or nullptr if it came from operator new; a plain
+            // pointer as the pool outlives its outstanding blocks anyway
+            memory_pool* pool{nullptr};
+            void (*destroy)(void*) noexcept = nullptr;
+            view_t data;
+        };
+
+        static constexpr size_t header_size =
+                (sizeof(header) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+        header* h{nullptr};
+        // Set instead of `h` by `wrap`
+        std::shared_ptr<void> keep_alive;
+
+        void* payload() const { return reinterpret_cast<std::byte*>(h) + header_size; }
+
+        static header* allocate(const std::shared_ptr<memory_pool>& pool, size_t payload_size);
+        static void deallocate(header* h) noexcept;
+    };
+}  // namespace oxen::quic
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include <thread>
+
+namespace oxen::quic
+{
+    /// Writes qlog (JSON-SEQ) traces, one file per connection, into a directory.  The traces are
+    /// produced on an endpoint's event loop thread and handed to a background writer thread through
+    /// a fixed-size lock-free ring buffer, so that the event loop never waits for the disk: if the
+    /// writer falls so far behind that the buffer fills up then trace records are dropped (and
+    /// counted) instead.  A trace file is always closed once its final record has been written,
+    /// even if that record itself had to be dropped.
+    ///
+    /// `open` and `write` are single-producer: they must only ever be called from one thread at a
+    /// time (in practice, the event loop of the endpoint owning the writer).
+    class QlogWriter
+    {
+      public:
+        // Called by the destructor with the writer thread; if it takes over the thread (returning
+        // true) then the destructor doesn't wait for the writer to finish, and whoever took it
+        // must join it later.  Used to keep the event loop from blocking on the disk when it drops
+        // the last reference to the writer.
+        using join_handoff = std::function<bool(std::thread&)>;
+
+        // Creates `dir` (if needed) and starts the writer thread.  `buffer_size` is rounded up to a
+        // power of two.
+        QlogWriter(std::filesystem::path dir, size_t buffer_size, join_handoff handoff = nullptr);
+
+        // Stops the writer thread once it has written out everything still buffered and closed the
+        // files, and waits for it to do so unless the thread is handed off (see `join_handoff`).
+        ~QlogWriter();
+
+        QlogWriter(const QlogWriter&) = delete;
+        QlogWriter& operator=(const QlogWriter&) = delete;
+
+        // Starts a new trace file, named `name` within the directory; returns the id to write to it
+        // with.
+        uint64_t open(std::string_view name);
+
+        // Appends data to the trace file `id`; if `fin` is set then the file is closed after it.
+        void write(uint64_t id, const void* data, size_t size, bool fin = false);
+
+        // The number of records dropped because the ring buffer was full
+        uint64_t dropped() const;
+
+        const std::filesystem::path& directory() const;
+
+      private:
+        // Everything shared with the writer thread, which keeps it alive until it has finished
+        // writing even if the QlogWriter is gone by then.
+        struct state;
+
+        std::shared_ptr<state> st;
+        uint64_t next_id{0};
+        join_handoff handoff;
+        std::thread writer;
+    };
+}  // namespace oxen::quic
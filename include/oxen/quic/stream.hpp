@@ -6,11 +6,13 @@
 #include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <variant>
 #include <vector>
 
 #include "connection_ids.hpp"
+#include "coro.hpp"
 #include "error.hpp"
 #include "iochannel.hpp"
 #include "opt.hpp"
@@ -80,6 +82,21 @@ namespace oxen::quic
         // Do not call this function from within a watermark callback!
         bool has_watermarks() const;
 
+        /** Coroutine support:
+            - `co_await stream->writable(n)` resumes the coroutine (on the event loop) once no more than `n` bytes of the
+                data sent on the stream remain buffered (i.e. not yet acknowledged by the remote), or once the stream is
+                closed; check `is_closing()` after resuming before sending more.
+            - `on_writable` is the equivalent callback-based interface.
+            - See `stream_reader` for awaiting incoming data.
+        */
+        auto writable(size_t max_buffered = 0)
+        {
+            return make_callback_awaitable<void>(
+                    [this, max_buffered](std::function<void()> done) { on_writable(max_buffered, std::move(done)); });
+        }
+
+        void on_writable(size_t max_buffered, std::function<void()> f);
+
         /** Stream Pause:
             - Applications can call `::pause()` to stop extending the max stream data offset. This has the effect of limiting
                 the inflow by signalling to the sender that they should pause
@@ -124,7 +141,7 @@ namespace oxen::quic
         /// ain't not good enough isn't false.
         virtual void check_timeouts() {}
 
-        void send_impl(bstring_view data, std::shared_ptr<void> keep_alive = nullptr) override;
+        void send_impl(bstring_view data, shared_buffer keep_alive = {}) override;
 
         stream_buffer user_buffers;
 
@@ -160,9 +177,16 @@ namespace oxen::quic
         opt::watermark _high_water;
         opt::watermark _low_water;
 
+        // [max buffered bytes, callback] of pending `on_writable` calls
+        std::vector<std::pair<size_t, std::function<void()>>> writable_waiters;
+
+        // Schedules the `on_writable` callbacks satisfied by the current amount of buffered data;
+        // if `buffered` is nullopt (i.e. the stream is closed) then all of them are scheduled.
+        void notify_writable(std::optional<size_t> buffered);
+
         void wrote(size_t bytes) override;
 
-        void append_buffer(bstring_view buffer, std::shared_ptr<void> keep_alive);
+        void append_buffer(bstring_view buffer, shared_buffer keep_alive);
 
         void acknowledge(size_t bytes);
 
@@ -207,7 +231,7 @@ namespace oxen::quic
 
           private:
             // This is instantiated for each chunk, contains the chunk data itself, and is what we
-            // put into the keep_alive; during destruction, we queue the next chunk.
+            // put into the (pooled) shared_buffer; during destruction, we queue the next chunk.
             struct single_chunk
             {
               private:
@@ -269,12 +293,11 @@ namespace oxen::quic
                     return;
                 }
 
-                auto next = std::make_shared<single_chunk>(*this, std::move(data));
-                auto bsv = next->view();
+                auto next = shared_buffer::make<single_chunk>(str.buffer_pool(), *this, std::move(data));
 #ifndef NDEBUG
-                _chunk_sender_trace(__FILE__, __LINE__, "got chunk to send of size ", bsv.size());
+                _chunk_sender_trace(__FILE__, __LINE__, "got chunk to send of size ", next.view().size());
 #endif
-                str.send(bsv, std::move(next));
+                str.send(std::move(next));
             }
         };
 
@@ -316,4 +339,45 @@ namespace oxen::quic
 
         void set_ready();
     };
+
+    /// Buffers the data received on a stream so that it can be consumed from a coroutine:
+    ///
+    ///     auto reader = std::make_shared<stream_reader>();
+    ///     auto s = conn->open_stream<Stream>(reader->data_callback(), reader->close_callback());
+    ///     while (true)
+    ///     {
+    ///         auto data = co_await reader->read();
+    ///         if (data.empty())
+    ///             break;  // The stream is closed
+    ///         ...
+    ///     }
+    class stream_reader : public std::enable_shared_from_this<stream_reader>
+    {
+      public:
+        stream_data_callback data_callback();
+        stream_close_callback close_callback();
+
+        /// Awaitable that evaluates to all of the data received since the previous read, suspending
+        /// the coroutine until some arrives if there is none yet (in which case the coroutine
+        /// resumes on the event loop).  Evaluates to an empty bstring once the stream is closed and
+        /// all of its data has been read.  Only one read may be outstanding at a time.
+        auto read()
+        {
+            return make_callback_awaitable<bstring>(
+                    [self = shared_from_this()](std::function<void(bstring)> done) { self->on_readable(std::move(done)); });
+        }
+
+        // The application error code the stream was closed with, if it has been closed
+        std::optional<uint64_t> close_code() const;
+
+      private:
+        mutable std::mutex mutex;
+        bstring buffered;
+        std::optional<uint64_t> closed_with;
+        std::function<void(bstring)> waiter;
+
+        void on_readable(std::function<void(bstring)> done);
+        void on_data(bstring_view data);
+        void on_close(uint64_t app_code);
+    };
 }  // namespace oxen::quic
@@ -72,6 +72,7 @@ namespace oxen::quic
                 ;
 
         using receive_callback_t = std::function<void(Packet&& pkt)>;
+        using batch_callback_t = std::function<void()>;
 
         UDPSocket() = delete;
 
@@ -79,10 +80,13 @@ namespace oxen::quic
         /// binding to an any address (or any port) you can retrieve the realized address via
         /// address() after construction.
         ///
-        /// When packets are received they will be fed into the given callback.
+        /// When packets are received they will be fed into the given callback.  If `batch_cb` is
+        /// given then it is called after each batch of received packets (i.e. each recvmmsg call,
+        /// or each wakeup where recvmmsg isn't available) has been fed into `cb`, so that work
+        /// prompted by the packets can be done once per batch rather than once per packet.
         ///
         /// ev_loop must outlive this object.
-        UDPSocket(event_base* ev_loop, const Address& addr, receive_callback_t cb);
+        UDPSocket(event_base* ev_loop, const Address& addr, receive_callback_t cb, batch_callback_t batch_cb = nullptr);
 
         /// Non-copyable and non-moveable
         UDPSocket(const UDPSocket& s) = delete;
@@ -137,6 +141,7 @@ namespace oxen::quic
 
         event_ptr rev_ = nullptr;
         receive_callback_t receive_callback_;
+        batch_callback_t batch_callback_;
         event_ptr wev_ = nullptr;
         std::vector<std::function<void()>> writeable_callbacks_;
     };
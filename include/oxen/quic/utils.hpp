@@ -38,6 +38,8 @@ extern "C"
 #include <string_view>
 #include <unordered_set>
 
+#include "pool.hpp"
+
 namespace oxen::quic
 {
     class connection_interface;
@@ -55,7 +57,9 @@ namespace oxen::quic
     using ustring = std::basic_string<unsigned char>;
     using bstring_view = std::basic_string_view<std::byte>;
     using ustring_view = std::basic_string_view<unsigned char>;
-    using stream_buffer = std::deque<std::pair<bstring_view, std::shared_ptr<void>>>;
+    // Stream send buffers; the deque blocks come from the event loop's memory pool
+    using stream_buffer =
+            std::deque<std::pair<bstring_view, shared_buffer>, pool_allocator<std::pair<bstring_view, shared_buffer>>>;
 
 #ifdef _WIN32
     inline constexpr bool IN_HELL = true;
@@ -124,6 +128,12 @@ namespace oxen::quic
     inline constexpr size_t MAX_PMTUD_UDP_PAYLOAD = NGTCP2_MAX_PMTUD_UDP_PAYLOAD_SIZE;    // 1452
     inline constexpr size_t MAX_GREEDY_PMTUD_UDP_PAYLOAD = (MAX_PMTUD_UDP_PAYLOAD << 1);  // 2904
 
+    // Datagram forward error correction framing (see opt::datagram_fec): every datagram carries a
+    // 4-byte header (group id, index, group size), and parity datagrams additionally carry the XOR of
+    // the lengths of the datagrams they cover.
+    inline constexpr size_t FEC_HEADER_SIZE = 4;
+    inline constexpr size_t FEC_OVERHEAD = FEC_HEADER_SIZE + 2;
+
     // Maximum number of packets we can send in one batch when using sendmmsg/GSO, and maximum we
     // receive in one batch when using recvmmsg.
     inline constexpr size_t DATAGRAM_BATCH_SIZE = 24;
@@ -208,6 +218,15 @@ namespace oxen::quic
 
     std::string str_tolower(std::string s);
 
+    // Transparent string hasher: together with `std::equal_to<>` this lets unordered containers
+    // keyed by std::string be searched with a string_view without constructing a temporary string.
+    struct string_hash
+    {
+        using is_transparent = void;
+
+        size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>{}(s); }
+    };
+
     template <std::integral T>
     constexpr bool increment_will_overflow(T val)
     {
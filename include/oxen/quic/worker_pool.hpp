@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace oxen::quic
+{
+    /// Fixed-size pool of worker threads used to run jobs (such as request handlers) that would
+    /// otherwise block the event loop.  Jobs are started in submission order, but with more than one
+    /// thread they can run concurrently and complete out of order; use a `serial_queue` to run a
+    /// sequence of jobs one at a time.
+    ///
+    /// Destroying the pool runs any still-queued jobs and then joins the worker threads; it must
+    /// therefore not be destroyed from inside one of its own jobs.
+    class WorkerPool
+    {
+      public:
+        // Starts `threads` worker threads; 0 uses the hardware concurrency (and at least 1).
+        explicit WorkerPool(size_t threads = 0);
+        ~WorkerPool();
+
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        void submit(std::function<void()> job);
+
+        size_t size() const { return workers.size(); }
+
+        bool in_worker() const;
+
+      private:
+        std::vector<std::thread> workers;
+        std::mutex jobs_mutex;
+        std::condition_variable jobs_cv;
+        std::queue<std::function<void()>> jobs;
+        bool stopping{false};
+
+        void run();
+    };
+
+    /// Runs the jobs submitted to it one at a time, in submission order.  Queued jobs are run by a
+    /// single draining job on the pool that the first of them was submitted through (rather than
+    /// on the pool each job was submitted through), so all of the jobs of a queue should be
+    /// submitted through the same pool.  Idle serial queues occupy no worker thread.
+    class serial_queue : public std::enable_shared_from_this<serial_queue>
+    {
+      public:
+        void submit(WorkerPool& pool, std::function<void()> job);
+
+      private:
+        std::mutex jobs_mutex;
+        std::queue<std::function<void()>> jobs;
+        bool active{false};
+
+        void drain();
+    };
+}  // namespace oxen::quic
@@ -1,5 +1,7 @@
 #include "btstream.hpp"
 
+#include <algorithm>
+#include <bit>
 #include <stdexcept>
 
 #include "internal.hpp"
@@ -8,7 +10,7 @@ namespace oxen::quic
 {
     inline auto bp_cat = oxen::log::Cat("bparser");
 
-    static std::pair<std::ptrdiff_t, std::size_t> get_location(bstring& data, std::string_view substr)
+    static std::pair<std::ptrdiff_t, std::size_t> get_location(bstring_view data, std::string_view substr)
     {
         auto* bsubstr = reinterpret_cast<const std::byte*>(substr.data());
         // Make sure the given substr actually is a substr of data:
@@ -17,22 +19,38 @@ namespace oxen::quic
     }
 
     message::message(BTRequestStream& bp, bstring req, bool is_timeout) :
-            data{std::move(req)}, return_sender{bp.weak_from_this()}, _rid{bp.reference_id}, timed_out{is_timeout}
+            return_sender{bp.weak_from_this()}, _rid{bp.reference_id}, timed_out{is_timeout}
     {
-        if (!is_timeout)
+        if (!req.empty())
         {
-            oxenc::bt_list_consumer btlc(data);
+            auto owned = std::make_shared<const bstring>(std::move(req));
+            data = *owned;
+            storage = std::move(owned);
+        }
+
+        if (!is_timeout)
+            parse();
+    }
+
+    message::message(BTRequestStream& bp, bstring_view req, std::shared_ptr<const void> owner) :
+            storage{std::move(owner)}, data{req}, return_sender{bp.weak_from_this()}, _rid{bp.reference_id}
+    {
+        parse();
+    }
+
+    void message::parse()
+    {
+        oxenc::bt_list_consumer btlc{convert_sv<char>(data)};
 
-            req_type = get_location(data, btlc.consume_string_view());
-            req_id = btlc.consume_integer<int64_t>();
+        req_type = get_location(data, btlc.consume_string_view());
+        req_id = btlc.consume_integer<int64_t>();
 
-            if (type() == TYPE_COMMAND)
-                ep = get_location(data, btlc.consume_string_view());
+        if (type() == TYPE_COMMAND || type() == TYPE_STREAM_COMMAND)
+            ep = get_location(data, btlc.consume_string_view());
 
-            req_body = get_location(data, btlc.consume_string_view());
+        req_body = get_location(data, btlc.consume_string_view());
 
-            btlc.finish();
-        }
+        btlc.finish();
     }
 
     void message::respond(bstring_view body, bool error) const
@@ -59,7 +77,40 @@ namespace oxen::quic
     {
         log::trace(bp_cat, "{} called", __PRETTY_FUNCTION__);
 
-        send(sent_request{*this, encode_response(rid, body, error), rid}.data);
+        auto encoded = encode_response(rid, body, error);
+
+        if (endpoint.in_event_loop())
+            return send(std::move(encoded));
+
+        // Off the event loop (typically from a worker pool handler): queue the response, and
+        // schedule a flush only if one isn't already pending so that responses produced in quick
+        // succession are handed over to the event loop together.
+        bool schedule;
+        {
+            std::lock_guard lock{queued_responses_mutex};
+            schedule = queued_responses.empty();
+            queued_responses.push_back(std::move(encoded));
+        }
+
+        if (schedule)
+            endpoint.call_soon([wself = weak_from_this()] {
+                if (auto self = wself.lock())
+                    self->flush_responses();
+            });
+    }
+
+    void BTRequestStream::flush_responses()
+    {
+        std::vector<std::string> batch;
+        {
+            std::lock_guard lock{queued_responses_mutex};
+            batch.swap(queued_responses);
+        }
+
+        log::trace(bp_cat, "Sending {} queued response(s)", batch.size());
+
+        for (auto& r : batch)
+            send(std::move(r));
     }
 
     void BTRequestStream::check_timeouts()
@@ -72,13 +123,22 @@ namespace oxen::quic
     {
         log::trace(bp_cat, "{} called", __PRETTY_FUNCTION__);
 
-        while (!sent_reqs.empty())
+        while (!sent_expiries.empty())
         {
-            auto& f = *sent_reqs.front();
-            if (now && !f.is_expired(*now))
+            auto [expiry, rid] = sent_expiries.top();
+            if (now && !(expiry < *now))
                 return;
-            auto ptr = std::move(sent_reqs.front());
-            sent_reqs.pop_front();
+            sent_expiries.pop();
+
+            auto itr = sent_reqs.find(rid);
+            if (itr == sent_reqs.end())
+                continue;  // Already answered
+            if (now && itr->second->expiry > expiry)
+                continue;  // Still receiving a streamed response; there is a later heap entry
+
+            auto ptr = std::move(itr->second);
+            sent_reqs.erase(itr);
+            auto& f = *ptr;
 
             try
             {
@@ -93,14 +153,14 @@ namespace oxen::quic
 
     void BTRequestStream::receive(bstring_view data)
     {
-        log::trace(bp_cat, "bparser recv data callback called!");
+        QUIC_HOT_TRACE(bp_cat, "bparser recv data callback called!");
 
         if (is_closing())
             return;
 
         try
         {
-            process_incoming(to_sv(data));
+            process_incoming(data);
         }
         catch (const std::exception& e)
         {
@@ -120,10 +180,26 @@ namespace oxen::quic
         Stream::close(app_code);
     }
 
-    void BTRequestStream::register_handler(std::string ep, std::function<void(message)> func)
+    void BTRequestStream::register_handler(std::string ep, std::function<void(message)> func, handler_policy policy)
+    {
+        endpoint.call([this, ep = std::move(ep), func = std::move(func), policy = std::move(policy)]() mutable {
+            // Replacing an existing handler keeps its stats
+            auto& handler = func_map[std::move(ep)];
+            handler.func = std::move(func);
+            handler.policy = std::move(policy);
+            handler.streamed = false;
+        });
+    }
+
+    void BTRequestStream::register_stream_handler(
+            std::string ep, std::function<void(message)> func, handler_policy policy)
     {
-        endpoint.call(
-                [this, ep = std::move(ep), func = std::move(func)]() mutable { func_map[std::move(ep)] = std::move(func); });
+        endpoint.call([this, ep = std::move(ep), func = std::move(func), policy = std::move(policy)]() mutable {
+            auto& handler = func_map[std::move(ep)];
+            handler.func = std::move(func);
+            handler.policy = std::move(policy);
+            handler.streamed = true;
+        });
     }
 
     void BTRequestStream::register_generic_handler(std::function<void(message)> request_handler)
@@ -136,54 +212,161 @@ namespace oxen::quic
     {
         log::trace(bp_cat, "{} called to handle {} input", __PRETTY_FUNCTION__, msg.type());
 
-        if (auto type = msg.type(); type == message::TYPE_REPLY || type == message::TYPE_ERROR)
+        auto type = msg.type();
+
+        if (type == message::TYPE_REPLY || type == message::TYPE_ERROR)
         {
             log::trace(log_cat, "Looking for request with req_id={}", msg.req_id);
-            // Iterate using forward iterators, s.t. we go highest (newest) rids to lowest (oldest) rids.
-            // As a result, our comparator checks if the sent request ID is greater thanthan the target rid
-            auto itr = std::lower_bound(
-                    sent_reqs.begin(),
-                    sent_reqs.end(),
-                    msg.req_id,
-                    [](const std::shared_ptr<sent_request>& sr, int64_t rid) { return sr->req_id < rid; });
-
-            if (itr != sent_reqs.end())
+
+            if (auto itr = sent_reqs.find(msg.req_id); itr != sent_reqs.end())
             {
                 log::debug(bp_cat, "Successfully matched response to sent request!");
-                auto req = std::move(*itr);
+                auto req = std::move(itr->second);
                 sent_reqs.erase(itr);
-                try
-                {
-                    req->cb(std::move(msg));
-                }
-                catch (const std::exception& e)
-                {
-                    log::error(bp_cat, "Uncaught exception from response handler: {}", e.what());
-                }
+                complete_request(std::move(req), std::move(msg));
             }
             return;
         }
 
-        // `msg` likely isn't valid in the exception handlers below, so extract what we need to
-        // send a response anyway:
-        const auto req_id = msg.req_id;
-        const auto ep = msg.endpoint_str();
+        if (type == message::TYPE_STREAM_REPLY)
+            return handle_response_chunk(std::move(msg));
+        if (type == message::TYPE_STREAM_COMMAND)
+            return handle_command_chunk(std::move(msg));
+
+        if (!func_map.empty())
+        {
+            if (auto itr = func_map.find(msg.endpoint()); itr != func_map.end())
+            {
+                log::debug(bp_cat, "Executing request endpoint {}", msg.endpoint());
+                return run_handler(itr->second, std::move(msg));
+            }
+        }
+        if (generic_handler)
+        {
+            log::debug(bp_cat, "Executing generic request handler for endpoint {}", msg.endpoint());
+            return invoke_handler(generic_handler, std::move(msg));
+        }
+
+        log::warning(bp_cat, "No handler found for endpoint {}, returning error response", msg.endpoint());
+        respond(msg.req_id, convert_sv<std::byte, char>("Invalid endpoint '{}'"_format(msg.endpoint())), true);
+    }
+
+    void BTRequestStream::complete_request(std::shared_ptr<sent_request> req, message msg)
+    {
         try
         {
-            if (!func_map.empty())
+            req->cb(std::move(msg));
+        }
+        catch (const std::exception& e)
+        {
+            log::error(bp_cat, "Uncaught exception from response handler: {}", e.what());
+        }
+    }
+
+    void BTRequestStream::handle_command_chunk(message msg)
+    {
+        auto rid = msg.req_id;
+        auto [itr, first] = incoming_streams.try_emplace(rid, false);
+
+        if (first)
+        {
+            // Entries only go away with the last chunk of their stream, so without a limit the
+            // remote could grow the map without bound by starting streams it never finishes.
+            if (incoming_streams.size() > MAX_INCOMING_STREAMED_REQS)
             {
-                if (auto itr = func_map.find(ep); itr != func_map.end())
-                {
-                    log::debug(bp_cat, "Executing request endpoint {}", msg.endpoint());
-                    return itr->second(std::move(msg));
-                }
+                incoming_streams.erase(itr);
+                throw std::invalid_argument{
+                        "Too many concurrent streamed requests (max {})"_format(MAX_INCOMING_STREAMED_REQS)};
+            }
+
+            if (auto h = func_map.find(msg.endpoint()); h != func_map.end() && h->second.streamed)
+            {
+                log::debug(bp_cat, "Receiving streamed request {} for endpoint {}", rid, msg.endpoint());
+                itr->second = true;
             }
-            if (generic_handler)
+            else
+            {
+                log::warning(bp_cat, "No stream handler found for endpoint {}, returning error response", msg.endpoint());
+                respond(rid, convert_sv<std::byte, char>("Invalid streamed endpoint '{}'"_format(msg.endpoint())), true);
+            }
+        }
+
+        bool accepted = itr->second;
+        if (msg.is_last_chunk())
+            incoming_streams.erase(itr);
+
+        if (accepted)
+            // Handlers are never removed, so the lookup can't fail if it succeeded for the first chunk
+            run_handler(func_map.find(msg.endpoint())->second, std::move(msg), true);
+    }
+
+    void BTRequestStream::handle_response_chunk(message msg)
+    {
+        auto itr = sent_reqs.find(msg.req_id);
+        if (itr == sent_reqs.end())
+            return;  // Timed out, or we aren't expecting a response
+
+        auto& req = *itr->second;
+
+        if (!msg.is_last_chunk())
+        {
+            // Each chunk restarts the request timeout: the response is still arriving
+            req.expiry = get_time() + req.timeout.value_or(DEFAULT_TIMEOUT);
+            sent_expiries.emplace(req.expiry, req.req_id);
+
+            if (req.chunked)
+                return complete_request(itr->second, std::move(msg));
+
+            auto chunk = msg.body<std::byte>();
+            if (req.partial.size() + chunk.size() <= MAX_REQ_LEN)
             {
-                log::debug(bp_cat, "Executing generic request handler for endpoint {}", msg.endpoint());
-                return generic_handler(std::move(msg));
+                req.partial += chunk;
+                return;
             }
-            throw no_such_endpoint{};
+
+            log::warning(bp_cat, "Streamed response to request {} is too large to be reassembled", req.req_id);
+            auto ptr = std::move(itr->second);
+            sent_reqs.erase(itr);
+            auto err = encode_response(ptr->req_id, "Streamed response exceeds the maximum response size"_bsv, true);
+            return complete_request(std::move(ptr), message{*this, bstring{convert_sv<std::byte>(std::string_view{err})}});
+        }
+
+        auto ptr = std::move(itr->second);
+        sent_reqs.erase(itr);
+
+        if (ptr->chunked)
+            return complete_request(std::move(ptr), std::move(msg));
+
+        // Deliver the reassembled body as if it had been sent as a single response
+        auto full = encode_response(ptr->req_id, ptr->partial, false);
+        ptr->partial.clear();
+        complete_request(std::move(ptr), message{*this, bstring{convert_sv<std::byte>(std::string_view{full})}});
+    }
+
+    void BTRequestStream::run_handler(const registered_handler& handler, message msg, bool ordered)
+    {
+        if (handler.policy.pool)
+            return dispatch_handler(handler, std::move(msg), ordered || handler.policy.ordered);
+
+        // Hold a reference: the handler could replace itself (and thus `handler`)
+        auto counters = handler.counters;
+        auto started = get_time();
+        bool ok = invoke_handler(handler.func, std::move(msg));
+        counters->record(get_time() - started, !ok);
+    }
+
+    bool BTRequestStream::invoke_handler(const std::function<void(message)>& func, message msg)
+    {
+        // `msg` likely isn't valid in the exception handlers below, so extract what we need to
+        // send a response anyway.  Holding on to the request storage keeps the endpoint name valid
+        // without copying it.
+        const auto req_id = msg.req_id;
+        const auto storage = msg.storage;
+        const auto ep = msg.endpoint();
+        try
+        {
+            func(std::move(msg));
+            return true;
         }
         catch (const no_such_endpoint&)
         {
@@ -199,14 +382,149 @@ namespace oxen::quic
                     e.what());
             respond(req_id, "An error occurred while processing the request"_bsv, true);
         }
+        return false;
     }
 
-    void BTRequestStream::process_incoming(std::string_view req)
+    void BTRequestStream::dispatch_handler(const registered_handler& handler, message msg, bool ordered)
     {
-        log::trace(bp_cat, "{} called", __PRETTY_FUNCTION__);
+        // The job holds a reference to the stream so that the handler's responses have somewhere to
+        // go, and a copy of the handler in case it gets replaced while the job is queued.
+        auto job = [self = std::dynamic_pointer_cast<BTRequestStream>(shared_from_this()),
+                    func = handler.func,
+                    counters = handler.counters,
+                    dispatched = get_time(),
+                    msg = std::move(msg)]() mutable {
+            bool ok = self->invoke_handler(func, std::move(msg));
+            counters->record(get_time() - dispatched, !ok);
+        };
+
+        auto& pool = *handler.policy.pool;
+
+        if (!ordered)
+            return pool.submit(std::move(job));
+
+        auto q = std::find_if(
+                handler_queues.begin(), handler_queues.end(), [&pool](const auto& hq) { return hq.first == &pool; });
+        if (q == handler_queues.end())
+            q = handler_queues.insert(q, {&pool, std::make_shared<serial_queue>()});
+        q->second->submit(pool, std::move(job));
+    }
+
+    void BTRequestStream::endpoint_counters::record(std::chrono::nanoseconds latency, bool error)
+    {
+        calls.fetch_add(1, std::memory_order_relaxed);
+        if (error)
+            errors.fetch_add(1, std::memory_order_relaxed);
+
+        auto ns = latency.count();
+        total_latency_ns.fetch_add(ns, std::memory_order_relaxed);
+        auto prev_max = max_latency_ns.load(std::memory_order_relaxed);
+        while (ns > prev_max && !max_latency_ns.compare_exchange_weak(prev_max, ns, std::memory_order_relaxed))
+            ;
+
+        auto us = static_cast<uint64_t>(std::max<int64_t>(ns, 0)) / 1000;
+        auto bucket = std::min<size_t>(std::bit_width(us), endpoint_stats::LATENCY_BUCKETS - 1);
+        latency_histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    endpoint_stats BTRequestStream::endpoint_counters::snapshot() const
+    {
+        endpoint_stats s{};
+        s.calls = calls.load(std::memory_order_relaxed);
+        s.errors = errors.load(std::memory_order_relaxed);
+        s.total_latency = std::chrono::nanoseconds{total_latency_ns.load(std::memory_order_relaxed)};
+        s.max_latency = std::chrono::nanoseconds{max_latency_ns.load(std::memory_order_relaxed)};
+        for (size_t i = 0; i < s.latency_histogram.size(); ++i)
+            s.latency_histogram[i] = latency_histogram[i].load(std::memory_order_relaxed);
+        return s;
+    }
+
+    std::chrono::microseconds endpoint_stats::latency_percentile(double fraction) const
+    {
+        uint64_t counted = 0;
+        for (size_t i = 0; i < latency_histogram.size(); ++i)
+        {
+            counted += latency_histogram[i];
+            if (counted > 0 && counted >= fraction * calls)
+                return std::chrono::microseconds{uint64_t{1} << i};
+        }
+        return std::chrono::duration_cast<std::chrono::microseconds>(max_latency);
+    }
+
+    std::unordered_map<std::string, endpoint_stats> BTRequestStream::handler_stats() const
+    {
+        return endpoint.call_get([this] {
+            std::unordered_map<std::string, endpoint_stats> stats;
+            for (const auto& [ep, handler] : func_map)
+                stats.emplace(ep, handler.counters->snapshot());
+            return stats;
+        });
+    }
+
+    std::optional<endpoint_stats> BTRequestStream::handler_stats(std::string_view ep) const
+    {
+        return endpoint.call_get([this, ep]() -> std::optional<endpoint_stats> {
+            if (auto itr = func_map.find(ep); itr != func_map.end())
+                return itr->second.counters->snapshot();
+            return std::nullopt;
+        });
+    }
+
+    // Returns the number of bytes at the front of `data` that consist entirely of complete,
+    // well-formed length-prefixed requests.  Scanning stops at the first incomplete or malformed
+    // request (malformed input is left for `parse_length` to reject).
+    static size_t complete_requests_prefix(std::string_view data)
+    {
+        size_t extent = 0;
+
+        while (extent < data.size())
+        {
+            auto rest = data.substr(extent);
+            auto pos = rest.substr(0, MAX_REQ_LEN_ENCODED).find(':');
+            if (pos == std::string_view::npos)
+                break;
+
+            size_t len = 0;
+            auto [ptr, ec] = std::from_chars(rest.data(), rest.data() + pos, len);
+            if (ec != std::errc() || ptr != rest.data() + pos || len == 0 || len > MAX_REQ_LEN)
+                break;
+            if (rest.size() - pos - 1 < len)
+                break;
+
+            extent += pos + 1 + len;
+        }
+
+        return extent;
+    }
+
+    void BTRequestStream::process_incoming(bstring_view req)
+    {
+        QUIC_HOT_TRACE(bp_cat, "{} called", __PRETTY_FUNCTION__);
 
         while (not req.empty())
         {
+            if (current_len == 0 && size_buf.empty())
+            {
+                // We are at a request boundary: make a single copy of however many complete requests
+                // are contiguous at the front of the data and hand them all out as views into it.
+                if (auto extent = complete_requests_prefix(convert_sv<char>(req)))
+                {
+                    auto chunk = std::make_shared<const bstring>(req.substr(0, extent));
+                    bstring_view reqs{*chunk};
+
+                    while (not reqs.empty())
+                    {
+                        reqs.remove_prefix(parse_length(convert_sv<char>(reqs)));
+                        auto len = std::exchange(current_len, 0);
+                        handle_input(message{*this, reqs.substr(0, len), chunk});
+                        reqs.remove_prefix(len);
+                    }
+
+                    req.remove_prefix(extent);
+                    continue;
+                }
+            }
+
             if (current_len == 0)
             {
                 size_t consumed = 0;
@@ -214,7 +532,7 @@ namespace oxen::quic
                 if (not size_buf.empty())
                 {
                     size_t prev_len = size_buf.size();
-                    size_buf += req.substr(0, MAX_REQ_LEN_ENCODED);
+                    size_buf += convert_sv<char>(req.substr(0, MAX_REQ_LEN_ENCODED));
 
                     consumed = parse_length(size_buf);
 
@@ -229,7 +547,7 @@ namespace oxen::quic
                     consumed = parse_length(convert_sv<char>(req));
                     if (consumed == 0)
                     {
-                        size_buf += req;
+                        size_buf += convert_sv<char>(req);
                         return;
                     }
 
@@ -239,6 +557,7 @@ namespace oxen::quic
 
             assert(current_len > 0);  // We shouldn't get out of the above without knowing this
 
+            // This request straddles receive chunks, so it has to be accumulated in `buf`.
             if (auto r_size = req.size() + buf.size(); r_size >= current_len)
             {
                 // We have enough data for a complete request, so copy whatever we need to
@@ -247,7 +566,7 @@ namespace oxen::quic
                 if (buf.size() < current_len)
                 {
                     size_t need = current_len - buf.size();
-                    buf += convert_sv<std::byte>(req.substr(0, need));
+                    buf += req.substr(0, need);
                     req.remove_prefix(need);
                 }
 
@@ -263,32 +582,158 @@ namespace oxen::quic
             // Otherwise we don't have enough data on hand for a complete request, so move what we
             // got to the buffer to be processed when the next incoming chunk of data arrives.
             buf.reserve(current_len);
-            buf += convert_sv<std::byte>(req);
+            buf += req;
             return;
         }
     }
 
-    std::string BTRequestStream::encode_command(std::string_view endpoint, int64_t rid, bstring_view body)
+    // Single-pass writer for our length-prefixed bt-encoded lists: the exact encoded size is
+    // computed up front so that the length prefix can be written first and the whole request
+    // (prefix included) built with a single allocation and a single copy of the body.
+    namespace
     {
-        oxenc::bt_list_producer btlp;
+        size_t decimal_digits(uint64_t v)
+        {
+            size_t n = 1;
+            while (v >= 10)
+            {
+                v /= 10;
+                ++n;
+            }
+            return n;
+        }
 
-        btlp.append(message::TYPE_COMMAND);
-        btlp.append(rid);
-        btlp.append(endpoint);
-        btlp.append(body);
+        size_t bt_string_size(size_t len)
+        {
+            return decimal_digits(len) + 1 + len;
+        }
+
+        size_t bt_int_size(int64_t v)
+        {
+            return 2 + (v < 0) + decimal_digits(v < 0 ? -static_cast<uint64_t>(v) : static_cast<uint64_t>(v));
+        }
 
-        return std::move(btlp).str();
+        template <std::integral T>
+        void append_number(std::string& out, T v)
+        {
+            char tmp[24];
+            auto [end, ec] = std::to_chars(std::begin(tmp), std::end(tmp), v);
+            assert(ec == std::errc{});
+            out.append(tmp, end);
+        }
+
+        void append_bt_string(std::string& out, std::string_view s)
+        {
+            append_number(out, s.size());
+            out += ':';
+            out += s;
+        }
+
+        void append_bt_int(std::string& out, int64_t v)
+        {
+            out += 'i';
+            append_number(out, v);
+            out += 'e';
+        }
+
+        // Encodes `l[type][rid]([endpoint])[body]e` prefixed with its length.  If `include_body` is
+        // false the encoding stops right after the body's length prefix.
+        std::string encode_request(
+                std::string_view type, int64_t rid, std::optional<std::string_view> ep, bstring_view body, bool include_body)
+        {
+            size_t list_len = 1 + bt_string_size(type.size()) + bt_int_size(rid) +
+                              (ep ? bt_string_size(ep->size()) : 0) + bt_string_size(body.size()) + 1;
+            size_t total_len = decimal_digits(list_len) + 1 + list_len;
+
+            if (total_len > MAX_REQ_LEN)
+                throw std::invalid_argument{"Request body too long!"};
+
+            std::string out;
+            out.reserve(include_body ? total_len : total_len - body.size() - 1);
+
+            append_number(out, list_len);
+            out += ':';
+            out += 'l';
+            append_bt_string(out, type);
+            append_bt_int(out, rid);
+            if (ep)
+                append_bt_string(out, *ep);
+            append_number(out, body.size());
+            out += ':';
+
+            if (include_body)
+            {
+                out += convert_sv<char>(body);
+                out += 'e';
+                assert(out.size() == total_len);
+            }
+
+            return out;
+        }
+
+        constexpr auto LIST_END = "e"_bsv;
+    }  // namespace
+
+    std::string BTRequestStream::encode_command(std::string_view endpoint, int64_t rid, bstring_view body, bool include_body)
+    {
+        return encode_request(message::TYPE_COMMAND, rid, endpoint, body, include_body);
     }
 
     std::string BTRequestStream::encode_response(int64_t rid, bstring_view body, bool error)
     {
-        oxenc::bt_list_producer btlp;
+        return encode_request(error ? message::TYPE_ERROR : message::TYPE_REPLY, rid, std::nullopt, body, true);
+    }
 
-        btlp.append(error ? message::TYPE_ERROR : message::TYPE_REPLY);
-        btlp.append(rid);
-        btlp.append(body);
+    std::string BTRequestStream::encode_stream_frame(
+            std::string_view type, int64_t rid, const std::optional<std::string>& ep, bstring_view chunk)
+    {
+        return encode_request(type, rid, ep, chunk, true);
+    }
 
-        return std::move(btlp).str();
+    void BTRequestStream::finish_stream(
+            std::string_view type, int64_t rid, const std::optional<std::string>& ep, std::optional<std::string> error)
+    {
+        if (!error)
+            return send(encode_stream_frame(type, rid, ep, {}));
+
+        if (type == message::TYPE_STREAM_REPLY)
+        {
+            log::error(bp_cat, "Streamed response body for request {} failed ({}); returning an error", rid, *error);
+            respond(rid, "An error occurred while processing the request"_bsv, true);
+        }
+        else
+        {
+            // There's no way to signal the failure of a streamed command to the other side short
+            // of closing the stream, so that a truncated body never looks complete.
+            log::error(bp_cat, "Streamed request body for request {} failed ({}); closing stream", rid, *error);
+            close(BPARSER_ERROR_EXCEPTION);
+        }
+    }
+
+    void BTRequestStream::dispatch(std::shared_ptr<sent_request> req)
+    {
+        if (req->cb)
+            endpoint.call([this, r = std::move(req)]() mutable {
+                if (auto* req = add_sent_request(std::move(r)))
+                    send_request(*req);
+            });
+        else if (req->body.empty())
+            send(std::move(req->data));
+        else
+            endpoint.call([this, r = std::move(req)]() { send_request(*r); });
+    }
+
+    void BTRequestStream::send_request(sent_request& req)
+    {
+        assert(endpoint.in_event_loop());
+
+        send(std::move(req.data));
+
+        if (!req.body.empty())
+        {
+            send(req.body, std::move(req.body_keep_alive));
+            send(LIST_END);
+        }
     }
 
     sent_request* BTRequestStream::add_sent_request(std::shared_ptr<sent_request> req)
@@ -313,7 +758,25 @@ namespace oxen::quic
             }
             return nullptr;
         }
-        return sent_reqs.emplace_back(std::move(req)).get();
+
+        // Answered requests leave their heap entry behind until it expires; if those are piling up
+        // (e.g. lots of fast responses to requests with long timeouts) then clear them out.
+        if (sent_expiries.size() >= 64 && sent_expiries.size() > 2 * sent_reqs.size())
+            compact_expiries();
+
+        auto rid = req->req_id;
+        sent_expiries.emplace(req->expiry, rid);
+        return sent_reqs.insert_or_assign(rid, std::move(req)).first->second.get();
+    }
+
+    void BTRequestStream::compact_expiries()
+    {
+        std::vector<expiry_entry> live;
+        live.reserve(sent_reqs.size());
+        for (const auto& [rid, req] : sent_reqs)
+            live.emplace_back(req->expiry, rid);
+
+        sent_expiries = decltype(sent_expiries){std::greater<>{}, std::move(live)};
     }
 
     /** Returns:
@@ -16,6 +16,7 @@
 #include "gnutls_crypto.hpp"
 #include "internal.hpp"
 #include "stream.hpp"
+#include "usdt.hpp"
 #include "utils.hpp"
 
 namespace oxen::quic
@@ -57,7 +58,7 @@ namespace oxen::quic
         static int on_recv_datagram(
                 ngtcp2_conn* /* conn */, uint32_t flags, const uint8_t* data, size_t datalen, void* user_data)
         {
-            log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
+            QUIC_HOT_TRACE(log_cat, "{} called", __PRETTY_FUNCTION__);
             return static_cast<Connection*>(user_data)->recv_datagram(
                     {reinterpret_cast<const std::byte*>(data), datalen}, flags & NGTCP2_STREAM_DATA_FLAG_FIN);
         }
@@ -78,7 +79,7 @@ namespace oxen::quic
                 void* user_data,
                 void* /*stream_user_data*/)
         {
-            log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
+            QUIC_HOT_TRACE(log_cat, "{} called", __PRETTY_FUNCTION__);
             return static_cast<Connection*>(user_data)->stream_receive(
                     stream_id, {reinterpret_cast<const std::byte*>(data), datalen}, flags & NGTCP2_STREAM_DATA_FLAG_FIN);
         }
@@ -91,8 +92,8 @@ namespace oxen::quic
                 void* user_data,
                 void* /*stream_user_data*/)
         {
-            log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
-            log::trace(log_cat, "Ack [{},{}]", offset, offset + datalen);
+            QUIC_HOT_TRACE(log_cat, "{} called", __PRETTY_FUNCTION__);
+            QUIC_HOT_TRACE(log_cat, "Ack [{},{}]", offset, offset + datalen);
             return static_cast<Connection*>(user_data)->stream_ack(stream_id, datalen);
         }
 
@@ -139,12 +140,19 @@ namespace oxen::quic
 
             if (conn->is_inbound())
             {
-                rv = conn->server_handshake_completed();
+                if (rv = conn->server_handshake_completed(); rv != 0)
+                    return rv;
+
+                // Reported as established once the deferred key verification accepts it
+                if (conn->key_verify_pending())
+                    return 0;
 
                 if (conn->conn_established_cb)
                     conn->conn_established_cb(*conn);
                 else
                     conn->endpoint().connection_established(*conn);
+
+                conn->release_held_stream_events();
             }
             else
                 rv = conn->client_handshake_completed();
@@ -168,6 +176,13 @@ namespace oxen::quic
             return 0;
         }
 
+        static void on_qlog_write(void* user_data, uint32_t flags, const void* data, size_t datalen)
+        {
+            auto& conn = *static_cast<Connection*>(user_data);
+            if (conn.qlog_writer)
+                conn.qlog_writer->write(conn.qlog_id, data, datalen, flags & NGTCP2_QLOG_WRITE_FLAG_FIN);
+        }
+
         static void rand_cb(uint8_t* dest, size_t destlen, const ngtcp2_rand_ctx* rand_ctx)
         {
             (void)rand_ctx;
@@ -300,8 +315,7 @@ namespace oxen::quic
             auto& conn = *static_cast<Connection*>(user_data);
             assert(_conn == conn);
 
-            (void)conn;
-            (void)_conn;
+            conn.early_data_rejected();
 
             return 0;
         }
@@ -356,48 +370,169 @@ namespace oxen::quic
         return 0;
     }
 
+    bool Connection::handshake_resumption_state()
+    {
+        _is_resumed = tls_session->is_resumed();
+        _early_data_accepted = tls_session->get_early_data_accepted();
+
+        if (!_is_resumed)
+            return true;
+
+        log::debug(
+                log_cat,
+                "{} resumed TLS session; early data {}",
+                direction_str(),
+                _early_data_accepted ? "accepted" : "not accepted");
+
+        // The handshake carried no certificates, so the cert verify callback was not invoked; the
+        // remote key comes from the resumed session instead.
+        auto* gnutls_session = dynamic_cast<GNUTLSSession*>(get_session());
+        if (!gnutls_session || !gnutls_session->validate_remote_key())
+        {
+            log::warning(log_cat, "{} failed to validate remote key of resumed session", direction_str());
+            return false;
+        }
+
+        if (!gnutls_session->key_verify_deferred())
+            set_validated();
+        return true;
+    }
+
+    void Connection::start_deferred_key_verify()
+    {
+        auto& session = dynamic_cast<GNUTLSSession&>(*tls_session);
+        assert(is_inbound() && session.creds.key_verify_pool);
+
+        _key_verify_pending = true;
+        log::debug(log_cat, "Server running key verify for connection {} on worker pool", reference_id());
+
+        // The job keeps the creds alive, but only weakly refers to the connection and endpoint, either
+        // of which might be gone by the time the verdict is in.  It runs its own copy of the
+        // callback, as the application may replace the creds' callback meanwhile.
+        std::shared_ptr<const GNUTLSCreds> creds{tls_creds, &session.creds};
+        creds->key_verify_pool->submit([creds,
+                                        verify = creds->get_key_verify(),
+                                        key = ustring{session.remote_key()},
+                                        alpn = ustring{session.selected_alpn()},
+                                        wconn = weak_from_this(),
+                                        wep = _endpoint.weak_from_this()] {
+            bool accepted = false;
+            try
+            {
+                if (verify.verify)
+                {
+                    accepted = verify.verify(key, alpn);
+                    creds->verify_cache.put(key, alpn, accepted, verify.cache_generation);
+                }
+                else  // Callback removed since the handshake deferred to us
+                    accepted = true;
+            }
+            catch (const std::exception& e)
+            {
+                log::error(log_cat, "Key verify callback threw: {}; rejecting connection", e.what());
+            }
+
+            if (auto ep = wep.lock())
+                ep->call_soon([wconn, accepted] {
+                    if (auto conn = wconn.lock())
+                        std::static_pointer_cast<Connection>(conn)->finish_deferred_key_verify(accepted);
+                });
+        });
+    }
+
+    void Connection::finish_deferred_key_verify(bool accepted)
+    {
+        _key_verify_pending = false;
+        auto held = std::exchange(held_packets, {});
+
+        if (is_closing() || is_draining())
+            return;
+
+        if (!accepted)
+        {
+            log::warning(log_cat, "Server key verify callback rejected connection {}; closing", reference_id());
+            close_connection(CONN_KEY_VERIFY_FAILED);
+            return;
+        }
+
+        log::debug(
+                log_cat,
+                "Server key verify callback accepted connection {}; processing {} held packet(s)",
+                reference_id(),
+                held.size());
+
+        set_validated();
+
+        if (conn_established_cb)
+            conn_established_cb(*this);
+        else
+            _endpoint.connection_established(*this);
+
+        release_held_stream_events();
+
+        for (auto& pkt : held)
+            handle_conn_packet(pkt);
+    }
+
     int Connection::client_handshake_completed()
     {
-        /** TODO:
-            This section will be uncommented and finished upon completion of 0RTT and session resumption capabilities.
-                - If early data is NOT ACCEPTED, then the call to ngtcp2_conn_tls_early_data_rejected must be invoked
-                to reset aspects of connection state prior to early data rejection.
-                - If early data is ACCEPTED, then we can open streams and start doing things immediately. At that point,
-                we should encode and store 0RTT transport parameters.
-            Moreover, decoding and setting 0RTT transport parameters must be handled in connection creation. Both that
-            location and the required callbacks are comment-blocked in the relevant location.
-        */
-        // if (not tls_session->get_early_data_accepted())
-        //{
-        // log::info(log_cat, "Early data was rejected by server!");
-
-        // if (auto rv = ngtcp2_conn_tls_early_data_rejected(conn.get()); rv != 0)
-        // {
-        //     log::error(log_cat, "ngtcp2_conn_tls_early_data_rejected: {}", ngtcp2_strerror(rv));
-        //     return -1;
-        // }
-        //}
-
-        // ustring data;
-        // data.resize(256);
-
-        // if (auto len = ngtcp2_conn_encode_0rtt_transport_params(conn.get(), data.data(), data.size()); len > 0)
-        // {
-        //     _endpoint.store_0rtt_transport_params(remote_pubkey, data);
-        //     log::info(log_cat, "Client encoded and stored 0rtt transport params");
-        // }
-        // else
-        // {
-        //     log::warning(log_cat, "Client could not encode 0-RTT transport parameters: {}", ngtcp2_strerror(len));
-        // }
+        if (!handshake_resumption_state())
+            return -1;
+
+        // If we attempted 0-RTT and the server didn't accept it then ngtcp2 discards the streams
+        // opened so far (calling back into early_data_rejected() so that we can reopen them).
+        if (_early_data_attempted && !_early_data_accepted)
+        {
+            log::info(log_cat, "Early data was rejected by server!");
+
+            if (auto rv = ngtcp2_conn_tls_early_data_rejected(conn.get()); rv != 0)
+            {
+                log::error(log_cat, "ngtcp2_conn_tls_early_data_rejected: {}", ngtcp2_strerror(rv));
+                return -1;
+            }
+        }
+
+        if (!tls_session->early_data_enabled())
+            return 0;
+
+        ustring data;
+        data.resize(256);
+
+        if (auto len = ngtcp2_conn_encode_0rtt_transport_params(conn.get(), data.data(), data.size()); len > 0)
+        {
+            data.resize(len);
+            _endpoint.store_0rtt_transport_params(resumption_id, std::move(data));
+            log::debug(log_cat, "Client encoded and stored 0rtt transport params");
+        }
+        else
+        {
+            log::warning(log_cat, "Client could not encode 0-RTT transport parameters: {}", ngtcp2_strerror(len));
+        }
 
         return 0;
     }
 
+    void Connection::store_session_ticket(ustring_view ticket)
+    {
+        assert(is_outbound());
+        log::debug(log_cat, "Client storing {}B session ticket from {}", ticket.size(), _path.remote);
+        _endpoint.store_session_ticket(resumption_id, ustring{ticket});
+    }
+
     int Connection::server_handshake_completed()
     {
-        // TODO: uncomment this when 0rtt is implemented
-        // tls_session->send_session_ticket();
+        _endpoint.inbound_handshake_completed(*this);
+
+        if (!handshake_resumption_state())
+            return -1;
+
+        if (auto* gnutls_session = dynamic_cast<GNUTLSSession*>(get_session());
+            gnutls_session && gnutls_session->key_verify_deferred())
+            start_deferred_key_verify();
+
+        // Issue a ticket the client can use to resume (with 0-RTT) its next connection
+        if (tls_session->resumption_enabled() && tls_session->send_session_ticket() != 0)
+            log::warning(log_cat, "Server failed to send session ticket; client will not be able to resume");
 
         auto path = ngtcp2_conn_get_path(conn.get());
         auto now = get_timestamp().count();
@@ -442,7 +577,39 @@ namespace oxen::quic
 
     void Connection::early_data_rejected()
     {
-        close_connection();
+        // ngtcp2 has discarded every stream opened during 0-RTT, along with their stream IDs, but
+        // none of the data sent on them was acknowledged so our Stream objects still hold all of it.
+        // Reopen them, in their original order ahead of any still-pending streams, and send
+        // everything again from the start.
+        log::debug(log_cat, "Reopening {} stream(s) after early data rejection", _streams.size());
+
+        auto streams = std::exchange(_streams, {});
+        std::vector<std::shared_ptr<Stream>> reopen_later;
+
+        for (auto& [id, stream] : streams)
+        {
+            stream->_unacked_size = 0;
+            stream->_sent_fin = false;
+
+            // Once one stream has to wait for stream credit, the later ones have to wait too
+            bool reopened = reopen_later.empty() &&
+                            ngtcp2_conn_open_bidi_stream(conn.get(), &stream->_stream_id, stream.get()) == 0;
+
+            if (reopened)
+            {
+                log::trace(log_cat, "Stream {} reopened as {}", id, stream->_stream_id);
+                _streams[stream->_stream_id] = std::move(stream);
+            }
+            else
+            {
+                stream->_ready = false;
+                reopen_later.push_back(std::move(stream));
+            }
+        }
+
+        pending_streams.insert(pending_streams.begin(), reopen_later.begin(), reopen_later.end());
+
+        packet_io_ready();
     }
 
     void Connection::set_remote_addr(const ngtcp2_addr& new_remote)
@@ -514,23 +681,41 @@ namespace oxen::quic
             return;
         }
 
+        if (_key_verify_pending)
+        {
+            if (held_packets.size() < MAX_HELD_PACKETS)
+            {
+                auto& held = held_packets.emplace_back(pkt.path, bstring{pkt.data()});
+                held.pkt_info = pkt.pkt_info;
+            }
+            else
+                log::debug(log_cat, "Dropping packet for connection {} awaiting key verification", reference_id());
+            return;
+        }
+
         if (read_packet(pkt).success())
-            log::trace(log_cat, "done with incoming packet");
+            QUIC_HOT_TRACE(log_cat, "done with incoming packet");
         else
             log::trace(log_cat, "read packet failed");  // error will be already logged
     }
 
     io_result Connection::read_packet(const Packet& pkt)
     {
-        auto ts = get_timestamp().count();
-        log::trace(log_cat, "Calling ngtcp2_conn_read_pkt...");
+        // Packets of one receive batch all share the batch's timestamp
+        last_io = std::chrono::nanoseconds{_endpoint.rx_time().time_since_epoch()};
+        auto ts = last_io.count();
+        QUIC_HOT_TRACE(log_cat, "Calling ngtcp2_conn_read_pkt...");
         auto data = pkt.data<uint8_t>();
         auto rv = ngtcp2_conn_read_pkt(*this, pkt.path, &pkt.pkt_info, data.data(), data.size(), ts);
 
+        QUIC_PROBE(read_packet, reference_id().id, data.size(), rv);
+
         switch (rv)
         {
             case 0:
-                packet_io_ready();
+                // When reading a batch of received packets, flush once after the whole batch
+                if (!_endpoint.defer_flush(*this))
+                    packet_io_ready();
                 break;
             case NGTCP2_ERR_DRAINING:
                 log::trace(log_cat, "Note: {} is draining; signaling endpoint to drain connection", reference_id());
@@ -607,6 +792,7 @@ namespace oxen::quic
             {
                 log::debug(log_cat, "Stream [ID:{}] ready for broadcast, moving out of pending streams", str->_stream_id);
                 str->set_ready();
+                QUIC_PROBE(stream_open, reference_id().id, str->_stream_id, 0);
                 popped += 1;
                 _streams[str->_stream_id] = std::move(str);
                 pending_streams.pop_front();
@@ -706,6 +892,7 @@ namespace oxen::quic
             {
                 log::debug(log_cat, "Stream {} successfully created; ready to broadcast", stream->_stream_id);
                 stream->set_ready();
+                QUIC_PROBE(stream_open, reference_id().id, stream->_stream_id, 0);
                 auto& strm = _streams[stream->_stream_id];
                 strm = std::move(stream);
                 return strm;
@@ -738,7 +925,22 @@ namespace oxen::quic
 
     void Connection::on_packet_io_ready()
     {
-        auto ts = get_time();
+        // Should this ever run in the middle of a receive batch, it must use the batch's time
+        on_packet_io_ready(_endpoint.rx_time());
+    }
+
+    bool Connection::flush_deferred(std::chrono::steady_clock::time_point now)
+    {
+        rx_flush_pending = false;
+        // As in packet_io_ready(), a reset trigger means the connection is closing/draining/etc.
+        if (!packet_io_trigger)
+            return false;
+        on_packet_io_ready(now);
+        return true;
+    }
+
+    void Connection::on_packet_io_ready(std::chrono::steady_clock::time_point ts)
+    {
         flush_packets(ts);
 
         // If we get a failure (e.g. io error) during flush_packets we might have initiated a
@@ -787,23 +989,24 @@ namespace oxen::quic
     // If pkt_updater is provided then we cancel it when an error (other than a block) occurs.
     bool Connection::send(pkt_tx_timer_updater* pkt_updater)
     {
-        log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
+        QUIC_HOT_TRACE(log_cat, "{} called", __PRETTY_FUNCTION__);
         assert(n_packets > 0 && n_packets <= MAX_BATCH);
 
         if (debug_datagram_flip_flop_enabled)
         {
             debug_datagram_counter += n_packets;
-            log::debug(log_cat, "enable_datagram_flip_flop_test is true; sent packet count: {}", debug_datagram_counter);
+            QUIC_HOT_DEBUG(log_cat, "enable_datagram_flip_flop_test is true; sent packet count: {}", debug_datagram_counter);
         }
 
-        auto rv = endpoint().send_packets(_path, send_buffer.data(), send_buffer_size.data(), send_ecn, n_packets);
+        auto rv = endpoint().send_packets(_path, send_buffer.get(), send_buffer_size.data(), send_ecn, n_packets);
 
         if (rv.blocked())
         {
             assert(n_packets > 0);  // n_packets, buf, bufsize now contain the unsent packets
+            QUIC_PROBE(send_blocked, reference_id().id, n_packets);
             log::debug(log_cat, "Packet send blocked; queuing re-send");
 
-            _endpoint.get_socket()->when_writeable([&ep = _endpoint, connid = reference_id(), this] {
+            _endpoint.when_writeable([&ep = _endpoint, connid = reference_id(), this] {
                 if (!ep.conns.count(connid))
                     return;  // Connection has gone away (and so `this` isn't valid!)
 
@@ -828,7 +1031,7 @@ namespace oxen::quic
             return false;
         }
 
-        log::trace(log_cat, "Packets away!");
+        QUIC_HOT_TRACE(log_cat, "Packets away!");
         return true;
     }
 
@@ -849,7 +1052,7 @@ namespace oxen::quic
             // We're blocked from a previous call, and haven't finished sending all our packets yet
             // so there's nothing to do for now (once the packets are fully sent we'll get called
             // again so that we can keep working on sending).
-            log::debug(log_cat, "Skipping this flush_streams call; we still have {} queued packets", n_packets);
+            QUIC_HOT_DEBUG(log_cat, "Skipping this flush_streams call; we still have {} queued packets", n_packets);
             return;
         }
 
@@ -871,7 +1074,7 @@ namespace oxen::quic
             // if we have datagrams to send, then mix them into the streams
             if (not datagrams->is_empty())
             {
-                log::trace(log_cat, "Datagram channel has things to send");
+                QUIC_HOT_TRACE(log_cat, "Datagram channel has things to send");
                 channels.push_back(datagrams.get());
             }
 
@@ -885,7 +1088,7 @@ namespace oxen::quic
         else if (not datagrams->is_empty())
         {
             // if we have only datagrams to send, then we should probably do that
-            log::trace(log_cat, "Datagram channel has things to send");
+            QUIC_HOT_TRACE(log_cat, "Datagram channel has things to send");
             channels.push_back(datagrams.get());
         }
 
@@ -897,8 +1100,11 @@ namespace oxen::quic
         channels.push_back(pseudo_stream.get());
         auto streams_end_it = std::prev(channels.end());
 
+        if (!send_buffer)
+            send_buffer.reset(new std::byte[MAX_PMTUD_UDP_PAYLOAD * DATAGRAM_BATCH_SIZE]);
+
         ngtcp2_pkt_info pkt_info{};
-        auto* buf_pos = reinterpret_cast<uint8_t*>(send_buffer.data());
+        auto* buf_pos = reinterpret_cast<uint8_t*>(send_buffer.get());
         pkt_tx_timer_updater pkt_updater{*this, ts};
         size_t stream_packets = 0;
 
@@ -906,7 +1112,7 @@ namespace oxen::quic
 
         while (!channels.empty())
         {
-            log::trace(log_cat, "Creating packet {} of max {} batch stream packets", n_packets, MAX_BATCH);
+            QUIC_HOT_TRACE(log_cat, "Creating packet {} of max {} batch stream packets", n_packets, MAX_BATCH);
             int datagram_accepted = std::numeric_limits<int>::min();
             ngtcp2_ssize nwrite = 0;
             ngtcp2_ssize ndatalen;
@@ -929,13 +1135,13 @@ namespace oxen::quic
                 {
                     if (source->is_closing() && !source->sent_fin() && source->unsent() == 0)
                     {
-                        log::trace(log_cat, "Sending FIN");
+                        QUIC_HOT_TRACE(log_cat, "Sending FIN");
                         flags |= NGTCP2_WRITE_STREAM_FLAG_FIN;
                         source->set_fin(true);
                     }
                     else if (bufs.empty())
                     {
-                        log::debug(log_cat, "pending() returned empty buffer for stream ID {}, moving on", stream_id);
+                        QUIC_HOT_DEBUG(log_cat, "pending() returned empty buffer for stream ID {}, moving on", stream_id);
                         continue;
                     }
                 }
@@ -953,7 +1159,7 @@ namespace oxen::quic
                         bufs.size(),
                         ts);
 
-                log::trace(log_cat, "add_stream_data for stream {} returned [{},{}]", stream_id, nwrite, ndatalen);
+                QUIC_HOT_TRACE(log_cat, "add_stream_data for stream {} returned [{},{}]", stream_id, nwrite, ndatalen);
             }
             else  // datagram block
             {
@@ -972,11 +1178,11 @@ namespace oxen::quic
                         dgram.size(),
                         ts);
 
-                log::debug(log_cat, "ngtcp2_conn_writev_datagram returned a value of {}", nwrite);
+                QUIC_HOT_DEBUG(log_cat, "ngtcp2_conn_writev_datagram returned a value of {}", nwrite);
 
                 if (datagram_accepted != 0)
                 {
-                    log::trace(log_cat, "ngtcp2 accepted datagram ID: {} for transmission", dgram.id);
+                    QUIC_HOT_TRACE(log_cat, "ngtcp2 accepted datagram ID: {} for transmission", dgram.id);
                     datagrams->send_buffer.drop_front(prefer_big_first);
                 }
             }
@@ -984,7 +1190,8 @@ namespace oxen::quic
             // congested
             if (nwrite == 0)
             {
-                log::trace(log_cat, "Done writing: connection is congested");
+                QUIC_HOT_TRACE(log_cat, "Done writing: connection is congested");
+                QUIC_PROBE(congested, reference_id().id, stream_id);
                 if (source->is_stream() && stream_id != -1)
                     // we are congested, so clear all pending streams (aside from the -1
                     // pseudo-stream at the end) so that our next call hits the -1 to finish off.
@@ -1007,7 +1214,7 @@ namespace oxen::quic
 
                     if (source->is_stream())
                     {
-                        log::trace(log_cat, "Consumed {} bytes from stream {} and have space left", ndatalen, stream_id);
+                        QUIC_HOT_TRACE(log_cat, "Consumed {} bytes from stream {} and have space left", ndatalen, stream_id);
                         assert(ndatalen >= 0);
                         if (stream_id != -1)
                             source->wrote(ndatalen);
@@ -1030,7 +1237,7 @@ namespace oxen::quic
 
             if (stream_id > -1 && ndatalen > 0)
             {
-                log::trace(log_cat, "consumed {} bytes from stream {}", ndatalen, stream_id);
+                QUIC_HOT_TRACE(log_cat, "consumed {} bytes from stream {}", ndatalen, stream_id);
                 source->wrote(ndatalen);
             }
 
@@ -1042,17 +1249,17 @@ namespace oxen::quic
 
             if (n_packets == MAX_BATCH)
             {
-                log::trace(log_cat, "Sending stream data packet batch");
+                QUIC_HOT_TRACE(log_cat, "Sending stream data packet batch");
                 if (!send(&pkt_updater))
                     return;
 
                 assert(n_packets == 0);
-                buf_pos = reinterpret_cast<uint8_t*>(send_buffer.data());
+                buf_pos = reinterpret_cast<uint8_t*>(send_buffer.get());
             }
 
             if (stream_packets == max_stream_packets)
             {
-                log::trace(log_cat, "Max stream packets ({}) reached", max_stream_packets);
+                QUIC_HOT_TRACE(log_cat, "Max stream packets ({}) reached", max_stream_packets);
                 break;
             }
 
@@ -1080,26 +1287,35 @@ namespace oxen::quic
 
         if (n_packets > 0)
         {
-            log::trace(log_cat, "Sending final packet batch of {} packets", n_packets);
+            QUIC_HOT_TRACE(log_cat, "Sending final packet batch of {} packets", n_packets);
             send(&pkt_updater);
         }
-        log::debug(log_cat, "Exiting flush_streams()");
+        if (stream_packets > 0)
+            last_io = tp.time_since_epoch();
+        QUIC_PROBE(flush_packets, reference_id().id, stream_packets, int{stream_packets == max_stream_packets});
+        QUIC_HOT_DEBUG(log_cat, "Exiting flush_streams()");
     }
 
     void Connection::schedule_packet_retransmit(std::chrono::steady_clock::time_point ts)
     {
-        log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
+        QUIC_HOT_TRACE(log_cat, "{} called", __PRETTY_FUNCTION__);
         ngtcp2_tstamp exp_ns = ngtcp2_conn_get_expiry(conn.get());
 
         if (exp_ns == std::numeric_limits<ngtcp2_tstamp>::max())
         {
             log::info(log_cat, "No retransmit needed right now");
             event_del(packet_retransmit_timer.get());
+            packet_retransmit_due.reset();
             return;
         }
 
         auto delta = static_cast<int64_t>(exp_ns) * 1ns - ts.time_since_epoch();
-        log::trace(log_cat, "Expiry delta: {}ns", delta.count());
+        QUIC_HOT_TRACE(log_cat, "Expiry delta: {}ns", delta.count());
+
+        if (_endpoint.net._loop->stats_enabled())
+            packet_retransmit_due = ts + std::max<std::chrono::nanoseconds>(delta, 0ns);
+        else
+            packet_retransmit_due.reset();
 
         // very rarely, something weird happens and the wakeup time ngtcp2 gives is
         // in the past; if that happens, fire the timer with a 0µs timeout.
@@ -1123,6 +1339,13 @@ namespace oxen::quic
         log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
         log::info(log_cat, "New stream ID:{}", id);
 
+        if (holding_stream_events())
+        {
+            log::debug(log_cat, "Holding stream {} until the remote key has been verified", id);
+            held_stream_events.push_back({held_stream_event::type::OPEN, id});
+            return 0;
+        }
+
         if (auto itr = _stream_queue.find(id); itr != _stream_queue.end())
         {
             log::debug(log_cat, "Taking ready stream from on deck and assigning stream ID {}!", id);
@@ -1133,6 +1356,7 @@ namespace oxen::quic
             [[maybe_unused]] auto [it, ins] = _streams.emplace(id, std::move(s));
             _stream_queue.erase(itr);
             assert(ins);
+            QUIC_PROBE(stream_open, reference_id().id, id, 1);
             return 0;
         }
 
@@ -1141,6 +1365,8 @@ namespace oxen::quic
         stream->_stream_id = id;
         stream->set_ready();
 
+        QUIC_PROBE(stream_open, reference_id().id, id, 1);
+
         log::debug(log_cat, "Local endpoint creating stream to match remote");
 
         if (uint64_t app_err_code = context->stream_open_cb ? context->stream_open_cb(*stream) : 0; app_err_code != 0)
@@ -1180,7 +1406,13 @@ namespace oxen::quic
         auto it = _streams.find(id);
 
         if (it == _streams.end())
+        {
+            if (holding_stream_events())
+                held_stream_events.push_back({held_stream_event::type::CLOSE, id, {}, false, app_code});
             return;
+        }
+
+        QUIC_PROBE(stream_close, reference_id().id, id, app_code);
 
         auto& stream = *it->second;
         stream_execute_close(stream, app_code);
@@ -1246,18 +1478,24 @@ namespace oxen::quic
 
     int Connection::stream_receive(int64_t id, bstring_view data, bool fin)
     {
+        if (holding_stream_events() && !_streams.count(id))
+        {
+            held_stream_events.push_back({held_stream_event::type::DATA, id, bstring{data}, fin});
+            return 0;
+        }
+
         auto str = get_stream(id);
 
         if (data.size() == 0)
         {
-            log::debug(
+            QUIC_HOT_DEBUG(
                     log_cat,
                     "Stream (ID: {}) received empty fin frame, bypassing user-supplied data callback",
                     str->_stream_id);
             return 0;
         }
 
-        log::trace(log_cat, "Stream (ID: {}) received data: {}", id, buffer_printer{data});
+        QUIC_HOT_TRACE(log_cat, "Stream (ID: {}) received data: {}", id, buffer_printer{data});
 
         std::optional<uint64_t> error;
         try
@@ -1316,6 +1554,41 @@ namespace oxen::quic
         return 0;
     }
 
+    void Connection::release_held_stream_events()
+    {
+        if (held_stream_events.empty())
+            return;
+
+        log::debug(
+                log_cat,
+                "Delivering {} held stream event(s) of connection {}",
+                held_stream_events.size(),
+                reference_id());
+
+        for (auto& ev : std::exchange(held_stream_events, {}))
+        {
+            if (is_closing() || is_draining())
+                break;
+
+            switch (ev.kind)
+            {
+                case held_stream_event::type::OPEN:
+                    stream_opened(ev.id);
+                    break;
+                case held_stream_event::type::DATA:
+                    // The stream may already be gone, if the application refused it
+                    if (_streams.count(ev.id))
+                        stream_receive(ev.id, ev.data, ev.fin);
+                    break;
+                case held_stream_event::type::CLOSE:
+                    stream_closed(ev.id, ev.app_code);
+                    break;
+            }
+        }
+
+        packet_io_ready();
+    }
+
     // this callback is defined for debugging datagrams
     int Connection::ack_datagram(uint64_t dgram_id)
     {
@@ -1325,7 +1598,7 @@ namespace oxen::quic
 
     int Connection::recv_datagram(bstring_view data, bool fin)
     {
-        log::trace(log_cat, "Connection (CID: {}) received datagram: {}", _source_cid, buffer_printer{data});
+        QUIC_HOT_TRACE(log_cat, "Connection (CID: {}) received datagram: {}", _source_cid, buffer_printer{data});
 
         std::optional<bstring> maybe_data;
 
@@ -1333,6 +1606,7 @@ namespace oxen::quic
         {
             if (data.size() < 2)
             {
+                QUIC_PROBE(datagram_drop, reference_id().id, usdt::DGRAM_INVALID, data.size());
                 log::warning(log_cat, "Ignoring invalid datagram: too short for packet splitting");
                 return 0;
             }
@@ -1341,7 +1615,7 @@ namespace oxen::quic
             data.remove_prefix(2);
 
             if (dgid % 4 == 0)
-                log::trace(log_cat, "Datagram sent unsplit, bypassing rotating buffer");
+                QUIC_HOT_TRACE(log_cat, "Datagram sent unsplit, bypassing rotating buffer");
             else
             {
                 // send received datagram to rotating_buffer if packet_splitting is enabled
@@ -1350,12 +1624,45 @@ namespace oxen::quic
                 // split datagram did not have a match
                 if (not maybe_data)
                 {
-                    log::trace(log_cat, "Datagram (ID: {}) awaiting counterpart", dgid);
+                    QUIC_HOT_TRACE(log_cat, "Datagram (ID: {}) awaiting counterpart", dgid);
                     return 0;
                 }
             }
         }
 
+        if (datagrams->fec_rx)
+        {
+            auto res = datagrams->fec_rx->receive(maybe_data ? bstring_view{*maybe_data} : data);
+
+            if (res.data)
+                if (auto rv = deliver_datagram(std::move(*res.data)); rv != 0)
+                    return rv;
+
+            if (res.recovered)
+            {
+                QUIC_HOT_TRACE(log_cat, "Connection (CID: {}) recovered lost datagram via FEC", _source_cid);
+                if (auto rv = deliver_datagram(std::move(*res.recovered)); rv != 0)
+                    return rv;
+            }
+        }
+        else
+        {
+            auto rv = deliver_datagram(maybe_data ? std::move(*maybe_data) : bstring{data.begin(), data.end()});
+            if (rv != 0)
+                return rv;
+        }
+
+        if (fin)
+        {
+            log::info(log_cat, "Connection (CID: {}) received fin from remote", _source_cid);
+            // TODO: no clean up, as close cb is called after? Or just for streams
+        }
+
+        return 0;
+    }
+
+    int Connection::deliver_datagram(bstring data)
+    {
         if (!datagrams->dgram_data_cb)
             log::debug(log_cat, "Connection (CID: {}) has no endpoint-supplied datagram data callback", _source_cid);
         else
@@ -1364,7 +1671,7 @@ namespace oxen::quic
 
             try
             {
-                datagrams->dgram_data_cb(*di, (maybe_data ? std::move(*maybe_data) : bstring{data.begin(), data.end()}));
+                datagrams->dgram_data_cb(*di, std::move(data));
                 good = true;
             }
             catch (const std::exception& e)
@@ -1392,12 +1699,6 @@ namespace oxen::quic
             }
         }
 
-        if (fin)
-        {
-            log::info(log_cat, "Connection (CID: {}) received fin from remote", _source_cid);
-            // TODO: no clean up, as close cb is called after? Or just for streams
-        }
-
         return 0;
     }
 
@@ -1406,7 +1707,7 @@ namespace oxen::quic
         return _endpoint.call_get([this]() { return get_session()->selected_alpn(); });
     }
 
-    void Connection::send_datagram(bstring_view data, std::shared_ptr<void> keep_alive)
+    void Connection::send_datagram(bstring_view data, shared_buffer keep_alive)
     {
         log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
 
@@ -1416,6 +1717,11 @@ namespace oxen::quic
         datagrams->send(data, std::move(keep_alive));
     }
 
+    const std::shared_ptr<memory_pool>& Connection::buffer_pool() const
+    {
+        return _endpoint.pool();
+    }
+
     uint64_t Connection::get_streams_available_impl() const
     {
         log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
@@ -1433,6 +1739,9 @@ namespace oxen::quic
         size_t adjustment = DATAGRAM_OVERHEAD + (_packet_splitting ? 2 : 0);
 
         size_t max_dgram_size = multiple * (ngtcp2_conn_get_path_max_tx_udp_payload_size(conn.get()) - adjustment);
+        // FEC framing is applied before splitting, so its overhead comes off the (possibly doubled) total
+        if (_fec_group_size)
+            max_dgram_size -= FEC_OVERHEAD;
         if (max_dgram_size != _last_max_dgram_size)
         {
             _max_dgram_size_changed = true;
@@ -1484,7 +1793,9 @@ namespace oxen::quic
 
         ngtcp2_settings_default(&settings);
 
-        settings.initial_ts = get_timestamp().count();
+        // Inbound connections are created while reading a receive batch, whose packets all get the
+        // batch's timestamp; the connection's initial timestamp mustn't be later than that.
+        settings.initial_ts = std::chrono::nanoseconds{_endpoint.rx_time().time_since_epoch()}.count();
 #ifndef NDEBUG
         settings.log_printf = log_printer;
 #endif
@@ -1562,6 +1873,8 @@ namespace oxen::quic
             _max_streams{context->config.max_streams ? context->config.max_streams : DEFAULT_MAX_BIDI_STREAMS},
             _datagrams_enabled{context->config.datagram_support},
             _packet_splitting{context->config.split_packet},
+            _fec_group_size{context->config.datagram_support ? context->config.fec_group_size : 0},
+            _fec_flush_timeout{context->config.fec_flush_timeout},
             tls_creds{context->tls_creds}
     {
         // If a connection_{established/closed}_callback was passed to IOContext via `Endpoint::{listen,connect}(...)`...
@@ -1596,6 +1909,15 @@ namespace oxen::quic
 
         tls_session = tls_creds->make_session(*this, alpns);
 
+        if (_endpoint.qlog_writer)
+        {
+            qlog_writer = _endpoint.qlog_writer;
+            qlog_id = qlog_writer->open("{}-{}.sqlog"_format(
+                    oxenc::to_hex(_source_cid.data, _source_cid.data + _source_cid.datalen),
+                    is_outbound() ? "client" : "server"));
+            settings.qlog_write = Callbacks::on_qlog_write;
+        }
+
         if (is_outbound())
         {
             callbacks.client_initial = ngtcp2_crypto_client_initial_cb;
@@ -1609,6 +1931,13 @@ namespace oxen::quic
             remote_pubkey = *remote_pk;
             tls_session->set_expected_remote_key(remote_pubkey);
 
+            resumption_id = dynamic_cast<GNUTLSSession&>(*tls_session).creds.pubkey + remote_pubkey;
+            for (const auto& alpn : alpns)
+            {
+                resumption_id += static_cast<unsigned char>(alpn.size());
+                resumption_id += alpn;
+            }
+
             auto maybe_token = _endpoint.get_path_validation_token(remote_pubkey);
             if (maybe_token)
             {
@@ -1616,16 +1945,7 @@ namespace oxen::quic
                 settings.tokenlen = maybe_token->size();
             }
 
-            // TODO: uncomment this with 0RTT resumption
-            // if (auto maybe_params = _endpoint.get_0rtt_transport_params(remote_pubkey))
-            // {
-            //     if (auto rv = ngtcp2_conn_decode_and_set_0rtt_transport_params(
-            //                 conn.get(), maybe_params->data(), maybe_params->size());
-            //         rv != 0)
-            //         log::warning(log_cat, "Client failed to decode and set 0rtt transport params!");
-            //     else
-            //         log::info(log_cat, "Client decoded and set 0rtt transport params!");
-            // }
+            callbacks.early_data_rejected = Callbacks::on_early_data_rejected;
 
             rv = ngtcp2_conn_client_new(
                     &connptr,
@@ -1685,6 +2005,30 @@ namespace oxen::quic
 
         ngtcp2_conn_set_keep_alive_timeout(connptr, std::chrono::nanoseconds{context->config.keep_alive}.count());
 
+        // Resume the session if an earlier connection to this remote left us with a session ticket,
+        // and send 0-RTT stream data if early data is enabled and we have its transport parameters
+        if (is_outbound() && tls_session->resumption_enabled())
+        {
+            if (auto ticket = _endpoint.take_session_ticket(resumption_id);
+                ticket && tls_session->set_resumption_ticket(*ticket))
+            {
+                auto params = tls_session->early_data_enabled() ? _endpoint.get_0rtt_transport_params(resumption_id)
+                                                                : std::nullopt;
+
+                if (!params)
+                    log::debug(log_cat, "Client attempting session resumption");
+                else if (auto rv = ngtcp2_conn_decode_and_set_0rtt_transport_params(
+                                 connptr, params->data(), params->size());
+                         rv != 0)
+                    log::warning(log_cat, "Client failed to decode and set 0rtt transport params: {}", ngtcp2_strerror(rv));
+                else
+                {
+                    _early_data_attempted = true;
+                    log::debug(log_cat, "Client attempting session resumption with 0-RTT");
+                }
+            }
+        }
+
         tls_session->conn_ref.get_conn = get_conn;
         tls_session->conn_ref.user_data = this;
         ngtcp2_conn_set_tls_native_handle(connptr, tls_session->get_session());
@@ -1705,6 +2049,8 @@ namespace oxen::quic
                 0,
                 [](evutil_socket_t, short, void* self_) {
                     auto& self = *static_cast<Connection*>(self_);
+                    if (auto due = std::exchange(self.packet_retransmit_due, std::nullopt))
+                        self._endpoint.net._loop->record_timer_slip(get_time() - *due);
                     if (auto rv = ngtcp2_conn_handle_expiry(self, get_timestamp().count()); rv != 0)
                     {
                         log::debug(log_cat, "Error: expiry handler invocation returned error code: {}", ngtcp2_strerror(rv));
@@ -1757,6 +2103,24 @@ namespace oxen::quic
         return conn;
     }
 
+    void Connection::slim_if_idle(std::chrono::nanoseconds now, std::chrono::nanoseconds idle)
+    {
+        if (now - last_io < idle)
+            return;
+
+        bool released = false;
+        if (send_buffer && n_packets == 0)
+        {
+            send_buffer.reset();
+            released = true;
+        }
+        if (datagrams && datagrams->recv_buffer.release())
+            released = true;
+
+        if (released)
+            log::trace(log_cat, "Released buffers of idle connection {}", reference_id());
+    }
+
     void Connection::check_stream_timeouts()
     {
         for (const auto* s : {&_streams, &_stream_queue})
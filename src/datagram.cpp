@@ -3,6 +3,7 @@
 #include "connection.hpp"
 #include "endpoint.hpp"
 #include "internal.hpp"
+#include "usdt.hpp"
 
 namespace oxen::quic
 {
@@ -15,6 +16,20 @@ namespace oxen::quic
             _packet_splitting(_conn->packet_splitting_enabled())
     {
         log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
+
+        if (auto k = _conn->datagram_fec_group_size())
+        {
+            fec_tx.emplace(k);
+            fec_rx.emplace();
+
+            if (k > 1 && _conn->datagram_fec_flush_timeout() > 0ms)
+                fec_flush_timer.reset(event_new(
+                        endpoint.get_loop().get(),
+                        -1,
+                        0,
+                        [](evutil_socket_t, short, void* self) { static_cast<DatagramIO*>(self)->flush_fec_group(); },
+                        this));
+        }
     }
 
     int64_t DatagramIO::stream_id() const
@@ -59,11 +74,11 @@ namespace oxen::quic
     }
     void DatagramIO::wrote(size_t)
     {
-        log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
+        QUIC_HOT_TRACE(log_cat, "{} called", __PRETTY_FUNCTION__);
     }
     std::vector<ngtcp2_vec> DatagramIO::pending()
     {
-        log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
+        QUIC_HOT_TRACE(log_cat, "{} called", __PRETTY_FUNCTION__);
         return {};
     }
 
@@ -79,10 +94,20 @@ namespace oxen::quic
         ci.send_datagram(data, std::move(keep_alive));
     }
 
-    void DatagramIO::send_impl(bstring_view data, std::shared_ptr<void> keep_alive)
+    void dgram_interface::reply(shared_buffer buf)
+    {
+        ci.send_datagram(std::move(buf));
+    }
+
+    const std::shared_ptr<memory_pool>& dgram_interface::buffer_pool() const
+    {
+        return ci.buffer_pool();
+    }
+
+    void DatagramIO::send_impl(bstring_view data, shared_buffer keep_alive)
     {
         // if packet_splitting is lazy OR packet_splitting is off, send as "normal" datagram
-        endpoint.call([this, data, keep_alive = std::move(keep_alive)]() {
+        endpoint.call([this, data, keep_alive = std::move(keep_alive)]() mutable {
             if (!_conn)
             {
                 log::warning(log_cat, "Unable to send datagram: connection has gone away");
@@ -95,6 +120,7 @@ namespace oxen::quic
             // we use >= instead of > for that just-in-case 1-byte cushion
             if (data.size() > max_size)
             {
+                QUIC_PROBE(datagram_drop, _conn->reference_id().id, usdt::DGRAM_TOO_BIG, data.size());
                 log::warning(
                         log_cat,
                         "Data of length {} cannot be sent with {} datagrams of max size {}",
@@ -114,29 +140,83 @@ namespace oxen::quic
                     _packet_splitting ? "split" : "whole",
                     buffer_printer{data});
 
-            bool split = _packet_splitting && data.size() > max_size / 2;
+            if (fec_tx)
+            {
+                // The FEC overhead was deducted from max_size, so give it back for the framed datagrams
+                const auto wire_max = max_size + FEC_OVERHEAD;
+
+                const bool starts_group = fec_tx->index == 0;
+
+                bstring framed;
+                auto parity = fec_tx->encode(data, framed);
+                auto f = shared_buffer::make<bstring>(buffer_pool(), std::move(framed));
+                auto fv = f.view();
+                queue_datagram(fv, std::move(f), wire_max);
+
+                if (parity)
+                    queue_fec_parity(std::move(*parity), wire_max);
+                else if (starts_group && fec_flush_timer)
+                {
+                    fec_flush_group = fec_tx->group;
+                    auto timeout = _conn->datagram_fec_flush_timeout();
+                    timeval tv{
+                            .tv_sec = static_cast<decltype(timeval::tv_sec)>(timeout / 1s),
+                            .tv_usec = static_cast<decltype(timeval::tv_usec)>((timeout % 1s) / 1us)};
+                    event_add(fec_flush_timer.get(), &tv);
+                }
+            }
+            else
+                queue_datagram(data, std::move(keep_alive), max_size);
+
+            _conn->packet_io_ready();
+        });
+    }
+
+    void DatagramIO::queue_datagram(bstring_view data, shared_buffer keep_alive, size_t max_size)
+    {
+        bool split = _packet_splitting && data.size() > max_size / 2;
+
+        auto dgram_id = _next_dgram_counter << 2;
+        if (split)
+            dgram_id |= 0b10;
+        (++_next_dgram_counter) %= 1 << 14;
 
-            auto dgram_id = _next_dgram_counter << 2;
-            if (split)
-                dgram_id |= 0b10;
-            (++_next_dgram_counter) %= 1 << 14;
+        send_buffer.emplace(data, dgram_id, std::move(keep_alive), split ? dgram::OVERSIZED : dgram::STANDARD, max_size);
+    }
 
-            send_buffer.emplace(data, dgram_id, std::move(keep_alive), split ? dgram::OVERSIZED : dgram::STANDARD, max_size);
+    void DatagramIO::queue_fec_parity(bstring parity, size_t wire_max)
+    {
+        log::trace(log_cat, "Queueing FEC parity datagram for group {}", static_cast<uint16_t>(fec_tx->group - 1));
+        auto p = shared_buffer::make<bstring>(buffer_pool(), std::move(parity));
+        auto pv = p.view();
+        queue_datagram(pv, std::move(p), wire_max);
+    }
 
+    void DatagramIO::flush_fec_group()
+    {
+        // The group we were armed for may have filled up (and a newer one may have started) since
+        if (!_conn || fec_tx->group != fec_flush_group)
+            return;
+
+        const int n = fec_tx->index;
+        if (auto parity = fec_tx->flush())
+        {
+            log::debug(log_cat, "FEC group {} flushed after its timeout with {} datagrams", fec_flush_group, n);
+            queue_fec_parity(std::move(*parity), _conn->get_max_datagram_size_impl() + FEC_OVERHEAD);
             _conn->packet_io_ready();
-        });
+        }
     }
 
     prepared_datagram DatagramIO::pending_datagram(bool r)
     {
-        log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
+        QUIC_HOT_TRACE(log_cat, "{} called", __PRETTY_FUNCTION__);
 
         return send_buffer.prepare(r, _packet_splitting);
     }
 
     std::optional<bstring> DatagramIO::to_buffer(bstring_view data, uint16_t dgid)
     {
-        log::trace(log_cat, "DatagramIO handed datagram with endian swapped ID: {}", dgid);
+        QUIC_HOT_TRACE(log_cat, "DatagramIO handed datagram with endian swapped ID: {}", dgid);
 
         return recv_buffer.receive(data, dgid);
     }
@@ -18,6 +18,7 @@ extern "C"
 #include "connection.hpp"
 #include "internal.hpp"
 #include "types.hpp"
+#include "usdt.hpp"
 #include "utils.hpp"
 
 namespace oxen::quic
@@ -35,6 +36,18 @@ namespace oxen::quic
                 _packet_splitting ? "" : "no");
     }
 
+    void Endpoint::handle_ep_opt(opt::datagram_fec fec)
+    {
+        _fec_group_size = fec.group_size;
+        _fec_flush_timeout = fec.flush_timeout;
+
+        log::trace(
+                log_cat,
+                "User has activated datagram FEC with group size {} (flush timeout: {}ms)",
+                _fec_group_size,
+                _fec_flush_timeout.count());
+    }
+
     void Endpoint::handle_ep_opt(opt::outbound_alpns alpns)
     {
         outbound_alpns = std::move(alpns.alpns);
@@ -85,6 +98,41 @@ namespace oxen::quic
         _manual_routing = std::move(mrouting);
     }
 
+    void Endpoint::handle_ep_opt(opt::qlog q)
+    {
+        // The last reference is usually dropped on the event loop (by a closing connection), which
+        // mustn't wait for the writer to finish flushing; the loop joins it once it stops instead.
+        qlog_writer = std::make_shared<QlogWriter>(
+                std::move(q.directory), q.buffer_size, [loop = std::weak_ptr{net._loop}](std::thread& t) {
+                    auto l = loop.lock();
+                    if (!l || !l->in_event_loop())
+                        return false;
+                    l->join_later(std::move(t));
+                    return true;
+                });
+    }
+
+    void Endpoint::handle_ep_opt(opt::idle_slimming slim)
+    {
+        _idle_slimming = slim.idle;
+    }
+
+    void Endpoint::handle_ep_opt(opt::admission_control ac)
+    {
+        if (ac.ipv4_prefix > 32 || ac.ipv6_prefix > 128)
+            throw std::invalid_argument{"opt::admission_control: invalid source prefix length"};
+        if (ac.initial_rate < 0 || (ac.initial_rate > 0 && ac.initial_burst < 1))
+            throw std::invalid_argument{"opt::admission_control: invalid Initial rate limit"};
+
+        log::trace(
+                log_cat,
+                "User has activated admission control (max half-open: {}, retry threshold: {}, rate: {}/s)",
+                ac.max_half_open,
+                ac.retry_threshold,
+                ac.initial_rate);
+        _admission = ac;
+    }
+
     ConnectionID Endpoint::next_reference_id()
     {
         log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
@@ -105,13 +153,35 @@ namespace oxen::quic
         call([this, packet = std::move(pkt)]() mutable { handle_packet(std::move(packet)); });
     }
 
+    void Endpoint::manually_signal_writeable()
+    {
+        call([this] {
+            // Sends retried from these callbacks may block again, re-queueing themselves
+            auto callbacks = std::exchange(manual_writeable_callbacks, {});
+            log::trace(log_cat, "Manual routing writeable; retrying {} blocked send(s)", callbacks.size());
+            for (auto& cb : callbacks)
+                cb();
+        });
+    }
+
+    void Endpoint::when_writeable(std::function<void()> cb)
+    {
+        if (_manual_routing)
+            manual_writeable_callbacks.push_back(std::move(cb));
+        else
+            socket->when_writeable(std::move(cb));
+    }
+
     void Endpoint::_init_internals()
     {
         if (not _manual_routing)
         {
             log::debug(log_cat, "Starting new UDP socket on {}", _local);
             socket = std::make_unique<UDPSocket>(
-                    get_loop().get(), _local, [this](auto&& packet) { handle_packet(std::move(packet)); });
+                    get_loop().get(),
+                    _local,
+                    [this](auto&& packet) { handle_socket_packet(std::move(packet)); },
+                    [this] { finish_rx_batch(); });
 
             _local = socket->address();
         }
@@ -143,6 +213,8 @@ namespace oxen::quic
         ctx->config.datagram_support = _datagrams;
         ctx->config.split_packet = _packet_splitting;
         ctx->config.policy = _policy;
+        ctx->config.fec_group_size = _fec_group_size;
+        ctx->config.fec_flush_timeout = _fec_flush_timeout;
     }
 
     std::list<std::shared_ptr<connection_interface>> Endpoint::get_all_conns(std::optional<Direction> d)
@@ -188,6 +260,8 @@ namespace oxen::quic
         if (conn.is_draining() || conn.is_closing())
             return;
 
+        half_open_conns.erase(conn.reference_id());
+
         conn.halt_events();
         conn.set_draining();
 
@@ -206,12 +280,77 @@ namespace oxen::quic
         log::debug(log_cat, "Connection ({}) marked as draining", conn.reference_id());
     }
 
+    void Endpoint::handle_socket_packet(Packet&& pkt)
+    {
+        if (!_rx_batch_time)
+            _rx_batch_time = get_time();
+
+        try
+        {
+            handle_packet(std::move(pkt));
+        }
+        catch (...)
+        {
+            // The socket won't get to the end of the batch, so end it here: otherwise rx_time()
+            // would stay frozen at this batch's time, and the connections waiting for the end of
+            // the batch would never be flushed again.
+            finish_rx_batch();
+            throw;
+        }
+    }
+
+    bool Endpoint::defer_flush(Connection& conn)
+    {
+        if (!_rx_batch_time)
+            return false;
+        if (!conn.rx_flush_pending)
+        {
+            conn.rx_flush_pending = true;
+            _rx_batch_conns.push_back(conn.reference_id());
+        }
+        return true;
+    }
+
+    size_t Endpoint::finish_rx_batch()
+    {
+        if (!_rx_batch_time)
+            return 0;
+        _rx_batch_time.reset();
+
+        if (_rx_batch_conns.empty())
+            return 0;
+
+        // Flushing can close connections, so look each one up again rather than holding pointers;
+        // and as the batch is over, nothing gets added to _rx_batch_conns while we do this.
+        auto now = get_time();
+        size_t flushed = 0, i = 0;
+        try
+        {
+            for (; i < _rx_batch_conns.size(); i++)
+                if (auto it = conns.find(_rx_batch_conns[i]); it != conns.end() && it->second->flush_deferred(now))
+                    ++flushed;
+        }
+        catch (...)
+        {
+            // Don't leave the connections we didn't get to marked as pending, or they would never
+            // be queued for a flush again
+            for (i++; i < _rx_batch_conns.size(); i++)
+                if (auto it = conns.find(_rx_batch_conns[i]); it != conns.end())
+                    it->second->rx_flush_pending = false;
+            _rx_batch_conns.clear();
+            throw;
+        }
+        _rx_batch_conns.clear();
+        return flushed;
+    }
+
     void Endpoint::handle_packet(Packet&& pkt)
     {
         auto dcid_opt = handle_packet_connid(pkt);
 
         if (!dcid_opt)
         {
+            QUIC_PROBE(packet_lookup, _local.port(), usdt::LOOKUP_INVALID, pkt.data().size());
             log::warning(log_cat, "Error: initial packet handling failed");
             return;
         }
@@ -219,7 +358,7 @@ namespace oxen::quic
         auto& dcid = *dcid_opt;
 
         // check existing conns
-        log::trace(log_cat, "Incoming connection ID: {}", dcid);
+        QUIC_HOT_TRACE(log_cat, "Incoming connection ID: {}", dcid);
 
         auto cptr = fetch_associated_conn(dcid);
 
@@ -231,20 +370,27 @@ namespace oxen::quic
 
                 if (!cptr)
                 {
-                    log::warning(log_cat, "Error: connection could not be created");
+                    QUIC_PROBE(packet_lookup, _local.port(), usdt::LOOKUP_REFUSED, pkt.data().size());
+                    // Not necessarily an error: we may have sent a Retry, or refused the Initial
+                    log::debug(log_cat, "Connection was not created for incoming Initial");
                     return;
                 }
 
+                QUIC_PROBE(packet_lookup, _local.port(), usdt::LOOKUP_ACCEPTED, pkt.data().size());
                 initial_association(*cptr);
             }
             else
             {
+                QUIC_PROBE(packet_lookup, _local.port(), usdt::LOOKUP_UNKNOWN, pkt.data().size());
                 log::info(log_cat, "Dropping packet; unknown connection ID to endpoint not accepting inbound conns");
                 return;
             }
         }
         else
-            log::debug(log_cat, "Found associated connection to incoming DCID!");
+        {
+            QUIC_PROBE(packet_lookup, _local.port(), usdt::LOOKUP_FOUND, pkt.data().size());
+            QUIC_HOT_DEBUG(log_cat, "Found associated connection to incoming DCID!");
+        }
 
         if (cptr->is_outbound())
             // For a inbound packet on an outbound connection the packet handling code will have set
@@ -313,6 +459,7 @@ namespace oxen::quic
         // mark connection as closing so that if we re-enter we won't try closing a second time
         conn.set_closing();
         conn.halt_events();
+        half_open_conns.erase(conn.reference_id());
 
         if (ec.ngtcp2_code() == NGTCP2_ERR_IDLE_CLOSE)
         {
@@ -349,7 +496,13 @@ namespace oxen::quic
         ngtcp2_pkt_info pkt_info{};
 
         auto written = ngtcp2_conn_write_connection_close(
-                conn, nullptr, &pkt_info, u8data(buf), buf.size(), &err, get_timestamp().count());
+                conn,
+                nullptr,
+                &pkt_info,
+                u8data(buf),
+                buf.size(),
+                &err,
+                std::chrono::nanoseconds{rx_time().time_since_epoch()}.count());
 
         if (written <= 0)
         {
@@ -387,6 +540,7 @@ namespace oxen::quic
         const auto& rid = conn.reference_id();
 
         conn.halt_events();
+        half_open_conns.erase(rid);
 
         log::debug(log_cat, "Deleting associated CIDs for connection ({})", rid);
 
@@ -421,28 +575,31 @@ namespace oxen::quic
         }
     }
 
-    int Endpoint::validate_anti_replay(ustring key, ustring data, time_t /* exp */)
+    void Endpoint::store_session_ticket(ustring resumption_id, ustring ticket)
     {
-        if (auto itr = anti_replay_db.find(key); itr != anti_replay_db.end())
-        {
-            auto& entry = itr->second;
+        session_tickets.insert_or_assign(std::move(resumption_id), std::move(ticket));
+    }
 
-            if (entry == data)
-                return GNUTLS_E_DB_ENTRY_EXISTS;
+    std::optional<ustring> Endpoint::take_session_ticket(const ustring& resumption_id)
+    {
+        if (auto itr = session_tickets.find(resumption_id); itr != session_tickets.end())
+        {
+            auto ticket = std::move(itr->second);
+            session_tickets.erase(itr);
+            return ticket;
         }
 
-        anti_replay_db[std::move(key)] = std::move(data);
-        return 0;
+        return std::nullopt;
     }
 
-    void Endpoint::store_0rtt_transport_params(ustring remote_pk, ustring encoded_params)
+    void Endpoint::store_0rtt_transport_params(ustring resumption_id, ustring encoded_params)
     {
-        encoded_transport_params.insert_or_assign(remote_pk, std::move(encoded_params));
+        encoded_transport_params.insert_or_assign(std::move(resumption_id), std::move(encoded_params));
     }
 
-    std::optional<ustring> Endpoint::get_0rtt_transport_params(ustring remote_pk)
+    std::optional<ustring> Endpoint::get_0rtt_transport_params(const ustring& resumption_id)
     {
-        if (auto itr = encoded_transport_params.find(remote_pk); itr != encoded_transport_params.end())
+        if (auto itr = encoded_transport_params.find(resumption_id); itr != encoded_transport_params.end())
             return itr->second;
 
         return std::nullopt;
@@ -649,6 +806,85 @@ namespace oxen::quic
         return std::nullopt;
     }
 
+    void Endpoint::inbound_handshake_completed(Connection& conn)
+    {
+        half_open_conns.erase(conn.reference_id());
+    }
+
+    admission_stats Endpoint::get_admission_stats()
+    {
+        return call_get([this] {
+            auto stats = _admission_stats;
+            stats.half_open = half_open_conns.size();
+            return stats;
+        });
+    }
+
+    bool Endpoint::take_initial_token(const Address& source)
+    {
+        // Mask the source down to its prefix, treating IPv4-mapped IPv6 addresses as IPv4
+        std::pair<uint64_t, uint64_t> prefix{0, 0};
+        if (source.is_ipv4() || source.is_ipv4_mapped_ipv6())
+        {
+            uint32_t a;
+            if (source.is_ipv4())
+                a = oxenc::big_to_host(source.in4().sin_addr.s_addr);
+            else
+                a = oxenc::load_big_to_host<uint32_t>(source.in6().sin6_addr.s6_addr + 12);
+            auto bits = _admission.ipv4_prefix;
+            a = bits == 0 ? 0 : a & (~uint32_t{0} << (32 - bits));
+            prefix.second = (uint64_t{0xffff} << 32) | a;
+        }
+        else
+        {
+            const auto* b = source.in6().sin6_addr.s6_addr;
+            auto hi = oxenc::load_big_to_host<uint64_t>(b);
+            auto lo = oxenc::load_big_to_host<uint64_t>(b + 8);
+            auto bits = _admission.ipv6_prefix;
+            hi = bits == 0 ? 0 : bits >= 64 ? hi : hi & (~uint64_t{0} << (64 - bits));
+            lo = bits <= 64 ? 0 : bits == 128 ? lo : lo & (~uint64_t{0} << (128 - bits));
+            prefix = {hi, lo};
+        }
+
+        const auto now = get_time();
+        const auto rate = _admission.initial_rate;
+        const auto burst = _admission.initial_burst;
+        auto refill = [&](initial_bucket& b) {
+            b.tokens = std::min(burst, b.tokens + rate * std::chrono::duration<double>{now - b.updated}.count());
+            b.updated = now;
+        };
+
+        auto it = initial_buckets.find(prefix);
+        if (it == initial_buckets.end())
+        {
+            if (initial_buckets.size() >= MAX_ADMISSION_PREFIXES && now - last_bucket_sweep >= 1s)
+            {
+                // Forget prefixes whose buckets have refilled: they behave just like new ones
+                last_bucket_sweep = now;
+                for (auto i = initial_buckets.begin(); i != initial_buckets.end();)
+                {
+                    refill(i->second);
+                    if (i->second.tokens >= burst)
+                        i = initial_buckets.erase(i);
+                    else
+                        ++i;
+                }
+            }
+            if (initial_buckets.size() >= MAX_ADMISSION_PREFIXES)
+                return true;
+
+            it = initial_buckets.emplace(prefix, initial_bucket{burst, now}).first;
+        }
+        else
+            refill(it->second);
+
+        if (it->second.tokens < 1)
+            return false;
+
+        it->second.tokens -= 1;
+        return true;
+    }
+
     void Endpoint::connection_established(connection_interface& conn)
     {
         log::trace(log_cat, "Connection established, calling user callback ({})", conn.reference_id());
@@ -708,7 +944,9 @@ namespace oxen::quic
         }
         if (hdr.type == NGTCP2_PKT_0RTT)
         {
-            log::error(log_cat, "0RTT is under development in this implementation; dropping packet");
+            // 0-RTT packets that arrive ahead of their connection's Initial can't be processed;
+            // the client will retransmit their data.
+            log::debug(log_cat, "Dropping 0-RTT packet for unknown connection");
             return nullptr;
         }
 
@@ -752,6 +990,34 @@ namespace oxen::quic
             }
         }
 
+        // Admission control: everything here happens before any connection state is allocated
+        if (_admission.retry_threshold && token_type == NGTCP2_TOKEN_TYPE_UNKNOWN &&
+            half_open_conns.size() >= _admission.retry_threshold)
+        {
+            log::debug(log_cat, "{} handshakes in progress; sending Retry to {}", half_open_conns.size(), pkt.path.remote);
+            _admission_stats.retried++;
+            send_retry(pkt, &hdr);
+            return nullptr;
+        }
+
+        if (_admission.initial_rate > 0 && !take_initial_token(pkt.path.remote))
+        {
+            log::debug(log_cat, "Dropping Initial from {}: source prefix is over its rate limit", pkt.path.remote);
+            _admission_stats.rejected_rate_limited++;
+            return nullptr;
+        }
+
+        if (_admission.max_half_open && half_open_conns.size() >= _admission.max_half_open)
+        {
+            log::debug(
+                    log_cat,
+                    "Dropping Initial from {}: {} handshakes in progress",
+                    pkt.path.remote,
+                    half_open_conns.size());
+            _admission_stats.rejected_half_open++;
+            return nullptr;
+        }
+
         log::debug(log_cat, "Constructing path using packet path: {}", pkt.path);
 
         assert(in_event_loop());
@@ -779,6 +1045,14 @@ namespace oxen::quic
                             token_type,
                             pkt_original_cid);
 
+                    // Until it hears back from us, the client keeps addressing its packets
+                    // (including any 0-RTT packets) to the DCID it chose for its Initial.
+                    if (!conn_lookup.count(quic_cid{hdr.dcid}))
+                        associate_cid(&hdr.dcid, *it_b->second);
+
+                    half_open_conns.insert(next_rid);
+                    _admission_stats.accepted++;
+
                     return it_b->second.get();
                 }
             }
@@ -787,14 +1061,9 @@ namespace oxen::quic
 
     io_result Endpoint::send_packets(const Path& path, std::byte* buf, size_t* bufsize, uint8_t ecn, size_t& n_pkts)
     {
-        log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
-
-        if (_manual_routing)
-        {
-            return _manual_routing(path, bstring_view{buf, *bufsize}, n_pkts);
-        }
+        QUIC_HOT_TRACE(log_cat, "{} called", __PRETTY_FUNCTION__);
 
-        if (!socket)
+        if (not _manual_routing and !socket)
         {
             log::warning(log_cat, "Cannot send packets on closed socket ({})", path);
             return io_result{EBADF};
@@ -802,9 +1071,10 @@ namespace oxen::quic
 
         assert(n_pkts >= 1 && n_pkts <= MAX_BATCH);
 
-        log::trace(log_cat, "Sending {} UDP packet(s) {}...", n_pkts, path);
+        QUIC_HOT_TRACE(log_cat, "Sending {} {} packet(s) {}...", n_pkts, _manual_routing ? "manually routed" : "UDP", path);
 
-        auto [ret, sent] = socket->send(path, buf, bufsize, ecn, n_pkts);
+        auto [ret, sent] = _manual_routing ? _manual_routing(path, buf, bufsize, ecn, n_pkts)
+                                           : socket->send(path, buf, bufsize, ecn, n_pkts);
 
         if (ret.failure() && !ret.blocked())
         {
@@ -816,12 +1086,12 @@ namespace oxen::quic
         if (sent < n_pkts)
         {
             if (sent == 0)  // Didn't send *any* packets, i.e. we got entirely blocked
-                log::debug(log_cat, "UDP sent none of {}", n_pkts);
+                log::debug(log_cat, "Sent none of {}", n_pkts);
 
             else
             {
                 // We sent some but not all, so shift the unsent packets back to the beginning of buf/bufsize
-                log::debug(log_cat, "UDP undersent {}/{}", sent, n_pkts);
+                log::debug(log_cat, "Undersent {}/{}", sent, n_pkts);
                 size_t offset = std::accumulate(bufsize, bufsize + sent, size_t{0});
                 size_t len = std::accumulate(bufsize + sent, bufsize + n_pkts, size_t{0});
                 std::memmove(buf, buf + offset, len);
@@ -857,9 +1127,9 @@ namespace oxen::quic
         size_t bufsize = buf.size();
         auto res = send_packets(p, buf.data(), &bufsize, ecn, n_pkts);
 
-        if (res.blocked() and not _manual_routing)
+        if (res.blocked())
         {
-            socket->when_writeable([this, p, buf = std::move(buf), ecn, cb = std::move(callback)]() mutable {
+            when_writeable([this, p, buf = std::move(buf), ecn, cb = std::move(callback)]() mutable {
                 send_or_queue_packet(p, std::move(buf), ecn, std::move(cb));
             });
         }
@@ -923,6 +1193,13 @@ namespace oxen::quic
         // Propagate the timeout check to connections, to be propagated to streams
         for (auto& [cid, conn] : conns)
             conn->check_stream_timeouts();
+
+        if (_idle_slimming)
+        {
+            auto ts = get_timestamp();
+            for (auto& [cid, conn] : conns)
+                conn->slim_if_idle(ts, *_idle_slimming);
+        }
     }
 
     std::shared_ptr<connection_interface> Endpoint::get_conn(ConnectionID rid)
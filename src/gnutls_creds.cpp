@@ -58,7 +58,7 @@ namespace oxen::quic
 
             //  true: Peer provided a valid cert; connection is accepted and marked validated
             //  false: Peer either provided an invalid cert or no cert; connection is rejected
-            if (success = tls_session->validate_remote_key(); success)
+            if (success = tls_session->validate_remote_key(); success && !tls_session->key_verify_deferred())
                 conn->set_validated();
 
             auto err = "Quic {} was {}able to validate peer certificate; {} connection!"_format(
@@ -88,7 +88,8 @@ namespace oxen::quic
             log::warning(log_cat, "Privkey import failed!");
     }
 
-    GNUTLSCreds::GNUTLSCreds(std::string_view ed_seed, std::string_view ed_pubkey) : using_raw_pk{true}
+    GNUTLSCreds::GNUTLSCreds(std::string_view ed_seed, std::string_view ed_pubkey) :
+            using_raw_pk{true}, pubkey{convert_sv<unsigned char>(ed_pubkey)}
     {
         log::trace(log_cat, "Initializing GNUTLSCreds from Ed25519 keypair");
 
@@ -141,14 +142,219 @@ namespace oxen::quic
         }
 
         gnutls_certificate_set_verify_function(cred, cert_verify_callback_gnutls);
+
+        if (auto rv = gnutls_anti_replay_init(&anti_replay); rv < 0)
+        {
+            log::warning(log_cat, "gnutls_anti_replay_init failed: {}", gnutls_strerror(rv));
+            throw std::runtime_error("gnutls anti-replay context initialization failed");
+        }
+        gnutls_anti_replay_set_add_function(anti_replay, anti_replay_db_add_func);
+        gnutls_anti_replay_set_ptr(anti_replay, this);
     }
 
     GNUTLSCreds::~GNUTLSCreds()
     {
         log::trace(log_cat, "Entered {}", __PRETTY_FUNCTION__);
+        gnutls_anti_replay_deinit(anti_replay);
         gnutls_certificate_free_credentials(cred);
     }
 
+    bool anti_replay_window::add(ustring_view key, time_t expiry, time_t now)
+    {
+        std::lock_guard lock{mutex};
+
+        expire(now);
+
+        auto skey = to_sv(key);
+        if (seen.count(skey))
+            return false;
+
+        if (entries.size() >= max_entries)
+        {
+            log::warning(log_cat, "Anti-replay record is full ({} entries); refusing early data", entries.size());
+            return false;
+        }
+
+        auto& [exp, k] = entries.emplace_back(expiry, skey);
+        seen.insert(k);
+        return true;
+    }
+
+    size_t anti_replay_window::size() const
+    {
+        std::lock_guard lock{mutex};
+        return entries.size();
+    }
+
+    void anti_replay_window::expire(time_t now)
+    {
+        while (!entries.empty() && entries.front().first <= now)
+        {
+            seen.erase(entries.front().second);
+            entries.pop_front();
+        }
+    }
+
+    void key_verify_cache::configure(size_t max_entries_, std::chrono::seconds ttl_)
+    {
+        std::lock_guard lock{mutex};
+        max_entries = max_entries_;
+        ttl = ttl_;
+        ++gen;
+        index.clear();
+        lru.clear();
+    }
+
+    std::optional<bool> key_verify_cache::get(ustring_view key, ustring_view alpn, clock::time_point now)
+    {
+        std::lock_guard lock{mutex};
+
+        if (max_entries == 0)
+            return std::nullopt;
+
+        std::string id;
+        id.reserve(key.size() + alpn.size());
+        id += to_sv(key);
+        id += to_sv(alpn);
+
+        auto it = index.find(id);
+        if (it == index.end())
+        {
+            ++misses;
+            return std::nullopt;
+        }
+
+        auto entry_it = it->second;
+        if (entry_it->expiry <= now)
+        {
+            index.erase(it);
+            lru.erase(entry_it);
+            ++misses;
+            return std::nullopt;
+        }
+
+        lru.splice(lru.begin(), lru, entry_it);
+        ++hits;
+        return entry_it->verdict;
+    }
+
+    void key_verify_cache::put(ustring_view key, ustring_view alpn, bool verdict, uint64_t gen_, clock::time_point now)
+    {
+        std::lock_guard lock{mutex};
+
+        if (max_entries == 0 || gen_ != gen)
+            return;
+
+        std::string id;
+        id.reserve(key.size() + alpn.size());
+        id += to_sv(key);
+        id += to_sv(alpn);
+
+        if (auto it = index.find(id); it != index.end())
+        {
+            auto entry_it = it->second;
+            entry_it->verdict = verdict;
+            entry_it->expiry = now + ttl;
+            lru.splice(lru.begin(), lru, entry_it);
+            return;
+        }
+
+        while (lru.size() >= max_entries)
+        {
+            index.erase(lru.back().id);
+            lru.pop_back();
+        }
+
+        lru.push_front(entry{std::move(id), verdict, now + ttl});
+        index.emplace(lru.front().id, lru.begin());
+    }
+
+    void key_verify_cache::clear()
+    {
+        std::lock_guard lock{mutex};
+        ++gen;
+        index.clear();
+        lru.clear();
+    }
+
+    uint64_t key_verify_cache::generation() const
+    {
+        std::lock_guard lock{mutex};
+        return gen;
+    }
+
+    bool key_verify_cache::enabled() const
+    {
+        std::lock_guard lock{mutex};
+        return max_entries > 0;
+    }
+
+    key_verify_cache_stats key_verify_cache::stats() const
+    {
+        std::lock_guard lock{mutex};
+        return {hits, misses, lru.size()};
+    }
+
+    bool GNUTLSCreds::verify_remote_key(ustring_view key, ustring_view alpn) const
+    {
+        auto [verify, gen] = get_key_verify();
+        if (!verify)
+            return true;
+
+        if (auto verdict = verify_cache.get(key, alpn))
+        {
+            log::trace(log_cat, "Using cached key verify verdict ({})", *verdict ? "accept" : "reject");
+            return *verdict;
+        }
+
+        // Not holding any lock while the callback runs, so concurrent handshakes from the same
+        // uncached key may each call it; the last verdict is the one cached.
+        bool verdict = verify(key, alpn);
+        verify_cache.put(key, alpn, verdict, gen);
+        return verdict;
+    }
+
+    session_ticket_key::session_ticket_key() : created{get_time()}
+    {
+        if (auto rv = gnutls_session_ticket_key_generate(&key); rv != 0)
+        {
+            auto err = "Server failed to generate session ticket key: {}"_format(gnutls_strerror(rv));
+            log::error(log_cat, "{}", err);
+            throw std::runtime_error{err};
+        }
+    }
+
+    session_ticket_key::~session_ticket_key()
+    {
+        gnutls_free(key.data);
+    }
+
+    std::shared_ptr<const session_ticket_key> GNUTLSCreds::current_ticket_key()
+    {
+        std::lock_guard lock{ticket_key_mutex};
+
+        if (!ticket_key || get_time() - ticket_key->created >= ticket_key_rotation)
+        {
+            log::debug(log_cat, "{} session ticket key", ticket_key ? "Rotating" : "Generating");
+            ticket_key = std::make_shared<const session_ticket_key>();
+        }
+
+        return ticket_key;
+    }
+
+    void GNUTLSCreds::rotate_ticket_key()
+    {
+        auto key = std::make_shared<const session_ticket_key>();
+        std::lock_guard lock{ticket_key_mutex};
+        ticket_key = std::move(key);
+    }
+
+    void GNUTLSCreds::set_ticket_key_rotation(std::chrono::seconds interval)
+    {
+        std::lock_guard lock{ticket_key_mutex};
+        ticket_key_rotation = interval;
+    }
+
     std::shared_ptr<GNUTLSCreds> GNUTLSCreds::make_from_ed_keys(std::string_view seed, std::string_view pubkey)
     {
         // would use make_shared, but I want GNUTLSCreds' constructor to be private
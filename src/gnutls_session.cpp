@@ -6,27 +6,28 @@
 namespace oxen::quic
 {
     /*
-        Client session resumption requires:
-            gnutls_session_set_data to be called in TLSsession creation
-            gnutls_session_get_data2 to be called in hook function after handshake completion
+        Client session resumption:
+            gnutls_session_get_data2 is called in the hook function when the server sends a new
+            session ticket; the ticket is stored in the endpoint, keyed by the server's pubkey
+            gnutls_session_set_data is called (via set_resumption_ticket) in Connection creation
+            when the endpoint holds a ticket for the remote
     */
 
     extern "C"
     {
-        int anti_replay_db_add_func(void* dbf, time_t exp_time, const gnutls_datum_t* key, const gnutls_datum_t* data)
+        // Called by GnuTLS for every ClientHello carrying early data; returning an error makes
+        // GnuTLS reject the early data (the handshake itself continues).
+        int anti_replay_db_add_func(
+                void* dbf, time_t exp_time, const gnutls_datum_t* key, const gnutls_datum_t* /* data */)
         {
-            auto* ep = static_cast<Endpoint*>(dbf);
-            assert(ep);
+            auto* creds = static_cast<GNUTLSCreds*>(dbf);
+            assert(creds);
 
-            log::warning(log_cat, "0RTT session resumption is not available; callback is no-op");
-            return 0;
-
-            (void)exp_time;
-            (void)key;
-            (void)data;
-            (void)ep;
+            if (creds->anti_replay_db.add({key->data, key->size}, exp_time))
+                return 0;
 
-            // return ep->validate_anti_replay({key->data, key->size}, {data->data, data->size}, exp_time);
+            log::debug(log_cat, "Server refusing early data from replayed (or unrecordable) ClientHello");
+            return GNUTLS_E_DB_ENTRY_EXISTS;
         }
 
         int client_hook_func(
@@ -39,8 +40,16 @@ namespace oxen::quic
             if (htype == GNUTLS_HANDSHAKE_NEW_SESSION_TICKET)
             {
                 auto* conn = get_connection_from_gnutls(session);
-                auto& ep = conn->endpoint();
-                (void)ep;
+
+                gnutls_datum_t ticket{};
+                if (auto rv = gnutls_session_get_data2(session, &ticket); rv != 0)
+                {
+                    log::warning(log_cat, "gnutls_session_get_data2 failed: {}", gnutls_strerror(rv));
+                    return 0;
+                }
+
+                conn->store_session_ticket({ticket.data, ticket.size});
+                gnutls_free(ticket.data);
             }
 
             return 0;
@@ -68,32 +77,18 @@ namespace oxen::quic
     {
         log::trace(log_cat, "Entered {}", __PRETTY_FUNCTION__);
 
-        if (not is_client)
-            gnutls_anti_replay_deinit(anti_replay);
-
         gnutls_deinit(session);
-        gnutls_free(session_ticket_key.data);
     }
 
     GNUTLSSession::GNUTLSSession(
             GNUTLSCreds& creds, Connection& c, const std::vector<ustring>& alpns, std::optional<gnutls_key> expected_key) :
-            creds{creds}, session_ticket_key{}, is_client{c.is_outbound()}
+            creds{creds}, is_client{c.is_outbound()}
     {
         log::trace(log_cat, "Entered {}", __PRETTY_FUNCTION__);
 
-        if (not is_client)
-        {
-            gnutls_anti_replay_init(&anti_replay);
-            gnutls_anti_replay_set_add_function(anti_replay, anti_replay_db_add_func);
-            gnutls_anti_replay_set_ptr(anti_replay, &c.endpoint());
-
-            if (auto rv = gnutls_session_ticket_key_generate(&session_ticket_key); rv != 0)
-            {
-                auto err = "Server failed to generate session ticket key: {}"_format(gnutls_strerror(rv));
-                log::error(log_cat, "{}", err);
-                throw std::runtime_error{err};
-            }
-        }
+        // The ticket key and anti-replay context are shared by every server session of the creds
+        if (not is_client && creds.session_resumption)
+            ticket_key = creds.current_ticket_key();
 
         if (expected_key)
             _expected_remote_key = *expected_key;
@@ -103,7 +98,9 @@ namespace oxen::quic
 
         uint32_t init_flags = is_client ? GNUTLS_CLIENT : GNUTLS_SERVER | GNUTLS_NO_AUTO_SEND_TICKET;
 
-        init_flags |= GNUTLS_ENABLE_EARLY_DATA | GNUTLS_NO_END_OF_EARLY_DATA;
+        init_flags |= GNUTLS_NO_END_OF_EARLY_DATA;
+        if (early_data_enabled())
+            init_flags |= GNUTLS_ENABLE_EARLY_DATA;
 
         // DISCUSS: we actually don't want to do this if the requested certificate is expecting
         // x509 (see gnutls_creds.cpp::cert_retrieve_callback_gnutls function body)
@@ -144,11 +141,14 @@ namespace oxen::quic
         {
             log::trace(log_cat, "gnutls configuring server session...");
 
-            if (auto rv = gnutls_session_ticket_enable_server(session, &session_ticket_key); rv != 0)
+            if (ticket_key)
             {
-                auto err = "gnutls_session_ticket_enable_server failed: {}"_format(gnutls_strerror(rv));
-                log::error(log_cat, "{}", err);
-                throw std::runtime_error{err};
+                if (auto rv = gnutls_session_ticket_enable_server(session, &ticket_key->key); rv != 0)
+                {
+                    auto err = "gnutls_session_ticket_enable_server failed: {}"_format(gnutls_strerror(rv));
+                    log::error(log_cat, "{}", err);
+                    throw std::runtime_error{err};
+                }
             }
 
             if (auto rv = ngtcp2_crypto_gnutls_configure_server_session(session); rv < 0)
@@ -157,8 +157,11 @@ namespace oxen::quic
                 throw std::runtime_error("ngtcp2_crypto_gnutls_configure_client_session failed");
             }
 
-            gnutls_anti_replay_enable(session, anti_replay);
-            gnutls_record_set_max_early_data_size(session, 0xffffffffu);
+            if (early_data_enabled())
+            {
+                gnutls_anti_replay_enable(session, creds.anti_replay);
+                gnutls_record_set_max_early_data_size(session, 0xffffffffu);
+            }
 
             // server always requests cert from client
             gnutls_certificate_server_set_request(session, GNUTLS_CERT_REQUIRE);
@@ -171,6 +174,10 @@ namespace oxen::quic
                 log::warning(log_cat, "ngtcp2_crypto_gnutls_configure_client_session failed: {}", ngtcp2_strerror(rv));
                 throw std::runtime_error("ngtcp2_crypto_gnutls_configure_client_session failed");
             }
+
+            if (creds.session_resumption)
+                gnutls_handshake_set_hook_function(
+                        session, GNUTLS_HANDSHAKE_NEW_SESSION_TICKET, GNUTLS_HOOK_POST, client_hook_func);
         }
 
         gnutls_session_set_ptr(session, &conn_ref);
@@ -236,6 +243,19 @@ namespace oxen::quic
         return 0;
     }
 
+    bool GNUTLSSession::set_resumption_ticket(ustring_view ticket)
+    {
+        assert(is_client);
+
+        if (auto rv = gnutls_session_set_data(session, ticket.data(), ticket.size()); rv != 0)
+        {
+            log::warning(log_cat, "gnutls_session_set_data failed: {}", gnutls_strerror(rv));
+            return false;
+        }
+
+        return true;
+    }
+
     ustring_view GNUTLSSession::selected_alpn()
     {
         gnutls_datum_t proto;
@@ -344,19 +364,32 @@ namespace oxen::quic
         else
         {  // Server does validation through callback
             auto alpn = selected_alpn();
+            bool has_key_verify = static_cast<bool>(creds.get_key_verify().verify);
 
             log::debug(
                     log_cat,
                     "Quic {}: {} key verify callback{}",
                     local_name,
-                    creds.key_verify ? "calling" : "did not provide",
-                    creds.key_verify ? "" : "; accepting connection");
+                    has_key_verify ? "calling" : "did not provide",
+                    has_key_verify ? "" : "; accepting connection");
 
             // Key verify cb will return true on success, false on fail. Since this is only called if a client has
             // provided a certificate and is only called by the server, we can assume the following returns:
             //      true: the certificate was verified, and the connection is marked as validated
             //      false: the certificate was not verified, and the connection is rejected
-            success = (creds.key_verify) ? creds.key_verify(_remote_key.view(), alpn) : true;
+            if (has_key_verify && creds.key_verify_pool)
+            {
+                if (auto verdict = creds.verify_cache.get(_remote_key.view(), alpn))
+                    return *verdict;
+
+                // Accept for now; the Connection runs the callback on the pool once the handshake
+                // completes, and holds off on the connection until it has the verdict.
+                log::debug(log_cat, "Quic {}: deferring key verify callback to worker pool", local_name);
+                _key_verify_deferred = true;
+                return true;
+            }
+
+            success = creds.verify_remote_key(_remote_key.view(), alpn);
 
             return success;
         }
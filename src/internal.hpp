@@ -17,6 +17,28 @@ namespace oxen::quic
 
     void logger_config(std::string out = "stderr", log::Type type = log::Type::Print, log::Level reset = log::Level::trace);
 
+// Trace and debug logging on per-packet/per-buffer hot paths goes through these macros rather than
+// log::trace/log::debug: when the level is below the LIBQUIC_MAX_LOG_LEVEL build option (i.e. the
+// OXEN_LIBQUIC_MAX_LOG_LEVEL numeric log::Level value) the statement, including the construction
+// of its arguments, is compiled out entirely rather than merely filtered at runtime.
+#ifndef OXEN_LIBQUIC_MAX_LOG_LEVEL
+#define OXEN_LIBQUIC_MAX_LOG_LEVEL 0
+#endif
+
+#define QUIC_HOT_TRACE(...)                                                                      \
+    do                                                                                           \
+    {                                                                                            \
+        if constexpr (OXEN_LIBQUIC_MAX_LOG_LEVEL <= static_cast<int>(::oxen::log::Level::trace)) \
+            ::oxen::log::trace(__VA_ARGS__);                                                     \
+    } while (0)
+
+#define QUIC_HOT_DEBUG(...)                                                                      \
+    do                                                                                           \
+    {                                                                                            \
+        if constexpr (OXEN_LIBQUIC_MAX_LOG_LEVEL <= static_cast<int>(::oxen::log::Level::debug)) \
+            ::oxen::log::debug(__VA_ARGS__);                                                     \
+    } while (0)
+
     inline constexpr size_t MAX_BATCH =
 #if defined(OXEN_LIBQUIC_UDP_SENDMMSG) || defined(OXEN_LIBQUIC_UDP_GSO)
             DATAGRAM_BATCH_SIZE;
@@ -11,6 +11,11 @@ namespace oxen::quic
         log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
     }
 
+    const std::shared_ptr<memory_pool>& IOChannel::buffer_pool() const
+    {
+        return endpoint.pool();
+    }
+
     bool IOChannel::is_empty() const
     {
         return call_get_accessor(&IOChannel::is_empty_impl);
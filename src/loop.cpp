@@ -228,6 +228,20 @@ namespace oxen::quic
 
         if (loop_thread and loop_thread->joinable())
             loop_thread->join();
+
+        std::vector<std::thread> retired;
+        {
+            std::lock_guard lock{retired_mutex};
+            retired.swap(retired_threads);
+        }
+        for (auto& t : retired)
+            t.join();
+    }
+
+    void Loop::join_later(std::thread t)
+    {
+        std::lock_guard lock{retired_mutex};
+        retired_threads.push_back(std::move(t));
     }
 
     void Loop::clear_old_tickers()
@@ -293,12 +307,141 @@ namespace oxen::quic
             job_queue.swap(swapped_queue);
         }
 
+        if (not stats_enabled())
+        {
+            while (not swapped_queue.empty())
+            {
+                auto job = swapped_queue.front();
+                swapped_queue.pop();
+                job();
+            }
+            return;
+        }
+
+        // Accumulated locally so that we only take the stats lock once per batch
+        auto queued = swapped_queue.size();
+        std::array<uint64_t, loop_stats::job_time_bounds.size() + 1> job_times{};
+        std::chrono::nanoseconds job_time_max{0};
+
         while (not swapped_queue.empty())
         {
             auto job = swapped_queue.front();
             swapped_queue.pop();
+
+            auto started = get_time();
             job();
+            std::chrono::nanoseconds elapsed = get_time() - started;
+
+            size_t bucket = 0;
+            while (bucket < loop_stats::job_time_bounds.size() && elapsed >= loop_stats::job_time_bounds[bucket])
+                bucket++;
+            job_times[bucket]++;
+            job_time_max = std::max(job_time_max, elapsed);
+        }
+
+        std::lock_guard lock{stats_mutex};
+        _stats.jobs += queued;
+        _stats.job_queue_high_water = std::max(_stats.job_queue_high_water, queued);
+        for (size_t i = 0; i < job_times.size(); i++)
+            _stats.job_times[i] += job_times[i];
+        _stats.job_time_max = std::max(_stats.job_time_max, job_time_max);
+    }
+
+    void Loop::enable_stats(bool enable, std::chrono::milliseconds probe_interval, std::chrono::milliseconds log_interval)
+    {
+        if (enable && probe_interval <= 0ms)
+            throw std::invalid_argument{"Loop statistics probe interval must be positive"};
+
+        call_get([&] {
+            stats_probe.reset();
+            {
+                std::lock_guard lock{stats_mutex};
+                _stats = {};
+            }
+            _stats_enabled = enable;
+
+            if (not enable)
+                return;
+
+            stats_probe_interval = probe_interval;
+            stats_log_interval = log_interval;
+            stats_last_log = get_time();
+            stats_probe.reset(event_new(
+                    ev_loop.get(),
+                    -1,
+                    0,
+                    [](evutil_socket_t, short, void* self) { static_cast<Loop*>(self)->stats_probe_fired(); },
+                    this));
+            arm_stats_probe();
+        });
+    }
+
+    loop_stats Loop::get_stats() const
+    {
+        std::lock_guard lock{stats_mutex};
+        return _stats;
+    }
+
+    void Loop::arm_stats_probe()
+    {
+        stats_probe_due = get_time() + stats_probe_interval;
+        auto tv = loop_time_to_timeval(stats_probe_interval);
+        event_add(stats_probe.get(), &tv);
+    }
+
+    void Loop::stats_probe_fired()
+    {
+        auto now = get_time();
+        std::chrono::nanoseconds lag = std::max<std::chrono::nanoseconds>(now - stats_probe_due, 0ns);
+
+        {
+            std::lock_guard lock{stats_mutex};
+            _stats.lag_samples++;
+            _stats.lag_total += lag;
+            _stats.lag_max = std::max(_stats.lag_max, lag);
+        }
+
+        if (stats_log_interval > 0us && now - stats_last_log >= stats_log_interval)
+        {
+            stats_last_log = now;
+            log::info(ev_cat, "Event loop stats: {}", get_stats());
         }
+
+        arm_stats_probe();
+    }
+
+    void Loop::record_timer_slip(std::chrono::nanoseconds slip)
+    {
+        slip = std::max(slip, 0ns);
+        std::lock_guard lock{stats_mutex};
+        _stats.timers++;
+        _stats.timer_slip_total += slip;
+        _stats.timer_slip_max = std::max(_stats.timer_slip_max, slip);
+    }
+
+    std::string loop_stats::to_string() const
+    {
+        auto us = [](std::chrono::nanoseconds ns) { return ns.count() / 1000.0; };
+
+        std::string hist;
+        for (size_t i = 0; i < job_times.size(); i++)
+            hist += "{}{}{}µs: {}"_format(
+                    i ? ", " : "",
+                    i < job_time_bounds.size() ? "<" : ">=",
+                    job_time_bounds[std::min(i, job_time_bounds.size() - 1)].count(),
+                    job_times[i]);
+
+        return "{} jobs (queue high water {}; {}; max {:.1f}µs); loop lag avg {:.1f}µs, max {:.1f}µs; "
+               "timer slip avg {:.1f}µs, max {:.1f}µs over {} timers"_format(
+                       jobs,
+                       job_queue_high_water,
+                       hist,
+                       us(job_time_max),
+                       lag_samples ? us(lag_total) / lag_samples : 0.0,
+                       us(lag_max),
+                       timers ? us(timer_slip_total) / timers : 0.0,
+                       us(timer_slip_max),
+                       timers);
     }
 
 }  //  namespace oxen::quic
@@ -1,27 +1,33 @@
 #include "messages.hpp"
 
+#include <algorithm>
+#include <bit>
+
 #include "connection.hpp"
 #include "datagram.hpp"
 #include "endpoint.hpp"
 #include "internal.hpp"
+#include "opt.hpp"
 
 namespace oxen::quic
 {
-    rotating_buffer::rotating_buffer(DatagramIO& d) : datagram{d}, bufsize{d.rbufsize}, rowsize{d.rbufsize / 4}
-    {
-        for (auto& v : buf)
-            v.resize(rowsize);
-    }
+    rotating_buffer::rotating_buffer(DatagramIO& d) : datagram{d}, bufsize{d.rbufsize}, rowsize{d.rbufsize / 4} {}
 
     std::optional<bstring> rotating_buffer::receive(bstring_view data, uint16_t dgid)
     {
-        log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
+        QUIC_HOT_TRACE(log_cat, "{} called", __PRETTY_FUNCTION__);
 
         assert(datagram.endpoint.in_event_loop());
         assert(datagram._conn);
 
+        // The rows are only allocated once we actually get a split datagram (and can be released
+        // again by `release()`)
+        if (buf[0].empty())
+            for (auto& v : buf)
+                v.resize(rowsize);
+
         auto idx = dgid >> 2;
-        log::trace(
+        QUIC_HOT_TRACE(
                 log_cat,
                 "dgid: {}, row: {}, col: {}, idx: {}, rowsize: {}, bufsize {}",
                 dgid,
@@ -40,17 +46,17 @@ namespace oxen::quic
         {
             if (datagram._conn->debug_datagram_drop_enabled)
             {
-                log::debug(log_cat, "enable_datagram_drop_test is true, inducing packet loss");
+                QUIC_HOT_DEBUG(log_cat, "enable_datagram_drop_test is true, inducing packet loss");
                 datagram._conn->debug_datagram_counter++;
-                log::debug(log_cat, "test counter: {}", datagram._conn->debug_datagram_counter);
+                QUIC_HOT_DEBUG(log_cat, "test counter: {}", datagram._conn->debug_datagram_counter);
                 return std::nullopt;
             }
             else
             {
-                log::debug(log_cat, "enable_datagram_drop_test is false, skipping optional logic");
+                QUIC_HOT_DEBUG(log_cat, "enable_datagram_drop_test is false, skipping optional logic");
             }
 
-            log::trace(
+            QUIC_HOT_TRACE(
                     log_cat,
                     "Pairing datagram (ID: {}) with {} half at buffer pos [{},{}]",
                     dgid,
@@ -78,7 +84,7 @@ namespace oxen::quic
         }
 
         // Otherwise: new piece
-        log::trace(log_cat, "Storing datagram (ID: {}) at buffer pos [{},{}]", dgid, row, col);
+        QUIC_HOT_TRACE(log_cat, "Storing datagram (ID: {}) at buffer pos [{},{}]", dgid, row, col);
 
         b = std::make_unique<received_datagram>(dgid, data);
         currently_held[row] += 1;
@@ -95,7 +101,7 @@ namespace oxen::quic
         return std::nullopt;
     }
 
-    void buffer_que::emplace(bstring_view pload, uint16_t p_id, std::shared_ptr<void> data, dgram type, size_t max_size)
+    void buffer_que::emplace(bstring_view pload, uint16_t p_id, shared_buffer data, dgram type, size_t max_size)
     {
         auto d_storage = datagram_storage::make(pload, p_id, std::move(data), type, max_size);
 
@@ -136,6 +142,20 @@ namespace oxen::quic
                 b.reset();
     }
 
+    bool rotating_buffer::release()
+    {
+        if (buf[0].empty())
+            return false;
+
+        if (auto held = datagrams_stored())
+            log::debug(log_cat, "Releasing datagram reassembly buffer; dropping {} unmatched split datagram(s)", held);
+
+        for (auto& v : buf)
+            std::vector<std::unique_ptr<received_datagram>>{}.swap(v);
+        currently_held.fill(0);
+        return true;
+    }
+
     int rotating_buffer::datagrams_stored() const
     {
         return std::accumulate(currently_held.begin(), currently_held.end(), 0);
@@ -158,7 +178,7 @@ namespace oxen::quic
 
     prepared_datagram buffer_que::prepare(bool b, int is_splitting)
     {
-        log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
+        QUIC_HOT_TRACE(log_cat, "{} called", __PRETTY_FUNCTION__);
 
         prepared_datagram d{};
 
@@ -179,7 +199,7 @@ namespace oxen::quic
         d.bufs[d.bufs_len - 1].base = const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(out.data.data()));
         d.bufs[d.bufs_len - 1].len = out.data.size();
 
-        log::trace(
+        QUIC_HOT_TRACE(
                 log_cat,
                 "Preparing datagram (id: {}) payload (size: {}): {}",
                 out.id,
@@ -190,7 +210,7 @@ namespace oxen::quic
     }
 
     datagram_storage datagram_storage::make(
-            bstring_view pload, uint16_t d_id, std::shared_ptr<void> data, dgram type, size_t max_size)
+            bstring_view pload, uint16_t d_id, shared_buffer data, dgram type, size_t max_size)
     {
         if (type == dgram::STANDARD)
             return datagram_storage(pload, d_id, std::move(data));
@@ -205,4 +225,201 @@ namespace oxen::quic
         return datagram_storage(first_half, second_half, d_id, d_id + 1, std::move(data));
     }
 
+
+    void xor_into(std::byte* dst, const std::byte* src, size_t len)
+    {
+        size_t i = 0;
+
+        // Word-at-a-time XOR; memcpy keeps this free of alignment/aliasing issues while still letting
+        // the compiler turn the loop into SIMD loads/stores.
+        for (; i + sizeof(uint64_t) <= len; i += sizeof(uint64_t))
+        {
+            uint64_t a, b;
+            std::memcpy(&a, dst + i, sizeof(a));
+            std::memcpy(&b, src + i, sizeof(b));
+            a ^= b;
+            std::memcpy(dst + i, &a, sizeof(a));
+        }
+
+        for (; i < len; ++i)
+            dst[i] ^= src[i];
+    }
+
+    std::optional<bstring> fec_encoder::encode(bstring_view data, bstring& out)
+    {
+        assert(data.size() <= std::numeric_limits<uint16_t>::max());
+
+        out.resize(FEC_HEADER_SIZE + data.size());
+        oxenc::write_host_as_big(group, out.data());
+        out[2] = static_cast<std::byte>(index);
+        out[3] = static_cast<std::byte>(group_size);
+        std::memcpy(out.data() + FEC_HEADER_SIZE, data.data(), data.size());
+
+        if (parity.size() < data.size())
+            parity.resize(data.size(), std::byte{0});
+        xor_into(parity.data(), data.data(), data.size());
+        len_xor ^= static_cast<uint16_t>(data.size());
+
+        if (++index < group_size)
+            return std::nullopt;
+
+        return finish_group();
+    }
+
+    std::optional<bstring> fec_encoder::flush()
+    {
+        if (index == 0)
+            return std::nullopt;
+        return finish_group();
+    }
+
+    bstring fec_encoder::finish_group()
+    {
+        // `index` is the number of data datagrams in the group: group_size unless flushed early
+        bstring p;
+        p.resize(FEC_OVERHEAD + parity.size());
+        oxenc::write_host_as_big(group, p.data());
+        p[2] = static_cast<std::byte>(index);
+        p[3] = static_cast<std::byte>(index);
+        oxenc::write_host_as_big(len_xor, p.data() + FEC_HEADER_SIZE);
+        std::memcpy(p.data() + FEC_OVERHEAD, parity.data(), parity.size());
+
+        ++group;
+        index = 0;
+        len_xor = 0;
+        parity.clear();
+
+        return p;
+    }
+
+    void fec_decoder::group_state::reset(uint16_t g, uint8_t k)
+    {
+        group = g;
+        group_size = k;
+        received = 0;
+        len_xor = 0;
+        acc.clear();
+        have_parity = false;
+    }
+
+    fec_decoder::result fec_decoder::receive(bstring_view framed)
+    {
+        result res{};
+
+        if (framed.size() < FEC_HEADER_SIZE)
+        {
+            log::warning(log_cat, "Ignoring invalid datagram: too short for FEC framing");
+            return res;
+        }
+
+        auto g = oxenc::load_big_to_host<uint16_t>(framed.data());
+        auto idx = static_cast<uint8_t>(framed[2]);
+        auto k = static_cast<uint8_t>(framed[3]);
+        framed.remove_prefix(FEC_HEADER_SIZE);
+
+        const bool is_parity = idx == k;
+
+        if (k == 0 || k > opt::datagram_fec::MAX_GROUP_SIZE || idx > k || (is_parity && framed.size() < 2))
+        {
+            log::warning(log_cat, "Ignoring invalid FEC datagram (group: {}, index: {}, size: {})", g, idx, k);
+            return res;
+        }
+
+        auto& gs = groups[g % WINDOW];
+
+        // A group that the sender flushed early: its data datagrams carry the nominal group size
+        // and its parity datagram the actual (smaller) number of data datagrams, which wins.
+        auto short_group = [&] {
+            if (is_parity)
+                return k < gs.group_size && (gs.received >> k) == 0;
+            return gs.have_parity && k > gs.group_size && idx < gs.group_size;
+        };
+
+        // Take over the slot if this is a newer group (modulo 16-bit wraparound) than the one it holds
+        if (!gs.group || (*gs.group != g && static_cast<uint16_t>(g - *gs.group) < 0x8000))
+            gs.reset(g, k);
+        else if (*gs.group == g && gs.group_size != k && short_group())
+            k = gs.group_size = std::min(k, gs.group_size);
+        else if (*gs.group != g || gs.group_size != k)
+        {
+            // Recovery state for this group is gone, so data passes straight through and parity is useless
+            log::trace(log_cat, "FEC datagram for expired group {}; no recovery possible", g);
+            if (not is_parity)
+                res.data.emplace(framed);
+            return res;
+        }
+
+        const uint64_t all = k == 64 ? ~uint64_t{0} : (uint64_t{1} << k) - 1;
+
+        if (is_parity)
+        {
+            if (gs.have_parity || gs.received == all)
+                return res;
+
+            gs.have_parity = true;
+            gs.len_xor ^= oxenc::load_big_to_host<uint16_t>(framed.data());
+            framed.remove_prefix(2);
+            accumulate(gs, framed);
+        }
+        else
+        {
+            const uint64_t bit = uint64_t{1} << idx;
+            if (gs.received & bit)
+            {
+                // Either a duplicate, or a datagram that we already reconstructed
+                log::trace(log_cat, "Dropping already-delivered FEC datagram (group: {}, index: {})", g, idx);
+                return res;
+            }
+
+            gs.received |= bit;
+            res.data.emplace(framed);
+
+            if (gs.received == all)
+                return res;
+
+            gs.len_xor ^= static_cast<uint16_t>(framed.size());
+            accumulate(gs, framed);
+        }
+
+        res.recovered = try_recover(gs);
+        return res;
+    }
+
+    void fec_decoder::accumulate(group_state& gs, bstring_view data)
+    {
+        if (gs.acc.size() < data.size())
+            gs.acc.resize(data.size(), std::byte{0});
+        xor_into(gs.acc.data(), data.data(), data.size());
+    }
+
+    std::optional<bstring> fec_decoder::try_recover(group_state& gs)
+    {
+        if (!gs.have_parity)
+            return std::nullopt;
+
+        const uint64_t all = gs.group_size == 64 ? ~uint64_t{0} : (uint64_t{1} << gs.group_size) - 1;
+        const uint64_t missing = all & ~gs.received;
+
+        // We can only reconstruct when exactly one data datagram of the group is missing
+        if (missing == 0 || (missing & (missing - 1)) != 0)
+            return std::nullopt;
+
+        gs.received = all;
+
+        if (gs.len_xor > gs.acc.size())
+        {
+            log::warning(log_cat, "Invalid FEC parity for group {}: unable to recover datagram", *gs.group);
+            return std::nullopt;
+        }
+
+        ++recovered_count;
+        log::debug(
+                log_cat,
+                "Recovered datagram (group: {}, index: {}) from FEC parity",
+                *gs.group,
+                std::countr_zero(missing));
+
+        return bstring{gs.acc.data(), gs.len_xor};
+    }
+
 }  // namespace oxen::quic
@@ -0,0 +1,115 @@
+#include "pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <new>
+
+namespace oxen::quic
+{
+    // Each chunk holds at least this many bytes worth of blocks (and at least 8 blocks)
+    static constexpr size_t CHUNK_SIZE = 16 * 1024;
+
+    std::shared_ptr<memory_pool> memory_pool::make()
+    {
+        return {new memory_pool{}, [](memory_pool* p) { p->release(); }};
+    }
+
+    memory_pool::~memory_pool()
+    {
+        for (auto* c : chunks)
+            ::operator delete(c);
+    }
+
+    void memory_pool::release() noexcept
+    {
+        {
+            std::lock_guard lock{mutex};
+            released = true;
+            if (outstanding > 0)
+                return;
+        }
+        delete this;
+    }
+
+    void* memory_pool::allocate(size_t size)
+    {
+        assert(pooled(size, 1));
+        auto cls = size_class(size);
+
+        std::lock_guard lock{mutex};
+
+        auto*& head = free_lists[cls];
+        if (!head)
+        {
+            const size_t block = (cls + 1) * granularity;
+            const size_t count = std::max<size_t>(8, CHUNK_SIZE / block);
+            auto* chunk = static_cast<std::byte*>(::operator new(block * count));
+            chunks.push_back(chunk);
+            _reserved += block * count;
+
+            for (size_t i = count; i-- > 0;)
+                head = ::new (chunk + i * block) free_block{head};
+        }
+
+        auto* b = head;
+        head = b->next;
+        ++outstanding;
+        return b;
+    }
+
+    void memory_pool::deallocate(void* p, size_t size) noexcept
+    {
+        assert(pooled(size, 1));
+        auto cls = size_class(size);
+
+        {
+            std::lock_guard lock{mutex};
+            free_lists[cls] = ::new (p) free_block{free_lists[cls]};
+            if (--outstanding > 0 || !released)
+                return;
+        }
+        delete this;
+    }
+
+    size_t memory_pool::reserved() const
+    {
+        std::lock_guard lock{mutex};
+        return _reserved;
+    }
+
+    shared_buffer::header* shared_buffer::allocate(const std::shared_ptr<memory_pool>& pool, size_t payload_size)
+    {
+        const size_t size = header_size + payload_size;
+        const bool pooled = pool && memory_pool::pooled(size, alignof(std::max_align_t));
+        auto* h = ::new (pooled ? pool->allocate(size) : ::operator new(size)) header{};
+        h->alloc_size = size;
+        if (pooled)
+            h->pool = pool.get();
+        return h;
+    }
+
+    void shared_buffer::deallocate(header* h) noexcept
+    {
+        if (h->destroy)
+            h->destroy(reinterpret_cast<std::byte*>(h) + header_size);
+        auto* pool = h->pool;
+        auto size = h->alloc_size;
+        h->~header();
+        if (pool)
+            pool->deallocate(h, size);
+        else
+            ::operator delete(h);
+    }
+
+    shared_buffer shared_buffer::copy(const std::shared_ptr<memory_pool>& pool, view_t data)
+    {
+        shared_buffer b;
+        b.h = allocate(pool, data.size());
+        auto* p = static_cast<std::byte*>(b.payload());
+        if (!data.empty())
+            std::memcpy(p, data.data(), data.size());
+        b.h->data = {p, data.size()};
+        return b;
+    }
+}  // namespace oxen::quic
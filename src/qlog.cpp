@@ -0,0 +1,212 @@
+#include "qlog.hpp"
+
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "internal.hpp"
+
+namespace oxen::quic
+{
+    struct QlogWriter::state
+    {
+        enum class record_type : uint8_t { OPEN, DATA, FIN };
+
+        struct record_header
+        {
+            uint64_t id;
+            uint32_t size;
+            record_type type;
+        };
+
+        const std::filesystem::path dir;
+
+        std::vector<std::byte> ring;
+        // Total bytes ever written to (`head`) and read from (`tail`) the ring; the producer only
+        // advances `head` and the writer thread only advances `tail`.
+        std::atomic<size_t> head{0};
+        std::atomic<size_t> tail{0};
+        std::atomic<uint64_t> dropped{0};
+
+        // Only used to wake the writer thread early, when the ring is filling up or on shutdown;
+        // otherwise it polls.
+        std::mutex wake_mutex;
+        std::condition_variable wake_cv;
+        std::atomic<bool> stopping{false};
+
+        // Files whose FIN record didn't fit in the ring.  This only happens when the ring is full,
+        // so a mutex is fine here, and it keeps us from leaking the files' descriptors.
+        std::mutex overflow_mutex;
+        std::vector<uint64_t> overflow_fins;
+
+        state(std::filesystem::path d, size_t buffer_size) :
+                dir{std::move(d)}, ring(std::bit_ceil(std::max<size_t>(buffer_size, 4096)))
+        {}
+
+        void push(record_type type, uint64_t id, const void* data, size_t size);
+        void copy_in(size_t pos, const void* src, size_t size);
+        void copy_out(size_t pos, void* dest, size_t size) const;
+
+        void run();
+    };
+
+    QlogWriter::QlogWriter(std::filesystem::path d, size_t buffer_size, join_handoff h) :
+            st{std::make_shared<state>(std::move(d), buffer_size)}, handoff{std::move(h)}
+    {
+        std::filesystem::create_directories(st->dir);
+
+        log::debug(log_cat, "Writing qlog traces to {} ({}B buffer)", st->dir.string(), st->ring.size());
+
+        writer = std::thread{[st = st] { st->run(); }};
+    }
+
+    QlogWriter::~QlogWriter()
+    {
+        {
+            std::lock_guard lock{st->wake_mutex};
+            st->stopping = true;
+        }
+        st->wake_cv.notify_one();
+
+        if (auto n = dropped())
+            log::warning(log_cat, "qlog writer for {} dropped {} trace records", st->dir.string(), n);
+
+        if (!handoff || !handoff(writer))
+            writer.join();
+    }
+
+    uint64_t QlogWriter::open(std::string_view name)
+    {
+        auto id = next_id++;
+        st->push(state::record_type::OPEN, id, name.data(), name.size());
+        return id;
+    }
+
+    void QlogWriter::write(uint64_t id, const void* data, size_t size, bool fin)
+    {
+        st->push(fin ? state::record_type::FIN : state::record_type::DATA, id, data, size);
+    }
+
+    uint64_t QlogWriter::dropped() const
+    {
+        return st->dropped.load(std::memory_order_relaxed);
+    }
+
+    const std::filesystem::path& QlogWriter::directory() const
+    {
+        return st->dir;
+    }
+
+    void QlogWriter::state::copy_in(size_t pos, const void* src, size_t size)
+    {
+        auto offset = pos & (ring.size() - 1);
+        auto first = std::min(size, ring.size() - offset);
+        std::memcpy(ring.data() + offset, src, first);
+        std::memcpy(ring.data(), static_cast<const std::byte*>(src) + first, size - first);
+    }
+
+    void QlogWriter::state::copy_out(size_t pos, void* dest, size_t size) const
+    {
+        auto offset = pos & (ring.size() - 1);
+        auto first = std::min(size, ring.size() - offset);
+        std::memcpy(dest, ring.data() + offset, first);
+        std::memcpy(static_cast<std::byte*>(dest) + first, ring.data(), size - first);
+    }
+
+    void QlogWriter::state::push(record_type type, uint64_t id, const void* data, size_t size)
+    {
+        auto h = head.load(std::memory_order_relaxed);
+        auto used = h - tail.load(std::memory_order_acquire);
+        auto total = sizeof(record_header) + size;
+
+        if (total > ring.size() - used)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            if (type == record_type::FIN)
+            {
+                std::lock_guard lock{overflow_mutex};
+                overflow_fins.push_back(id);
+            }
+            return;
+        }
+
+        record_header hdr{id, static_cast<uint32_t>(size), type};
+        copy_in(h, &hdr, sizeof(hdr));
+        copy_in(h + sizeof(hdr), data, size);
+        head.store(h + total, std::memory_order_release);
+
+        // Wake the writer early if the ring is getting full (it polls otherwise)
+        if (used + total > ring.size() / 2)
+            wake_cv.notify_one();
+    }
+
+    void QlogWriter::state::run()
+    {
+        std::unordered_map<uint64_t, std::ofstream> files;
+        std::string data;
+        std::vector<uint64_t> fins;
+
+        while (true)
+        {
+            {
+                std::unique_lock lock{wake_mutex};
+                wake_cv.wait_for(lock, 50ms, [this] {
+                    return stopping || head.load(std::memory_order_acquire) != tail.load(std::memory_order_relaxed);
+                });
+            }
+            bool stop = stopping;
+
+            // Taken before draining the ring: every record of these files that made it into the
+            // ring was pushed before its FIN was dropped, and so gets written out below first.
+            {
+                std::lock_guard lock{overflow_mutex};
+                fins.swap(overflow_fins);
+            }
+
+            auto t = tail.load(std::memory_order_relaxed);
+            for (auto h = head.load(std::memory_order_acquire); t != h; h = head.load(std::memory_order_acquire))
+            {
+                record_header hdr;
+                copy_out(t, &hdr, sizeof(hdr));
+                data.resize(hdr.size);
+                copy_out(t + sizeof(hdr), data.data(), hdr.size);
+                t += sizeof(hdr) + hdr.size;
+                tail.store(t, std::memory_order_release);
+
+                if (hdr.type == record_type::OPEN)
+                {
+                    auto path = dir / data;
+                    std::ofstream f{path, std::ios::binary | std::ios::trunc};
+                    if (f)
+                        files.emplace(hdr.id, std::move(f));
+                    else
+                        log::warning(log_cat, "Unable to open qlog file {}", path.string());
+                    continue;
+                }
+
+                auto it = files.find(hdr.id);
+                if (it == files.end())
+                    continue;
+                it->second.write(data.data(), data.size());
+                if (hdr.type == record_type::FIN)
+                    files.erase(it);
+            }
+
+            for (auto id : fins)
+                files.erase(id);
+            fins.clear();
+
+            if (stop)
+                break;
+
+            for (auto& [id, f] : files)
+                f.flush();
+        }
+    }
+}  // namespace oxen::quic
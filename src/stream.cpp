@@ -22,7 +22,8 @@ namespace oxen::quic
             IOChannel{conn, _ep},
             reference_id{conn.reference_id()},
             data_callback{data_cb},
-            close_callback{std::move(close_cb)}
+            close_callback{std::move(close_cb)},
+            user_buffers{stream_buffer::allocator_type{_ep.pool()}}
     {
         log::trace(log_cat, "Creating Stream object...");
 
@@ -204,9 +205,39 @@ namespace oxen::quic
 
         _conn = nullptr;
         _is_closing = _is_shutdown = true;
+
+        notify_writable(std::nullopt);
+    }
+
+    void Stream::on_writable(size_t max_buffered, std::function<void()> f)
+    {
+        endpoint.call([this, max_buffered, f = std::move(f)]() mutable {
+            if (_is_closing || size() <= max_buffered)
+                return f();
+            writable_waiters.emplace_back(max_buffered, std::move(f));
+        });
     }
 
-    void Stream::append_buffer(bstring_view buffer, std::shared_ptr<void> keep_alive)
+    void Stream::notify_writable(std::optional<size_t> buffered)
+    {
+        std::vector<std::function<void()>> ready;
+        std::erase_if(writable_waiters, [&](auto& w) {
+            if (buffered && *buffered > w.first)
+                return false;
+            ready.push_back(std::move(w.second));
+            return true;
+        });
+
+        // We are called from within ngtcp2 callbacks, where the waiters must not go sending more
+        // data, so defer them to the next event loop job.
+        if (!ready.empty())
+            endpoint.call_soon([ready = std::move(ready)] {
+                for (auto& f : ready)
+                    f();
+            });
+    }
+
+    void Stream::append_buffer(bstring_view buffer, shared_buffer keep_alive)
     {
         log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
         user_buffers.emplace_back(buffer, std::move(keep_alive));
@@ -220,8 +251,8 @@ namespace oxen::quic
 
     void Stream::acknowledge(size_t bytes)
     {
-        log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
-        log::trace(log_cat, "Acking {} bytes of {}/{} unacked/size", bytes, _unacked_size, size());
+        QUIC_HOT_TRACE(log_cat, "{} called", __PRETTY_FUNCTION__);
+        QUIC_HOT_TRACE(log_cat, "Acking {} bytes of {}/{} unacked/size", bytes, _unacked_size, size());
 
         assert(bytes <= _unacked_size);
         _unacked_size -= bytes;
@@ -231,7 +262,7 @@ namespace oxen::quic
         {
             bytes -= user_buffers.front().first.size();
             user_buffers.pop_front();
-            log::trace(log_cat, "bytes: {}", bytes);
+            QUIC_HOT_TRACE(log_cat, "bytes: {}", bytes);
         }
 
         // advance bsv pointer to cover any remaining acked data
@@ -240,6 +271,9 @@ namespace oxen::quic
 
         auto sz = size();
 
+        if (!writable_waiters.empty())
+            notify_writable(sz);
+
         // Do not bother with this block of logic if no watermarks are set
         if (_is_watermarked)
         {
@@ -279,19 +313,19 @@ namespace oxen::quic
                 return clear_watermarks();
         }
 
-        log::trace(log_cat, "{} bytes acked, {} unacked remaining", bytes, sz);
+        QUIC_HOT_TRACE(log_cat, "{} bytes acked, {} unacked remaining", bytes, sz);
     }
 
     void Stream::wrote(size_t bytes)
     {
-        log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
-        log::trace(log_cat, "Increasing _unacked_size by {}B", bytes);
+        QUIC_HOT_TRACE(log_cat, "{} called", __PRETTY_FUNCTION__);
+        QUIC_HOT_TRACE(log_cat, "Increasing _unacked_size by {}B", bytes);
         _unacked_size += bytes;
     }
 
-    static auto get_buffer_it(std::deque<std::pair<bstring_view, std::shared_ptr<void>>>& bufs, size_t offset)
+    static auto get_buffer_it(stream_buffer& bufs, size_t offset)
     {
-        log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
+        QUIC_HOT_TRACE(log_cat, "{} called", __PRETTY_FUNCTION__);
         auto it = bufs.begin();
 
         while (offset >= it->first.size() && it != bufs.end() && offset)
@@ -305,11 +339,11 @@ namespace oxen::quic
 
     std::vector<ngtcp2_vec> Stream::pending()
     {
-        log::trace(log_cat, "{} called", __PRETTY_FUNCTION__);
+        QUIC_HOT_TRACE(log_cat, "{} called", __PRETTY_FUNCTION__);
 
         std::vector<ngtcp2_vec> nbufs{};
 
-        log::trace(log_cat, "unsent: {}", unsent());
+        QUIC_HOT_TRACE(log_cat, "unsent: {}", unsent());
 
         if (user_buffers.empty() || unsent() == 0)
             return nbufs;
@@ -329,7 +363,7 @@ namespace oxen::quic
         return nbufs;
     }
 
-    void Stream::send_impl(bstring_view data, std::shared_ptr<void> keep_alive)
+    void Stream::send_impl(bstring_view data, shared_buffer keep_alive)
     {
         if (data.empty())
             return;
@@ -339,20 +373,20 @@ namespace oxen::quic
         // events) the application has control and responsibility for keeping the network/endpoint
         // alive at least as long as all the Connections/Streams that instances that were attached
         // to it.
-        endpoint.call([this, data, ka = std::move(keep_alive)]() {
+        endpoint.call([this, data, ka = std::move(keep_alive)]() mutable {
             if (!_conn || _conn->is_closing() || _conn->is_draining())
             {
                 log::warning(log_cat, "Stream {} unable to send: connection is closed", _stream_id);
                 return;
             }
-            log::trace(log_cat, "Stream (ID: {}) sending message: {}", _stream_id, buffer_printer{data});
+            QUIC_HOT_TRACE(log_cat, "Stream (ID: {}) sending message: {}", _stream_id, buffer_printer{data});
             append_buffer(data, std::move(ka));
         });
     }
 
     size_t Stream::unsent_impl() const
     {
-        log::trace(log_cat, "size={}, unacked={}", size(), unacked());
+        QUIC_HOT_TRACE(log_cat, "size={}, unacked={}", size(), unacked());
         return size() - unacked();
     }
 
@@ -379,4 +413,65 @@ namespace oxen::quic
         throw std::runtime_error{"Stream objects should not be queried for pending datagrams!"};
     }
 
+
+    stream_data_callback stream_reader::data_callback()
+    {
+        return [self = shared_from_this()](Stream&, bstring_view data) { self->on_data(data); };
+    }
+
+    stream_close_callback stream_reader::close_callback()
+    {
+        return [self = shared_from_this()](Stream&, uint64_t app_code) { self->on_close(app_code); };
+    }
+
+    std::optional<uint64_t> stream_reader::close_code() const
+    {
+        std::lock_guard lock{mutex};
+        return closed_with;
+    }
+
+    void stream_reader::on_readable(std::function<void(bstring)> done)
+    {
+        std::unique_lock lock{mutex};
+        if (buffered.empty() && !closed_with)
+        {
+            if (waiter)
+                throw std::logic_error{"stream_reader only supports one outstanding read at a time"};
+            waiter = std::move(done);
+            return;
+        }
+
+        auto data = std::move(buffered);
+        buffered.clear();
+        lock.unlock();
+        done(std::move(data));
+    }
+
+    void stream_reader::on_data(bstring_view data)
+    {
+        std::unique_lock lock{mutex};
+        if (!waiter)
+        {
+            buffered += data;
+            return;
+        }
+
+        auto w = std::move(waiter);
+        waiter = nullptr;
+        lock.unlock();
+        w(bstring{data});
+    }
+
+    void stream_reader::on_close(uint64_t app_code)
+    {
+        std::unique_lock lock{mutex};
+        closed_with = app_code;
+        if (!waiter)
+            return;
+
+        auto w = std::move(waiter);
+        waiter = nullptr;
+        lock.unlock();
+        w(bstring{});
+    }
 }  // namespace oxen::quic
@@ -22,6 +22,7 @@ extern "C"
 
 #include "internal.hpp"
 #include "udp.hpp"
+#include "usdt.hpp"
 
 #ifdef _WIN32
 
@@ -147,8 +148,9 @@ namespace oxen::quic
     }
 #endif
 
-    UDPSocket::UDPSocket(event_base* ev_loop, const Address& addr, receive_callback_t on_receive) :
-            ev_{ev_loop}, receive_callback_{std::move(on_receive)}
+    UDPSocket::UDPSocket(
+            event_base* ev_loop, const Address& addr, receive_callback_t on_receive, batch_callback_t on_batch) :
+            ev_{ev_loop}, receive_callback_{std::move(on_receive)}, batch_callback_{std::move(on_batch)}
     {
         assert(ev_);
 
@@ -367,9 +369,14 @@ namespace oxen::quic
                 return io_result{errno};
             }
 
+            QUIC_PROBE(udp_receive, bound_.port(), nread);
+
             for (int i = 0; i < nread; i++)
                 process_packet(bstring_view{data[i].data(), msgs[i].msg_len}, msgs[i].msg_hdr);
 
+            if (batch_callback_)
+                batch_callback_();
+
             count += nread;
 
             if (nread < static_cast<int>(DATAGRAM_BATCH_SIZE))
@@ -412,6 +419,7 @@ namespace oxen::quic
         hdr.msg_controllen = sizeof(cmsg);
 #endif
 
+        io_result result{};
         size_t count = 0;
         do
         {
@@ -421,9 +429,9 @@ namespace oxen::quic
             if (rv == SOCKET_ERROR)
             {
                 auto error = WSAGetLastError();
-                if (error == WSAEWOULDBLOCK)
-                    return io_result{};
-                return io_result::wsa(error);
+                if (error != WSAEWOULDBLOCK)
+                    result = io_result::wsa(error);
+                break;
             }
 #else
             int nbytes;
@@ -434,19 +442,25 @@ namespace oxen::quic
 
             if (nbytes < 0)
             {
-                if (errno == EAGAIN || errno == EWOULDBLOCK)
-                    return io_result{};
-                return io_result{errno};
+                if (errno != EAGAIN && errno != EWOULDBLOCK)
+                    result = io_result{errno};
+                break;
             }
 #endif
 
+            QUIC_PROBE(udp_receive, bound_.port(), 1);
+
             process_packet(bstring_view{data.data(), static_cast<size_t>(nbytes)}, hdr);
 
             count++;
 
         } while (count < MAX_RECEIVE_PER_LOOP);
 
-        return io_result{};
+        // Without recvmmsg, everything read during this wakeup is treated as one batch
+        if (count > 0 && batch_callback_)
+            batch_callback_();
+
+        return result;
 #endif
     }
 
@@ -0,0 +1,55 @@
+#pragma once
+
+// Static (USDT) tracepoints on the packet path, usable from bpftrace, perf, systemtap, etc., e.g.:
+//
+//     bpftrace -e 'usdt:/path/to/liboxenquic.so:libquic:flush_packets { @[arg2] = hist(arg1); }'
+//
+// When nothing is attached a probe compiles to a single nop (the probe arguments are only left in
+// registers or memory for the tracer to read), so they are always enabled when the platform has
+// <sys/sdt.h> (see LIBQUIC_USDT in src/CMakeLists.txt).  Probes must not change what the library
+// does otherwise: e.g. there is no probe for lost datagrams, as ngtcp2 only reports those if it
+// keeps every sent DATAGRAM frame for loss detection.  Connection arguments are the connection's
+// reference id (i.e. `ConnectionID::id`).  The available probes are:
+//
+//     udp_receive(port, count)                 -- a batch of `count` packets read from the socket
+//     packet_lookup(port, result, size)        -- Endpoint::handle_packet connection lookup; `result`
+//                                                 is one of the `lookup_result` values below
+//     read_packet(conn, size, rv)              -- Connection::read_packet; `rv` is the ngtcp2 result
+//     flush_packets(conn, packets, limited)    -- end of Connection::flush_packets; `limited` is 1 if
+//                                                 the send quantum was used up
+//     congested(conn, stream)                  -- ngtcp2 refused to write more (congestion/flow
+//                                                 control) for stream id `stream` (-1: non-stream data)
+//     send_blocked(conn, packets)              -- a packet send blocked with `packets` still to send
+//     stream_open(conn, stream, remote)        -- a stream was assigned stream id `stream`
+//     stream_close(conn, stream, code)         -- a stream was closed with application code `code`
+//     datagram_drop(conn, reason, size)        -- a datagram was dropped; `reason` is one of the
+//                                                 `datagram_drop_reason` values below
+
+#ifdef OXEN_LIBQUIC_USDT
+#include <sys/sdt.h>
+
+#define QUIC_PROBE(...) STAP_PROBEV(libquic, __VA_ARGS__)
+#else
+#define QUIC_PROBE(...) \
+    do                  \
+    {                   \
+    } while (0)
+#endif
+
+namespace oxen::quic::usdt
+{
+    enum lookup_result : int
+    {
+        LOOKUP_FOUND = 0,     // Matched an existing connection
+        LOOKUP_ACCEPTED = 1,  // Unknown connection ID; a new inbound connection was created
+        LOOKUP_REFUSED = 2,   // Unknown connection ID; no connection was created (Retry, refused, etc.)
+        LOOKUP_UNKNOWN = 3,   // Unknown connection ID on an endpoint not accepting connections
+        LOOKUP_INVALID = 4,   // The packet's connection IDs could not be parsed
+    };
+
+    enum datagram_drop_reason : int
+    {
+        DGRAM_TOO_BIG = 0,  // Outgoing datagram larger than the connection's max datagram size (size)
+        DGRAM_INVALID = 1,  // Incoming datagram too short to carry a split datagram id (size)
+    };
+}  // namespace oxen::quic::usdt
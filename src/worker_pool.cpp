@@ -0,0 +1,118 @@
+#include "worker_pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+#include "internal.hpp"
+
+namespace oxen::quic
+{
+    static thread_local const WorkerPool* current_pool = nullptr;
+
+    WorkerPool::WorkerPool(size_t threads)
+    {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+
+        log::debug(log_cat, "Starting worker pool with {} threads", threads);
+
+        workers.reserve(threads);
+        for (size_t i = 0; i < threads; ++i)
+            workers.emplace_back([this] { run(); });
+    }
+
+    WorkerPool::~WorkerPool()
+    {
+        assert(!in_worker());
+        {
+            std::lock_guard lock{jobs_mutex};
+            stopping = true;
+        }
+        jobs_cv.notify_all();
+
+        for (auto& w : workers)
+            w.join();
+
+        log::debug(log_cat, "Worker pool stopped");
+    }
+
+    bool WorkerPool::in_worker() const
+    {
+        return current_pool == this;
+    }
+
+    void WorkerPool::submit(std::function<void()> job)
+    {
+        {
+            std::lock_guard lock{jobs_mutex};
+            jobs.push(std::move(job));
+        }
+        jobs_cv.notify_one();
+    }
+
+    void WorkerPool::run()
+    {
+        current_pool = this;
+
+        std::unique_lock lock{jobs_mutex};
+        while (true)
+        {
+            jobs_cv.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if (jobs.empty())
+                break;  // stopping, with nothing left to do
+
+            auto job = std::move(jobs.front());
+            jobs.pop();
+
+            lock.unlock();
+            try
+            {
+                job();
+            }
+            catch (const std::exception& e)
+            {
+                log::error(log_cat, "Uncaught exception from worker pool job: {}", e.what());
+            }
+            lock.lock();
+        }
+    }
+
+    void serial_queue::submit(WorkerPool& pool, std::function<void()> job)
+    {
+        {
+            std::lock_guard lock{jobs_mutex};
+            jobs.push(std::move(job));
+            if (std::exchange(active, true))
+                return;  // Already being drained; the drainer will pick this one up
+        }
+
+        pool.submit([self = shared_from_this()] { self->drain(); });
+    }
+
+    void serial_queue::drain()
+    {
+        while (true)
+        {
+            std::function<void()> job;
+            {
+                std::lock_guard lock{jobs_mutex};
+                if (jobs.empty())
+                {
+                    active = false;
+                    return;
+                }
+                job = std::move(jobs.front());
+                jobs.pop();
+            }
+
+            try
+            {
+                job();
+            }
+            catch (const std::exception& e)
+            {
+                log::error(log_cat, "Uncaught exception from serial queue job: {}", e.what());
+            }
+        }
+    }
+}  // namespace oxen::quic
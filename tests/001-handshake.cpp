@@ -451,6 +451,273 @@ namespace oxen::quic::test
                                                  defaults::CLIENT_PUBKEY.length()});
     }
 
+    TEST_CASE("001 - Handshaking: Key verify cache", "[001][server][verifycache]")
+    {
+        key_verify_cache cache;
+        auto t0 = std::chrono::steady_clock::time_point{};
+        auto alpn = to_usv("alpn"sv);
+        auto key = [](std::string_view k) { return to_usv(k); };
+
+        // Disabled by default
+        cache.put(key("a"), alpn, true, cache.generation(), t0);
+        CHECK_FALSE(cache.get(key("a"), alpn, t0));
+        CHECK(cache.stats().misses == 0);
+
+        cache.configure(2, 10s);
+        cache.put(key("a"), alpn, true, cache.generation(), t0);
+        cache.put(key("b"), alpn, false, cache.generation(), t0);
+        CHECK(cache.get(key("a"), alpn, t0) == true);
+        CHECK(cache.get(key("b"), alpn, t0) == false);
+        CHECK_FALSE(cache.get(key("a"), to_usv("other"sv), t0));
+
+        // "a" is now the least recently used, so is evicted
+        cache.put(key("c"), alpn, true, cache.generation(), t0);
+        CHECK_FALSE(cache.get(key("a"), alpn, t0));
+        CHECK(cache.get(key("c"), alpn, t0 + 9s) == true);
+        CHECK_FALSE(cache.get(key("c"), alpn, t0 + 10s));  // expired
+
+        auto stats = cache.stats();
+        CHECK(stats.hits == 3);
+        CHECK(stats.misses == 3);
+        CHECK(stats.size == 1);
+
+        cache.clear();
+        CHECK_FALSE(cache.get(key("b"), alpn, t0));
+
+        // A verdict reached before the cache was cleared is not stored
+        auto gen = cache.generation();
+        cache.clear();
+        cache.put(key("a"), alpn, true, gen, t0);
+        CHECK_FALSE(cache.get(key("a"), alpn, t0));
+        cache.put(key("a"), alpn, true, cache.generation(), t0);
+        CHECK(cache.get(key("a"), alpn, t0) == true);
+    }
+
+    TEST_CASE("001 - Handshaking: Cached key verification", "[001][server][verifycache]")
+    {
+        Network test_net{};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        std::atomic<int> verify_calls{0};
+        server_tls->set_key_verify_callback([&](const ustring_view& key, const ustring_view&) {
+            ++verify_calls;
+            return key == convert_sv<unsigned char>(std::string_view{defaults::CLIENT_PUBKEY});
+        });
+        server_tls->set_key_verify_cache(100, 60s);
+
+        Address server_local{};
+        Address client_local{};
+
+        // The server verifies the client key after the client considers the handshake complete, so
+        // wait for both ends before reconnecting.
+        std::array<std::promise<void>, 3> server_proms;
+        std::atomic<size_t> server_count{0};
+        connection_established_callback server_established = [&](connection_interface&) {
+            server_proms[server_count++].set_value();
+        };
+
+        auto server_endpoint = test_net.endpoint(server_local, server_established);
+        REQUIRE_NOTHROW(server_endpoint->listen(server_tls));
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        auto client_endpoint = test_net.endpoint(client_local);
+
+        for (auto& server_prom : server_proms)
+        {
+            auto server_f = server_prom.get_future();
+            auto client_established = callback_waiter{[](connection_interface&) {}};
+            auto ci = client_endpoint->connect(client_remote, client_tls, client_established);
+            REQUIRE(client_established.wait());
+            require_future(server_f);
+            ci->close_connection();
+        }
+
+        CHECK(verify_calls == 1);
+        auto stats = server_tls->get_key_verify_cache_stats();
+        CHECK(stats.hits == 2);
+        CHECK(stats.misses == 1);
+        CHECK(stats.size == 1);
+
+        // Changing the callback invalidates the cached verdicts
+        server_tls->set_key_verify_callback([&](const ustring_view&, const ustring_view&) {
+            ++verify_calls;
+            return false;
+        });
+
+        auto client_closed = callback_waiter{[](connection_interface&, uint64_t) {}};
+        client_endpoint->connect(client_remote, client_tls, client_closed);
+        CHECK(client_closed.wait());
+        CHECK(verify_calls == 2);
+    }
+
+    TEST_CASE("001 - Handshaking: Deferred key verification", "[001][server][verifypool]")
+    {
+        Network test_net{};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        std::atomic<bool> accept{true}, verified_on_loop{false};
+        server_tls->set_key_verify_callback([&](const ustring_view&, const ustring_view&) {
+            if (test_net.in_event_loop())
+                verified_on_loop = true;
+            std::this_thread::sleep_for(50ms);  // a slow verifier
+            return accept.load();
+        });
+        server_tls->set_key_verify_pool(std::make_shared<WorkerPool>(2));
+
+        std::shared_ptr<Endpoint> server_endpoint;
+
+        std::atomic<int> server_established{0}, handled_requests{0}, unvalidated_requests{0};
+        auto server_conn_est = [&](connection_interface& c) {
+            ++server_established;
+            auto s = c.queue_incoming_stream<BTRequestStream>();
+            s->register_handler("echo"s, [&](message m) {
+                ++handled_requests;
+                if (auto ci = server_endpoint->get_conn(m.conn_rid()); !ci || !ci->is_validated())
+                    ++unvalidated_requests;
+                m.respond(m.body());
+            });
+        };
+
+        Address server_local{};
+        Address client_local{};
+
+        server_endpoint = test_net.endpoint(server_local);
+        REQUIRE_NOTHROW(server_endpoint->listen(server_tls, server_conn_est));
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        auto client_endpoint = test_net.endpoint(client_local);
+
+        SECTION("Accepted")
+        {
+            auto client_established = callback_waiter{[](connection_interface&) {}};
+            auto client_ci = client_endpoint->connect(client_remote, client_tls, client_established);
+            REQUIRE(client_established.wait());
+
+            // Sent while the server is (most likely) still verifying, so held until it accepts
+            auto stream = client_ci->open_stream<BTRequestStream>();
+            std::promise<std::string> resp_prom;
+            auto resp = resp_prom.get_future();
+            stream->command("echo"s, "hello"s, [&](message m) { resp_prom.set_value(m ? m.body_str() : "failed"); });
+
+            require_future(resp);
+            CHECK(resp.get() == "hello");
+
+            auto server_cis = server_endpoint->get_all_conns(Direction::INBOUND);
+            REQUIRE(server_cis.size() == 1);
+            CHECK(server_cis.front()->is_validated());
+        }
+
+        SECTION("Stream data in the client's Finished flight")
+        {
+            // Opened before the handshake completes, so the stream data goes out in 1-RTT packets
+            // along with the client Finished, and reaches the server in the same read as the
+            // Finished that starts the key verification.
+            auto client_established = callback_waiter{[](connection_interface&) {}};
+            auto client_ci = client_endpoint->connect(client_remote, client_tls, client_established);
+            auto stream = client_ci->open_stream<BTRequestStream>();
+            std::promise<std::string> resp_prom;
+            auto resp = resp_prom.get_future();
+            stream->command("echo"s, "hello"s, [&](message m) { resp_prom.set_value(m ? m.body_str() : "failed"); });
+
+            REQUIRE(client_established.wait());
+            require_future(resp);
+            CHECK(resp.get() == "hello");
+            CHECK(handled_requests == 1);
+        }
+
+        SECTION("Rejected")
+        {
+            accept = false;
+
+            std::promise<uint64_t> close_prom;
+            auto close_code = close_prom.get_future();
+            connection_closed_callback client_closed = [&](connection_interface&, uint64_t ec) {
+                close_prom.set_value(ec);
+            };
+            auto client_ci = client_endpoint->connect(client_remote, client_tls, client_closed);
+            client_ci->open_stream<BTRequestStream>()->command("echo"s, "hello"s, [](message) {});
+
+            require_future(close_code);
+            CHECK(close_code.get() == CONN_KEY_VERIFY_FAILED);
+            CHECK(server_established == 0);
+            CHECK(handled_requests == 0);
+        }
+
+        CHECK_FALSE(verified_on_loop);
+        CHECK(unvalidated_requests == 0);
+    }
+
+    TEST_CASE("001 - Handshaking: Deferred key verification with replaced callback", "[001][server][verifypool]")
+    {
+        Network test_net{};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        // The first callback blocks until released, so that the second replaces it mid-verification
+        std::promise<void> old_started, release_old;
+        auto old_started_f = old_started.get_future();
+        auto release_old_f = release_old.get_future().share();
+        std::atomic<int> old_calls{0}, new_calls{0};
+        server_tls->set_key_verify_callback([&, release_old_f](const ustring_view&, const ustring_view&) {
+            if (old_calls++ == 0)
+                old_started.set_value();
+            release_old_f.wait();
+            return true;
+        });
+        server_tls->set_key_verify_cache(100, 60s);
+        server_tls->set_key_verify_pool(std::make_shared<WorkerPool>(1));
+
+        std::promise<void> server_prom;
+        auto server_f = server_prom.get_future();
+        auto server_established = [&](connection_interface&) { server_prom.set_value(); };
+
+        Address server_local{};
+        Address client_local{};
+
+        auto server_endpoint = test_net.endpoint(server_local);
+        REQUIRE_NOTHROW(server_endpoint->listen(server_tls, server_established));
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        auto client_endpoint = test_net.endpoint(client_local);
+
+        auto client_established = callback_waiter{[](connection_interface&) {}};
+        auto client_ci = client_endpoint->connect(client_remote, client_tls, client_established);
+        REQUIRE(client_established.wait());
+        require_future(old_started_f);
+
+        server_tls->set_key_verify_callback([&](const ustring_view&, const ustring_view&) {
+            ++new_calls;
+            return false;
+        });
+        release_old.set_value();
+
+        // The running verification finishes with the callback it started with, but its verdict
+        // doesn't outlive the replacement in the cache
+        require_future(server_f);
+        CHECK(old_calls == 1);
+        CHECK(new_calls == 0);
+        CHECK(server_tls->get_key_verify_cache_stats().size == 0);
+        client_ci->close_connection();
+
+        std::promise<uint64_t> close_prom;
+        auto close_code = close_prom.get_future();
+        connection_closed_callback client_closed = [&](connection_interface&, uint64_t ec) {
+            close_prom.set_value(ec);
+        };
+        client_endpoint->connect(client_remote, client_tls, client_closed);
+
+        require_future(close_code);
+        CHECK(close_code.get() == CONN_KEY_VERIFY_FAILED);
+        CHECK(old_calls == 1);
+        CHECK(new_calls == 1);
+        CHECK(server_tls->get_key_verify_cache_stats().size == 1);
+    }
+
     TEST_CASE("001 - Handshaking: Types - IPv6", "[001][ipv6]")
     {
         if (disable_ipv6)
@@ -887,4 +1154,329 @@ namespace oxen::quic::test
         REQUIRE(stream_callback_called);
         CHECK(*stream_callback_called);
     }
+
+    TEST_CASE("001 - Handshaking: Shared session ticket key", "[001][handshake][tls][ticketkey]")
+    {
+        Network test_net{};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        auto key = server_tls->current_ticket_key();
+        REQUIRE(key);
+        CHECK(server_tls->current_ticket_key() == key);
+
+        Address server_local{};
+        Address client_local{};
+
+        callback_waiter client_established_a{[](connection_interface&) {}};
+        callback_waiter client_established_b{[](connection_interface&) {}};
+
+        auto server_endpoint = test_net.endpoint(server_local);
+        REQUIRE_NOTHROW(server_endpoint->listen(server_tls));
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        auto client_endpoint = test_net.endpoint(client_local);
+        auto conn_a = client_endpoint->connect(client_remote, client_tls, client_established_a);
+        auto conn_b = client_endpoint->connect(client_remote, client_tls, client_established_b);
+        REQUIRE(client_established_a.wait());
+        REQUIRE(client_established_b.wait());
+
+        // Accepting connections reuses the creds' key rather than generating one per session
+        CHECK(server_tls->current_ticket_key() == key);
+
+        server_tls->rotate_ticket_key();
+        auto rotated = server_tls->current_ticket_key();
+        CHECK(rotated != key);
+
+        server_tls->set_ticket_key_rotation(0s);
+        CHECK(server_tls->current_ticket_key() != rotated);
+    }
+
+    TEST_CASE("001 - Handshaking: Anti-replay window", "[001][handshake][tls][antireplay]")
+    {
+        anti_replay_window window{3};
+
+        auto key = [](std::string_view k) { return to_usv(k); };
+
+        CHECK(window.add(key("a"), 110, 100));
+        CHECK_FALSE(window.add(key("a"), 110, 101));  // replayed
+        CHECK(window.add(key("b"), 111, 101));
+        CHECK(window.add(key("c"), 112, 102));
+        CHECK_FALSE(window.add(key("d"), 112, 102));  // full
+        CHECK(window.size() == 3);
+
+        // Once "a" expires it can be (and must be, as GnuTLS rejects it anyway) forgotten
+        CHECK(window.add(key("d"), 120, 110));
+        CHECK(window.add(key("a"), 121, 111));
+        CHECK_FALSE(window.add(key("b"), 121, 111));  // expired, but the window is full again
+        CHECK(window.add(key("e"), 130, 120));
+        CHECK(window.size() == 2);
+    }
+
+    TEST_CASE("001 - Handshaking: Session resumption and 0-RTT", "[001][handshake][tls][resumption]")
+    {
+        Network test_net{};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+        client_tls->set_early_data(true);
+        server_tls->set_early_data(true);
+
+        Address server_local{};
+        Address client_local{};
+
+        std::shared_ptr<Endpoint> server_endpoint;
+
+        // Early stream data must not reach the application before the client's key is verified
+        std::atomic<int> unvalidated_requests{0};
+
+        auto server_conn_est = [&](connection_interface& c) {
+            auto s = c.queue_incoming_stream<BTRequestStream>();
+            s->register_handler("echo"s, [&](message m) {
+                if (auto ci = server_endpoint->get_conn(m.conn_rid()); !ci || !ci->is_validated())
+                    ++unvalidated_requests;
+                m.respond(m.body());
+            });
+        };
+
+        server_endpoint = test_net.endpoint(server_local);
+        REQUIRE_NOTHROW(server_endpoint->listen(server_tls, server_conn_est));
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        auto client_endpoint = test_net.endpoint(client_local);
+
+        // Connects, immediately (i.e. before the handshake completes) sends a request, and returns
+        // the connection once the response arrives.
+        auto request = [&](std::string body) {
+            callback_waiter established{[](connection_interface&) {}};
+            auto ci = client_endpoint->connect(client_remote, client_tls, established);
+            auto bp = ci->open_stream<BTRequestStream>();
+
+            std::promise<std::string> response;
+            auto f = response.get_future();
+            bp->command("echo"s, body, [&response](message m) {
+                response.set_value(m ? m.body_str() : "<failed>"s);
+            });
+
+            REQUIRE(established.wait());
+            require_future(f, 5s);
+            CHECK(f.get() == body);
+            CHECK(ci->is_validated());
+            return ci;
+        };
+
+        auto first = request("first");
+        CHECK_FALSE(first->is_resumed());
+        CHECK_FALSE(first->early_data_accepted());
+
+        SECTION("Resumed with early data")
+        {
+            auto second = request("second");
+            CHECK(second->is_resumed());
+            CHECK(second->early_data_accepted());
+
+            // Each connection hands out a new ticket
+            auto third = request("third");
+            CHECK(third->is_resumed());
+            CHECK(third->early_data_accepted());
+        }
+
+        SECTION("Early data rejected")
+        {
+            // The client's ticket can no longer be decrypted, so the server falls back to a full
+            // handshake and the client has to resend its 0-RTT request.
+            server_tls->rotate_ticket_key();
+
+            auto second = request("second");
+            CHECK_FALSE(second->is_resumed());
+            CHECK_FALSE(second->early_data_accepted());
+
+            auto third = request("third");
+            CHECK(third->is_resumed());
+            CHECK(third->early_data_accepted());
+        }
+
+        CHECK(unvalidated_requests == 0);
+    }
+
+    TEST_CASE("001 - Handshaking: Session resumption and 0-RTT options", "[001][handshake][tls][resumption]")
+    {
+        Network test_net{};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{};
+        Address client_local{};
+
+        auto server_conn_est = [&](connection_interface& c) {
+            auto s = c.queue_incoming_stream<BTRequestStream>();
+            s->register_handler("echo"s, [](message m) { m.respond(m.body()); });
+        };
+
+        auto server_endpoint = test_net.endpoint(server_local);
+        REQUIRE_NOTHROW(server_endpoint->listen(server_tls, server_conn_est));
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        auto client_endpoint = test_net.endpoint(client_local);
+
+        // Connects and makes a request once established; by the time the response arrives the
+        // client holds the connection's session ticket, if the server issued one.
+        auto request = [&] {
+            callback_waiter established{[](connection_interface&) {}};
+            auto ci = client_endpoint->connect(client_remote, client_tls, established);
+            REQUIRE(established.wait());
+
+            std::promise<std::string> response;
+            auto f = response.get_future();
+            ci->open_stream<BTRequestStream>()->command("echo"s, "hello"s, [&response](message m) {
+                response.set_value(m ? m.body_str() : "<failed>"s);
+            });
+
+            require_future(f, 5s);
+            CHECK(f.get() == "hello");
+            return ci;
+        };
+
+        SECTION("Resumption without early data by default")
+        {
+            request();
+            auto second = request();
+            CHECK(second->is_resumed());
+            CHECK_FALSE(second->early_data_accepted());
+        }
+
+        SECTION("Early data enabled only on the server")
+        {
+            server_tls->set_early_data(true);
+            request();
+            auto second = request();
+            CHECK(second->is_resumed());
+            CHECK_FALSE(second->early_data_accepted());
+        }
+
+        SECTION("Early data enabled only on the client")
+        {
+            // The client attempts 0-RTT, but the server's tickets don't allow it
+            client_tls->set_early_data(true);
+            request();
+            auto second = request();
+            CHECK(second->is_resumed());
+            CHECK_FALSE(second->early_data_accepted());
+        }
+
+        SECTION("Resumption disabled on the client")
+        {
+            client_tls->set_session_resumption(false);
+            request();
+            CHECK_FALSE(request()->is_resumed());
+        }
+
+        SECTION("Resumption disabled on the server")
+        {
+            server_tls->set_session_resumption(false);
+            request();
+            CHECK_FALSE(request()->is_resumed());
+        }
+    }
+
+    TEST_CASE("001 - Handshaking: Session resumption with several client creds", "[001][handshake][tls][resumption]")
+    {
+        Network test_net{};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+        auto [other_seed, other_pubkey] = generate_ed25519();
+        auto other_tls = GNUTLSCreds::make_from_ed_keys(other_seed, other_pubkey);
+
+        Address server_local{};
+        Address client_local{};
+
+        // The client key the server saw on each connection
+        std::mutex keys_mutex;
+        std::vector<std::string> server_keys;
+        auto server_conn_est = [&](connection_interface& c) {
+            {
+                std::lock_guard lock{keys_mutex};
+                server_keys.emplace_back(to_sv(c.remote_key()));
+            }
+            auto s = c.queue_incoming_stream<BTRequestStream>();
+            s->register_handler("echo"s, [](message m) { m.respond(m.body()); });
+        };
+
+        auto server_endpoint = test_net.endpoint(server_local);
+        REQUIRE_NOTHROW(server_endpoint->listen(server_tls, server_conn_est));
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        // Both creds connect through the same endpoint, so share its session ticket store
+        auto client_endpoint = test_net.endpoint(client_local);
+
+        auto request = [&](std::shared_ptr<GNUTLSCreds> creds) {
+            callback_waiter established{[](connection_interface&) {}};
+            auto ci = client_endpoint->connect(client_remote, creds, established);
+            REQUIRE(established.wait());
+
+            std::promise<std::string> response;
+            auto f = response.get_future();
+            ci->open_stream<BTRequestStream>()->command("echo"s, "hello"s, [&response](message m) {
+                response.set_value(m ? m.body_str() : "<failed>"s);
+            });
+
+            require_future(f, 5s);
+            CHECK(f.get() == "hello");
+
+            std::lock_guard lock{keys_mutex};
+            REQUIRE_FALSE(server_keys.empty());
+            return std::make_pair(ci->is_resumed(), server_keys.back());
+        };
+
+        CHECK(request(client_tls) == std::make_pair(false, defaults::CLIENT_PUBKEY));
+        CHECK(request(other_tls) == std::make_pair(false, other_pubkey));
+
+        // Each creds resumes its own session, rather than the most recent one to the server
+        CHECK(request(client_tls) == std::make_pair(true, defaults::CLIENT_PUBKEY));
+        CHECK(request(other_tls) == std::make_pair(true, other_pubkey));
+    }
+
+    TEST_CASE("001 - Handshaking: Admission control rate limit", "[001][handshake][admission]")
+    {
+        Network test_net{};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{};
+        Address client_local{};
+
+        // One new connection per source /24, with no meaningful refill during the test
+        opt::admission_control admission{};
+        admission.initial_rate = 0.001;
+        admission.initial_burst = 1;
+
+        auto server_endpoint = test_net.endpoint(server_local, admission);
+        REQUIRE_NOTHROW(server_endpoint->listen(server_tls));
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        callback_waiter first_established{[](connection_interface&) {}};
+        auto client_endpoint = test_net.endpoint(client_local);
+        auto first = client_endpoint->connect(client_remote, client_tls, first_established);
+        REQUIRE(first_established.wait());
+
+        callback_waiter second_established{[](connection_interface&) {}};
+        callback_waiter second_closed{[](connection_interface&, uint64_t) {}};
+        auto second = client_endpoint->connect(
+                client_remote, client_tls, second_established, second_closed, opt::handshake_timeout{500ms});
+        CHECK(second_closed.wait(5s));
+        CHECK_FALSE(second_established.is_ready());
+
+        auto stats = server_endpoint->get_admission_stats();
+        CHECK(stats.accepted == 1);
+        CHECK(stats.rejected_rate_limited >= 1);
+        CHECK(stats.rejected_half_open == 0);
+        CHECK(stats.retried == 0);
+        CHECK(stats.half_open == 0);
+
+        CHECK_THROWS(test_net.endpoint(client_local, opt::admission_control{.ipv4_prefix = 33}));
+    }
 }  // namespace oxen::quic::test
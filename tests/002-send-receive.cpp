@@ -230,6 +230,104 @@ namespace oxen::quic::test
         }
     }
 
+    TEST_CASE("002 - Idle connection slimming", "[002][simple][slimming]")
+    {
+        Network test_net{};
+        constexpr auto good_msg = "hello from the other siiiii-iiiiide"_bsv;
+
+        std::atomic<int> received{0};
+        stream_data_callback server_data_cb = [&](Stream&, bstring_view dat) {
+            CHECK(good_msg == dat);
+            ++received;
+        };
+
+        std::atomic<int> dgrams_received{0};
+        bstring last_dgram;  // Only touched from the server's event loop
+        dgram_data_callback server_dgram_cb = [&](dgram_interface&, bstring data) {
+            last_dgram = std::move(data);
+            ++dgrams_received;
+        };
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{};
+        Address client_local{};
+
+        opt::enable_datagrams split_dgram{Splitting::ACTIVE};
+
+        auto server_endpoint = test_net.endpoint(server_local, opt::idle_slimming{200ms}, split_dgram);
+        REQUIRE_NOTHROW(server_endpoint->listen(server_tls, server_data_cb, server_dgram_cb));
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        auto client_established = callback_waiter{[](connection_interface&) {}};
+
+        auto client_endpoint = test_net.endpoint(client_local, client_established, opt::idle_slimming{200ms}, split_dgram);
+        auto conn_interface = client_endpoint->connect(client_remote, client_tls);
+        REQUIRE(client_established.wait());
+
+        // Idle connections are checked every 250ms, so give `pred` a few checks' worth of time
+        auto wait_until = [](auto pred) {
+            for (int i = 0; i < 200 && !pred(); i++)
+                std::this_thread::sleep_for(10ms);
+            return pred();
+        };
+
+        SECTION("Send buffer")
+        {
+            auto client_stream = conn_interface->open_stream();
+            client_stream->send(good_msg);
+            REQUIRE(wait_until([&] { return received == 1; }));
+
+            auto buffer_allocated = [&] {
+                return client_endpoint->call_get([&] { return TestHelper::send_buffer_allocated(*conn_interface); });
+            };
+            CHECK(buffer_allocated());
+
+            CHECK(wait_until([&] { return !buffer_allocated(); }));
+
+            // The connection keeps working after its buffers were released
+            client_stream->send(good_msg);
+            REQUIRE(wait_until([&] { return received == 2; }));
+            CHECK(buffer_allocated());
+        }
+
+        SECTION("Split datagram reassembly buffer")
+        {
+            auto server_cis = server_endpoint->get_all_conns(Direction::INBOUND);
+            REQUIRE(server_cis.size() == 1);
+            auto server_ci = server_cis.front();
+
+            auto buffer_allocated = [&] {
+                return server_endpoint->call_get([&] { return TestHelper::datagram_buffer_allocated(*server_ci); });
+            };
+            CHECK_FALSE(buffer_allocated());
+
+            // Too large for one datagram, so it gets split and reassembled by the server
+            REQUIRE(wait_until([&] { return conn_interface->get_max_datagram_size() > 0; }));
+            std::string oversize_msg;
+            for (char v = 0; oversize_msg.size() < conn_interface->get_max_datagram_size() * 2;)
+                oversize_msg += v++;
+            auto expected = bstring{convert_sv<std::byte>(std::string_view{oversize_msg})};
+            auto last_dgram_is_oversize_msg = [&] {
+                return server_endpoint->call_get([&] { return last_dgram == expected; });
+            };
+
+            conn_interface->send_datagram(std::string{oversize_msg});
+            REQUIRE(wait_until([&] { return dgrams_received == 1; }));
+            CHECK(last_dgram_is_oversize_msg());
+            CHECK(buffer_allocated());
+
+            CHECK(wait_until([&] { return !buffer_allocated(); }));
+
+            // Reassembly still works once the rows were freed
+            conn_interface->send_datagram(std::string{oversize_msg});
+            REQUIRE(wait_until([&] { return dgrams_received == 2; }));
+            CHECK(last_dgram_is_oversize_msg());
+            CHECK(buffer_allocated());
+        }
+    }
+
     TEST_CASE("002 - BParser Testing", "[002][bparser]")
     {
         Network test_net{};
@@ -573,6 +671,59 @@ namespace oxen::quic::test
             CHECK(responses == good_responses);
         }
 
+        SECTION("Huge externally sent body")
+        {
+            std::promise<void> done_prom;
+            auto done = done_prom.get_future();
+
+            std::atomic<int> responses = 0, good_responses = 0;
+
+            const std::string req_msg(500'000, 'b');
+            constexpr auto res_msg = "oh look some b's"sv;
+
+            auto server_handler = [&](message msg) mutable {
+                if (msg)
+                    msg.respond(msg.body() == req_msg ? res_msg : "where are all the b's?!"sv);
+            };
+
+            auto client_reply_handler = [&](message msg) mutable {
+                if (msg)
+                {
+                    ++responses;
+                    if (msg.body() == res_msg)
+                        ++good_responses;
+                    if (responses == num_requests + 1)
+                        done_prom.set_value();
+                }
+            };
+
+            stream_constructor_callback server_constructor = [&](Connection& c, Endpoint& e, std::optional<int64_t>) {
+                auto s = e.make_shared<BTRequestStream>(c, e);
+                s->register_handler("test_endpoint"s, server_handler);
+                return s;
+            };
+
+            auto server_endpoint = test_net.endpoint(server_local);
+            REQUIRE_NOTHROW(server_endpoint->listen(server_tls, server_constructor));
+
+            RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+            auto client_endpoint = test_net.endpoint(client_local);
+            auto conn_interface = client_endpoint->connect(client_remote, client_tls);
+
+            std::shared_ptr<BTRequestStream> client_bp = conn_interface->open_stream<BTRequestStream>();
+
+            // Owned bodies are sent from their own buffer; interleave them with a copied one to make
+            // sure the parts of each request stay together on the stream.
+            for (int i = 0; i < num_requests; i++)
+                client_bp->command("test_endpoint"s, std::string{req_msg}, client_reply_handler);
+            client_bp->command("test_endpoint"s, req_msg, client_reply_handler);
+
+            require_future(done, 10s);
+            CHECK(good_responses == num_requests + 1);
+            CHECK(responses == good_responses);
+        }
+
         SECTION("Too huge")
         {
             std::string req_msg(10'000'000, 'a');
@@ -628,6 +779,118 @@ namespace oxen::quic::test
         }
     }
 
+    TEST_CASE("002 - BParser incremental parsing", "[002][bparser][incremental]")
+    {
+        Network test_net{};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{};
+        Address client_local{};
+
+        auto server_endpoint = test_net.endpoint(server_local);
+        REQUIRE_NOTHROW(server_endpoint->listen(server_tls));
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        auto client_endpoint = test_net.endpoint(client_local);
+        auto conn_interface = client_endpoint->connect(client_remote, client_tls);
+
+        auto client_bp = conn_interface->open_stream<BTRequestStream>();
+
+        // Only touched from inside the event loop, which is where TestHelper::bparser_receive feeds
+        // data to the parser.
+        std::vector<std::string> bodies;
+        client_bp->register_handler(TEST_ENDPOINT, [&](message m) { bodies.push_back(m.body_str()); });
+
+        auto encode = [](int64_t rid, std::string_view body) {
+            std::string list = "l1:Ci{}e{}:{}{}:{}e"_format(rid, TEST_ENDPOINT.size(), TEST_ENDPOINT, body.size(), body);
+            return "{}:{}"_format(list.size(), list);
+        };
+        auto feed = [&](std::string_view data) { TestHelper::bparser_receive(*client_bp, convert_sv<std::byte>(data)); };
+
+        const std::string big(5000, 'x');
+        const auto reqs = encode(1, "one") + encode(2, big) + encode(3, "three");
+
+        SECTION("Several whole requests in one chunk")
+        {
+            feed(reqs);
+        }
+
+        SECTION("Requests split at every possible point")
+        {
+            for (size_t split = 1; split < reqs.size(); split += 7)
+            {
+                bodies.clear();
+                feed(std::string_view{reqs}.substr(0, split));
+                feed(std::string_view{reqs}.substr(split));
+                REQUIRE(bodies.size() == 3);
+            }
+            bodies.clear();
+            feed(reqs);
+        }
+
+        SECTION("Byte-by-byte")
+        {
+            for (char c : reqs)
+                feed(std::string_view{&c, 1});
+        }
+
+        REQUIRE(bodies.size() == 3);
+        CHECK(bodies[0] == "one");
+        CHECK(bodies[1] == big);
+        CHECK(bodies[2] == "three");
+    }
+
+    TEST_CASE("002 - BParser streamed command limit", "[002][bparser][streaming]")
+    {
+        Network test_net{};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{};
+        Address client_local{};
+
+        auto server_endpoint = test_net.endpoint(server_local);
+        REQUIRE_NOTHROW(server_endpoint->listen(server_tls));
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        auto client_endpoint = test_net.endpoint(client_local);
+        callback_waiter client_established{[](connection_interface&) {}};
+        auto conn_interface = client_endpoint->connect(client_remote, client_tls, client_established);
+        REQUIRE(client_established.wait());
+
+        auto client_bp = conn_interface->open_stream<BTRequestStream>();
+
+        // Only touched from inside the event loop (see TestHelper::bparser_receive)
+        size_t chunks = 0;
+        client_bp->register_stream_handler(TEST_ENDPOINT, [&](message) { chunks++; });
+
+        // One frame of a streamed command; an empty chunk ends the command
+        auto feed_chunk = [&](int64_t rid, std::string_view chunk) {
+            std::string list = "l1:Si{}e{}:{}{}:{}e"_format(rid, TEST_ENDPOINT.size(), TEST_ENDPOINT, chunk.size(), chunk);
+            auto frame = "{}:{}"_format(list.size(), list);
+            TestHelper::bparser_receive(*client_bp, convert_sv<std::byte>(std::string_view{frame}));
+        };
+
+        for (int64_t rid = 0; rid < static_cast<int64_t>(MAX_INCOMING_STREAMED_REQS); rid++)
+            feed_chunk(rid, "hello");
+        CHECK(chunks == MAX_INCOMING_STREAMED_REQS);
+        CHECK_FALSE(client_bp->is_closing());
+
+        // Finishing a streamed command makes room for another
+        feed_chunk(0, "");
+        feed_chunk(1000, "hello");
+        CHECK(chunks == MAX_INCOMING_STREAMED_REQS + 2);
+        CHECK_FALSE(client_bp->is_closing());
+
+        // ...but starting one more while the limit is reached closes the stream
+        feed_chunk(1001, "hello");
+        CHECK(chunks == MAX_INCOMING_STREAMED_REQS + 2);
+        CHECK(client_bp->is_closing());
+    }
+
     TEST_CASE("002 - BParser generic request handler", "[002][bparser][generic]")
     {
         Network test_net{};
@@ -738,4 +1001,530 @@ namespace oxen::quic::test
         if (slow_response.joinable())
             slow_response.join();
     }
+
+    TEST_CASE("002 - BParser mixed request timeouts", "[002][bparser][timeout]")
+    {
+        // Declared before the network: the long request gets timed out when the stream is destroyed
+        std::atomic<bool> long_timed_out = false;
+
+        Network test_net{};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{};
+        Address client_local{};
+
+        auto server_conn_est = [&](connection_interface& c) {
+            auto s = c.queue_incoming_stream<BTRequestStream>();
+            // Never responds, so every request has to time out
+            s->register_handler("black_hole"s, [](message) {});
+        };
+
+        auto server_endpoint = test_net.endpoint(server_local);
+        server_endpoint->listen(server_tls, server_conn_est);
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        auto client_endpoint = test_net.endpoint(client_local);
+        auto conn_interface = client_endpoint->connect(client_remote, client_tls);
+
+        auto client_bp = conn_interface->open_stream<BTRequestStream>();
+
+        client_bp->command("black_hole"s, "slow"s, [&](message m) { long_timed_out = m.timed_out; }, 30s);
+
+        // Sent *after* the long-timeout request, but has to be reaped well before it
+        bool short_timed_out = false;
+        callback_waiter short_handler{[&](message m) { short_timed_out = m.timed_out; }};
+        auto sent_at = std::chrono::steady_clock::now();
+        client_bp->command("black_hole"s, "fast"s, short_handler, 100ms);
+
+        REQUIRE(short_handler.wait(5s));
+        CHECK(short_timed_out);
+        CHECK(std::chrono::steady_clock::now() - sent_at < 5s);
+        CHECK_FALSE(long_timed_out);
+    }
+
+    TEST_CASE("002 - BParser worker pool handlers", "[002][bparser][workers]")
+    {
+        Network test_net{};
+
+        auto pool = std::make_shared<WorkerPool>(4);
+        auto other_pool = std::make_shared<WorkerPool>(1);
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{};
+        Address client_local{};
+
+        std::atomic<bool> ran_on_worker{true};
+        std::atomic<bool> ran_on_other_worker{true};
+        std::mutex order_mutex;
+        std::vector<std::string> handled_order;
+
+        auto server_conn_est = [&](connection_interface& c) {
+            auto s = c.queue_incoming_stream<BTRequestStream>();
+            s->register_handler(
+                    "slow"s,
+                    [&, p = pool.get()](message m) {
+                        if (!p->in_worker())
+                            ran_on_worker = false;
+                        std::this_thread::sleep_for(250ms);
+                        m.respond("slow done"sv);
+                    },
+                    handler_policy{pool});
+            s->register_handler("fast"s, [](message m) { m.respond("fast done"sv); });
+            s->register_handler(
+                    "seq"s,
+                    [&, p = pool.get()](message m) {
+                        if (!p->in_worker())
+                            ran_on_worker = false;
+                        // Stagger the handlers so that concurrent execution would reorder them
+                        auto i = std::stoi(m.body_str());
+                        std::this_thread::sleep_for(std::chrono::milliseconds{(7 - i % 7) * 2});
+                        {
+                            std::lock_guard lock{order_mutex};
+                            handled_order.push_back(m.body_str());
+                        }
+                        m.respond(m.body());
+                    },
+                    handler_policy{pool, true});
+            s->register_handler(
+                    "other"s,
+                    [&, p = other_pool.get()](message m) {
+                        if (!p->in_worker())
+                            ran_on_other_worker = false;
+                        std::this_thread::sleep_for(100ms);
+                        m.respond("other done"sv);
+                    },
+                    handler_policy{other_pool, true});
+        };
+
+        auto server_endpoint = test_net.endpoint(server_local);
+        server_endpoint->listen(server_tls, server_conn_est);
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        auto client_endpoint = test_net.endpoint(client_local);
+        auto conn_interface = client_endpoint->connect(client_remote, client_tls);
+
+        auto client_bp = conn_interface->open_stream<BTRequestStream>();
+
+        SECTION("Slow pool handlers do not block inline handlers")
+        {
+            std::mutex mut;
+            std::vector<std::string> responses;
+            std::promise<void> done_prom;
+            auto done = done_prom.get_future();
+
+            auto on_response = [&](message m) {
+                std::lock_guard lock{mut};
+                responses.push_back(m ? m.body_str() : "failed"s);
+                if (responses.size() == 2)
+                    done_prom.set_value();
+            };
+
+            client_bp->command("slow"s, "a"sv, on_response);
+            client_bp->command("fast"s, "b"sv, on_response);
+
+            require_future(done);
+            std::lock_guard lock{mut};
+            REQUIRE(responses.size() == 2);
+            CHECK(responses[0] == "fast done");
+            CHECK(responses[1] == "slow done");
+            CHECK(ran_on_worker);
+        }
+
+        SECTION("Ordered pool handlers preserve per-stream order")
+        {
+            constexpr int num_requests = 30;
+
+            std::atomic<int> responses{0};
+            std::atomic<bool> bad_response{false};
+            std::promise<void> done_prom;
+            auto done = done_prom.get_future();
+
+            for (int i = 0; i < num_requests; i++)
+                client_bp->command("seq"s, std::to_string(i), [&, i](message m) {
+                    if (!m || m.body_str() != std::to_string(i))
+                        bad_response = true;
+                    if (++responses == num_requests)
+                        done_prom.set_value();
+                });
+
+            require_future(done);
+            CHECK_FALSE(bad_response);
+            CHECK(ran_on_worker);
+
+            std::lock_guard lock{order_mutex};
+            REQUIRE(handled_order.size() == num_requests);
+            for (int i = 0; i < num_requests; i++)
+                CHECK(handled_order[i] == std::to_string(i));
+        }
+
+        SECTION("Ordered handlers on different pools each run on their own pool")
+        {
+            constexpr int num_requests = 10;
+
+            std::atomic<int> responses{0};
+            std::promise<void> done_prom;
+            auto done = done_prom.get_future();
+
+            auto on_response = [&](message) {
+                if (++responses == num_requests + 1)
+                    done_prom.set_value();
+            };
+
+            // The "other" handler is still running (on `other_pool`) when the "seq" requests arrive
+            client_bp->command("other"s, ""sv, on_response);
+            for (int i = 0; i < num_requests; i++)
+                client_bp->command("seq"s, std::to_string(i), on_response);
+
+            require_future(done);
+            CHECK(ran_on_worker);
+            CHECK(ran_on_other_worker);
+
+            std::lock_guard lock{order_mutex};
+            REQUIRE(handled_order.size() == num_requests);
+            for (int i = 0; i < num_requests; i++)
+                CHECK(handled_order[i] == std::to_string(i));
+        }
+    }
+
+    TEST_CASE("002 - BParser endpoint stats", "[002][bparser][stats]")
+    {
+        Network test_net{};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{};
+        Address client_local{};
+
+        std::promise<std::shared_ptr<BTRequestStream>> server_stream_prom;
+        auto server_stream_fut = server_stream_prom.get_future();
+
+        auto server_conn_est = [&](connection_interface& c) {
+            auto s = c.queue_incoming_stream<BTRequestStream>();
+            s->register_handler("echo"s, [](message m) { m.respond(m.body()); });
+            s->register_handler("fail"s, [](message) { throw std::runtime_error{"oops"}; });
+            s->register_handler("unused"s, [](message) {});
+            server_stream_prom.set_value(s);
+        };
+
+        auto server_endpoint = test_net.endpoint(server_local);
+        server_endpoint->listen(server_tls, server_conn_est);
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        auto client_endpoint = test_net.endpoint(client_local);
+        auto conn_interface = client_endpoint->connect(client_remote, client_tls);
+
+        auto client_bp = conn_interface->open_stream<BTRequestStream>();
+
+        constexpr int num_echo = 5, num_fail = 2;
+
+        std::atomic<int> responses{0}, errors{0};
+        std::promise<void> done_prom;
+        auto done = done_prom.get_future();
+        auto on_response = [&](message m) {
+            if (m.is_error())
+                ++errors;
+            if (++responses == num_echo + num_fail)
+                done_prom.set_value();
+        };
+
+        for (int i = 0; i < num_echo; i++)
+            client_bp->command("echo"s, "hello"sv, on_response);
+        for (int i = 0; i < num_fail; i++)
+            client_bp->command("fail"s, "hello"sv, on_response);
+
+        require_future(done);
+        CHECK(errors == num_fail);
+
+        auto server_bp = server_stream_fut.get();
+
+        auto stats = server_bp->handler_stats();
+        REQUIRE(stats.size() == 3);
+        CHECK(stats["echo"].calls == num_echo);
+        CHECK(stats["echo"].errors == 0);
+        CHECK(stats["fail"].calls == num_fail);
+        CHECK(stats["fail"].errors == num_fail);
+        CHECK(stats["unused"].calls == 0);
+
+        auto& echo = stats["echo"];
+        uint64_t histogram_total = 0;
+        for (auto n : echo.latency_histogram)
+            histogram_total += n;
+        CHECK(histogram_total == num_echo);
+        CHECK(echo.max_latency >= echo.mean_latency());
+        CHECK(echo.latency_percentile(1.0) >= std::chrono::duration_cast<std::chrono::microseconds>(echo.max_latency));
+
+        auto fail = server_bp->handler_stats("fail"sv);
+        REQUIRE(fail);
+        CHECK(fail->calls == num_fail);
+        CHECK_FALSE(server_bp->handler_stats("nope"sv));
+    }
+
+    TEST_CASE("002 - BParser streamed bodies", "[002][bparser][streaming]")
+    {
+        Network test_net{};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{};
+        Address client_local{};
+
+        // Larger than MAX_REQ_LEN, so only possible with streaming
+        constexpr size_t big_size = 12'000'000;
+        constexpr size_t producer_chunk = 1'000'000;
+
+        // Returns a producer for `total` bytes of the repeating alphabet, in `chunk`-sized pieces
+        auto make_producer = [](size_t total, size_t chunk) {
+            return [total, chunk, produced = size_t{0}]() mutable {
+                std::string s;
+                for (size_t n = std::min(chunk, total - produced); s.size() < n; ++produced)
+                    s += static_cast<char>('a' + produced % 26);
+                return s;
+            };
+        };
+
+        // Only touched from the server's event loop
+        std::unordered_map<int64_t, size_t> upload_received;
+        bool upload_bad_chunk = false;
+
+        // Streamed handler (and an unrelated ordered handler) on worker pools; the chunk handlers
+        // of a request run one at a time, so these need no lock of their own.
+        auto upload_pool = std::make_shared<WorkerPool>(4);
+        auto other_pool = std::make_shared<WorkerPool>(1);
+        size_t pool_upload_received = 0;
+        std::atomic<bool> pool_upload_bad{false};
+
+        auto server_conn_est = [&](connection_interface& c) {
+            auto s = c.queue_incoming_stream<BTRequestStream>();
+            s->register_stream_handler("upload"s, [&](message m) {
+                auto& received = upload_received[m.rid()];
+                auto chunk = m.body();
+                if (!m.is_chunk() || chunk.size() > MAX_STREAM_CHUNK)
+                    upload_bad_chunk = true;
+                for (char c : chunk)
+                    if (c != static_cast<char>('a' + received++ % 26))
+                        upload_bad_chunk = true;
+                if (m.is_last_chunk())
+                    m.respond(std::to_string(received));
+            });
+            s->register_handler("download"s, [&](message m) {
+                m.respond_stream(make_producer(std::stoul(m.body_str()), producer_chunk));
+            });
+            s->register_handler("plain"s, [](message m) { m.respond("plain"sv); });
+            s->register_stream_handler(
+                    "pool_upload"s,
+                    [&, p = upload_pool.get()](message m) {
+                        if (!p->in_worker())
+                            pool_upload_bad = true;
+                        for (char c : m.body())
+                            if (c != static_cast<char>('a' + pool_upload_received++ % 26))
+                                pool_upload_bad = true;
+                        if (m.is_last_chunk())
+                            m.respond(std::to_string(pool_upload_received));
+                    },
+                    handler_policy{upload_pool});
+            s->register_handler(
+                    "other"s,
+                    [](message m) {
+                        std::this_thread::sleep_for(100ms);
+                        m.respond("other done"sv);
+                    },
+                    handler_policy{other_pool, true});
+        };
+
+        auto server_endpoint = test_net.endpoint(server_local);
+        server_endpoint->listen(server_tls, server_conn_est);
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        auto client_endpoint = test_net.endpoint(client_local);
+        auto conn_interface = client_endpoint->connect(client_remote, client_tls);
+
+        auto client_bp = conn_interface->open_stream<BTRequestStream>();
+
+        SECTION("Streamed command")
+        {
+            std::promise<std::string> response_prom;
+            auto response = response_prom.get_future();
+
+            client_bp->command_stream(
+                    "upload"s, make_producer(big_size, producer_chunk), [&](message m) {
+                        response_prom.set_value(m ? m.body_str() : "failed"s);
+                    });
+
+            // Other requests are not held up behind the streamed body
+            std::promise<void> plain_prom;
+            auto plain = plain_prom.get_future();
+            client_bp->command("plain"s, ""sv, [&](message) { plain_prom.set_value(); });
+
+            require_future(plain);
+            require_future(response, 30s);
+            CHECK(response.get() == std::to_string(big_size));
+            CHECK_FALSE(upload_bad_chunk);
+        }
+
+        SECTION("Streamed command on a worker pool")
+        {
+            constexpr size_t size = 20 * MAX_STREAM_CHUNK + 45;
+
+            std::promise<std::string> response_prom;
+            auto response = response_prom.get_future();
+
+            // Keeps `other_pool`'s ordered queue busy while the upload's chunks arrive
+            client_bp->command("other"s, ""sv, [](message) {});
+            client_bp->command_stream("pool_upload"s, make_producer(size, 10'000), [&](message m) {
+                response_prom.set_value(m ? m.body_str() : "failed"s);
+            });
+
+            require_future(response, 10s);
+            CHECK(response.get() == std::to_string(size));
+            CHECK_FALSE(pool_upload_bad);
+        }
+
+        SECTION("Streamed command to an ordinary endpoint is rejected")
+        {
+            std::promise<bool> error_prom;
+            auto error = error_prom.get_future();
+
+            client_bp->command_stream(
+                    "plain"s, make_producer(1000, 100), [&](message m) { error_prom.set_value(m.is_error()); });
+
+            require_future(error);
+            CHECK(error.get());
+        }
+
+        SECTION("Chunked streamed response")
+        {
+            size_t received = 0, chunks = 0;
+            bool bad = false;
+            std::promise<void> done_prom;
+            auto done = done_prom.get_future();
+
+            client_bp->command(
+                    "download"s,
+                    std::to_string(big_size),
+                    [&](message m) {
+                        if (!m || !m.is_chunk())
+                        {
+                            bad = true;
+                            return done_prom.set_value();
+                        }
+                        chunks++;
+                        for (char c : m.body())
+                            if (c != static_cast<char>('a' + received++ % 26))
+                                bad = true;
+                        if (m.is_last_chunk())
+                            done_prom.set_value();
+                    },
+                    chunked_response{});
+
+            require_future(done, 30s);
+            CHECK_FALSE(bad);
+            CHECK(received == big_size);
+            CHECK(chunks > big_size / MAX_STREAM_CHUNK);
+        }
+
+        SECTION("Reassembled streamed response")
+        {
+            constexpr size_t size = 3 * MAX_STREAM_CHUNK + 123;
+
+            std::promise<std::string> body_prom;
+            auto body = body_prom.get_future();
+
+            client_bp->command("download"s, std::to_string(size), [&](message m) {
+                body_prom.set_value(m && !m.is_chunk() ? m.body_str() : "failed"s);
+            });
+
+            require_future(body, 10s);
+            auto b = body.get();
+            REQUIRE(b.size() == size);
+            CHECK(b == make_producer(size, size)());
+        }
+
+        SECTION("Streamed response too large to reassemble")
+        {
+            std::promise<bool> error_prom;
+            auto error = error_prom.get_future();
+
+            client_bp->command(
+                    "download"s, std::to_string(big_size), [&](message m) { error_prom.set_value(m.is_error()); });
+
+            require_future(error, 30s);
+            CHECK(error.get());
+        }
+    }
+
+    TEST_CASE("002 - shared_buffer send buffers", "[002][simple][shared_buffer]")
+    {
+        Network test_net{};
+        constexpr auto good_msg = "hello from the other siiiii-iiiiide"_bsv;
+        const bstring big_msg(5000, std::byte{'b'});
+
+        std::atomic<size_t> received{0};
+        stream_data_callback server_data_cb = [&](Stream&, bstring_view dat) { received += dat.size(); };
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{};
+        Address client_local{};
+
+        auto server_endpoint = test_net.endpoint(server_local);
+        REQUIRE_NOTHROW(server_endpoint->listen(server_tls, server_data_cb));
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        auto client_endpoint = test_net.endpoint(client_local);
+        auto conn_interface = client_endpoint->connect(client_remote, client_tls);
+        auto client_stream = conn_interface->open_stream();
+
+        // Small buffers come from the event loop's pool, large ones from operator new
+        auto small = shared_buffer::copy(client_stream->buffer_pool(), good_msg);
+        auto big = shared_buffer::copy(client_stream->buffer_pool(), big_msg);
+        REQUIRE(small.view() == good_msg);
+        REQUIRE(big.view() == big_msg);
+
+        // Hold on to a reference of each, so that we can see the stream release its references
+        client_stream->send(small);
+        client_stream->send(big);
+        client_stream->send(bstring{good_msg});
+
+        auto expected = 2 * good_msg.size() + big_msg.size();
+        for (int i = 0; i < 200 && (received < expected || small.use_count() > 1 || big.use_count() > 1); i++)
+            std::this_thread::sleep_for(25ms);
+
+        CHECK(received == expected);
+        CHECK(small.use_count() == 1);
+        CHECK(big.use_count() == 1);
+    }
+
+    TEST_CASE("002 - shared_buffer lifetimes", "[002][shared_buffer][lifetime]")
+    {
+        constexpr auto msg = "outlives the event loop"_bsv;
+
+        shared_buffer survivor;
+        {
+            Network test_net{};
+            auto ep = test_net.endpoint(Address{});
+            survivor = shared_buffer::copy(ep->pool(), msg);
+        }
+
+        // The loop (and its last reference to the pool) is gone, but the pool lives on until the
+        // buffer is released
+        CHECK(survivor.view() == msg);
+        survivor.reset();
+        CHECK_FALSE(survivor);
+
+        // Wrapping a keep-alive just holds on to it
+        auto keep_alive = std::make_shared<std::string>("keep me");
+        auto wrapped = shared_buffer::wrap(keep_alive);
+        CHECK(wrapped);
+        CHECK(wrapped.view().empty());
+        CHECK(keep_alive.use_count() == 2);
+        wrapped.reset();
+        CHECK(keep_alive.use_count() == 1);
+    }
 }  // namespace oxen::quic::test
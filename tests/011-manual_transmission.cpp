@@ -58,6 +58,182 @@ namespace oxen::quic::test
         require_future(d_future);
     }
 
+    TEST_CASE("011 - Manual Transmission: Batched send hook", "[011][manual][batch]")
+    {
+        auto client_established = callback_waiter{[](connection_interface&) {}};
+        auto server_established = callback_waiter{[](connection_interface&) {}};
+
+        Network test_net{};
+
+        constexpr size_t msg_size = 1'000'000;
+        bstring msg;
+        msg.resize(msg_size);
+        for (size_t i = 0; i < msg_size; i++)
+            msg[i] = static_cast<std::byte>(i % 251);
+
+        std::promise<bool> d_promise;
+        std::future<bool> d_future = d_promise.get_future();
+        bstring received;
+
+        stream_data_callback server_data_cb = [&](Stream&, bstring_view dat) {
+            received += dat;
+            if (received.size() == msg_size)
+                d_promise.set_value(received == msg);
+        };
+
+        std::shared_ptr<Endpoint> client_endpoint, server_endpoint;
+
+        // Only touched from the event loop
+        size_t batches = 0, max_batch = 0, blocked = 0;
+
+        // Takes just the first packet of every other multi-packet batch, reporting itself blocked
+        // until the event loop gets around to signalling that it is writeable again.
+        opt::manual_routing client_sender{
+                [&](const Path& p, const std::byte* bufs, const size_t* bufsize, uint8_t, size_t n_pkts)
+                        -> std::pair<io_result, size_t> {
+                    max_batch = std::max(max_batch, n_pkts);
+                    size_t take = (++batches % 2 == 0 && n_pkts > 1) ? 1 : n_pkts;
+
+                    // Delivered from the event loop, as our own transport would, rather than from
+                    // inside the client connection's send.
+                    for (size_t i = 0; i < take; i++)
+                    {
+                        test_net.call_soon([&, pkt = Packet{p.invert(), bstring{bufs, bufsize[i]}}]() mutable {
+                            server_endpoint->manually_receive_packet(std::move(pkt));
+                        });
+                        bufs += bufsize[i];
+                    }
+
+                    if (take == n_pkts)
+                        return {io_result{}, n_pkts};
+
+                    ++blocked;
+                    test_net.call_soon([&] { client_endpoint->manually_signal_writeable(); });
+                    return {io_result{EAGAIN}, take};
+                }};
+
+        opt::manual_routing server_sender{[&](const Path& p, bstring_view d) {
+            client_endpoint->manually_receive_packet(Packet{p.invert(), d});
+        }};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{};
+        Address client_local{};
+
+        server_endpoint = test_net.endpoint(server_local, server_sender, server_established);
+        REQUIRE_NOTHROW(server_endpoint->listen(server_tls, server_data_cb));
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, server_local};
+
+        client_endpoint = test_net.endpoint(client_local, client_sender, client_established);
+
+        auto conn_interface = client_endpoint->connect(client_remote, client_tls);
+
+        CHECK(client_established.wait());
+        CHECK(server_established.wait());
+
+        auto client_stream = conn_interface->open_stream();
+        client_stream->send(bstring{msg});
+
+        require_future(d_future, 10s);
+        CHECK(d_future.get());
+
+        auto [n_batches, largest, n_blocked] =
+                test_net.call_get([&] { return std::make_tuple(batches, max_batch, blocked); });
+        CHECK(n_batches > 0);
+        CHECK(largest > 1);
+        CHECK(n_blocked > 0);
+    }
+
+    TEST_CASE("011 - Manual Transmission: Receive batches", "[011][manual][rxbatch]")
+    {
+        auto client_established = callback_waiter{[](connection_interface&) {}};
+
+        Network test_net{};
+
+        std::shared_ptr<Endpoint> client_endpoint, server_endpoint;
+
+        // Only touched from the event loop: while `capture` is set, the client's packets are kept
+        // here instead of being delivered, to be handed to the server as a single receive batch.
+        bool capture = false;
+        std::vector<Packet> captured;
+
+        opt::manual_routing client_sender{[&](const Path& p, bstring_view d) {
+            if (capture)
+                captured.emplace_back(p.invert(), bstring{d});
+            else
+                server_endpoint->manually_receive_packet(Packet{p.invert(), d});
+        }};
+
+        opt::manual_routing server_sender{[&](const Path& p, bstring_view d) {
+            client_endpoint->manually_receive_packet(Packet{p.invert(), d});
+        }};
+
+        // Small enough to all go out at once, without waiting for acks
+        constexpr size_t msg_size = 8'000;
+        std::promise<void> d_promise;
+        std::future<void> d_future = d_promise.get_future();
+        size_t received = 0;
+
+        stream_data_callback server_data_cb = [&](Stream&, bstring_view dat) {
+            if ((received += dat.size()) == msg_size)
+                d_promise.set_value();
+        };
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{};
+        Address client_local{};
+
+        server_endpoint = test_net.endpoint(server_local, server_sender);
+        REQUIRE_NOTHROW(server_endpoint->listen(server_tls, server_data_cb));
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, server_local};
+
+        client_endpoint = test_net.endpoint(client_local, client_sender, client_established);
+
+        auto client_ci = client_endpoint->connect(client_remote, client_tls);
+        REQUIRE(client_established.wait());
+
+        auto server_cis = server_endpoint->get_all_conns(Direction::INBOUND);
+        REQUIRE(server_cis.size() == 1);
+        auto server_ci = server_cis.front();
+
+        // Captures the packets the client sends for a stream of `msg_size` bytes, which are all
+        // sent in one go; they're all there once no more are coming.
+        test_net.call_get([&] { capture = true; });
+        auto client_stream = client_ci->open_stream();
+        client_stream->send(bstring(msg_size, std::byte{'b'}));
+
+        std::vector<Packet> batch;
+        for (size_t i = 0, last = 0; i < 100 && batch.empty(); i++)
+        {
+            std::this_thread::sleep_for(10ms);
+            test_net.call_get([&] {
+                if (!captured.empty() && captured.size() == last)
+                {
+                    capture = false;
+                    batch = std::exchange(captured, {});
+                }
+                last = captured.size();
+            });
+        }
+        REQUIRE(batch.size() > 1);
+
+        SECTION("One flush per batch")
+        {
+            CHECK(TestHelper::receive_batch(*server_endpoint, batch) == 1);
+            require_future(d_future);
+        }
+
+        SECTION("Connection closed mid-batch")
+        {
+            CHECK(TestHelper::receive_batch(
+                          *server_endpoint, batch, [&] { TestHelper::close_connection_now(*server_ci); }) == 0);
+        }
+    }
+
     /** Binary test case:
         This is designed to emulate the use case in which a manually routed endpoint is using a normal QUIC endpoint as a
         tunnel to connect to a remote manual endpoint.
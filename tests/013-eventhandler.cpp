@@ -80,4 +80,41 @@ namespace oxen::quic::test
         REQUIRE(recv_counter == send_counter);
         REQUIRE_FALSE(handler->is_running());
     }
+
+    TEST_CASE("013 - Event loop statistics", "[013][loop][stats]")
+    {
+        Network test_net{};
+
+        CHECK_FALSE(test_net.get_loop_stats().jobs);
+
+        test_net.enable_loop_stats(true, 5ms);
+
+        std::atomic<int> ran{0};
+        for (int i = 0; i < 100; i++)
+            test_net.call_soon([&ran] { ran++; });
+        test_net.call_soon([] { std::this_thread::sleep_for(2ms); });
+
+        std::promise<void> timer_prom;
+        auto timer_fut = timer_prom.get_future();
+        test_net.call_later(1ms, [&timer_prom] { timer_prom.set_value(); });
+        require_future(timer_fut);
+
+        // Give the lag probe time to fire a few times
+        std::this_thread::sleep_for(50ms);
+
+        auto stats = test_net.get_loop_stats();
+        CHECK(ran == 100);
+        CHECK(stats.jobs >= 102);
+        CHECK(stats.job_queue_high_water >= 1);
+        CHECK(stats.job_time_max >= 2ms);
+        // The sleeping job lands in the [1ms, 10ms) bucket
+        CHECK(stats.job_times[3] >= 1);
+        CHECK(stats.timers >= 1);
+        CHECK(stats.lag_samples >= 1);
+        CHECK_FALSE(stats.to_string().empty());
+
+        test_net.enable_loop_stats(false);
+        test_net.call_get([] {});
+        CHECK(test_net.get_loop_stats().jobs == 0);
+    }
 }  //  namespace oxen::quic::test
@@ -0,0 +1,315 @@
+#include <catch2/catch_test_macros.hpp>
+#include <oxen/quic.hpp>
+#include <oxen/quic/connection.hpp>
+#include <oxen/quic/datagram.hpp>
+#include <oxen/quic/gnutls_crypto.hpp>
+#include <oxen/quic/messages.hpp>
+#include <oxen/quic/opt.hpp>
+#include <thread>
+
+#include "utils.hpp"
+
+namespace oxen::quic::test
+{
+    using namespace std::literals;
+
+    static std::vector<bstring> make_payloads(int n)
+    {
+        std::vector<bstring> payloads;
+        for (int i = 0; i < n; ++i)
+        {
+            // Deliberately uneven sizes so that the parity padding and length recovery get exercised
+            bstring p;
+            p.resize(17 + 31 * i);
+            for (size_t j = 0; j < p.size(); ++j)
+                p[j] = static_cast<std::byte>((i * 7 + j) % 256);
+            payloads.push_back(std::move(p));
+        }
+        return payloads;
+    }
+
+    TEST_CASE("014 - Datagram FEC: Option validation", "[014][datagrams][fec][types]")
+    {
+        REQUIRE_NOTHROW(opt::datagram_fec{});
+        REQUIRE_NOTHROW(opt::datagram_fec{1});
+        REQUIRE_NOTHROW(opt::datagram_fec{opt::datagram_fec::MAX_GROUP_SIZE});
+        REQUIRE_THROWS(opt::datagram_fec{0});
+        REQUIRE_THROWS(opt::datagram_fec{opt::datagram_fec::MAX_GROUP_SIZE + 1});
+        REQUIRE_NOTHROW(opt::datagram_fec{8, 0ms});
+        REQUIRE_THROWS(opt::datagram_fec{8, -1ms});
+    }
+
+    TEST_CASE("014 - Datagram FEC: Encode and recover", "[014][datagrams][fec][codec]")
+    {
+        constexpr int K = 5;
+        auto payloads = make_payloads(K);
+
+        fec_encoder enc{K};
+        std::vector<bstring> framed(K);
+        std::optional<bstring> parity;
+
+        for (int i = 0; i < K; ++i)
+        {
+            parity = enc.encode(payloads[i], framed[i]);
+            REQUIRE(framed[i].size() == payloads[i].size() + FEC_HEADER_SIZE);
+            if (i < K - 1)
+                REQUIRE_FALSE(parity);
+        }
+        REQUIRE(parity);
+        CHECK(enc.group == 1);
+        CHECK(enc.index == 0);
+
+        SECTION("No loss")
+        {
+            fec_decoder dec{};
+            for (int i = 0; i < K; ++i)
+            {
+                auto res = dec.receive(framed[i]);
+                REQUIRE(res.data);
+                CHECK(*res.data == payloads[i]);
+                CHECK_FALSE(res.recovered);
+            }
+            auto res = dec.receive(*parity);
+            CHECK_FALSE(res.data);
+            CHECK_FALSE(res.recovered);
+            CHECK(dec.recovered_count == 0);
+        }
+
+        SECTION("Any single loss is recovered")
+        {
+            for (int lost = 0; lost < K; ++lost)
+            {
+                fec_decoder dec{};
+                std::optional<bstring> recovered;
+
+                for (int i = 0; i < K; ++i)
+                {
+                    if (i == lost)
+                        continue;
+                    auto res = dec.receive(framed[i]);
+                    REQUIRE(res.data);
+                    CHECK(*res.data == payloads[i]);
+                    CHECK_FALSE(res.recovered);
+                }
+
+                auto res = dec.receive(*parity);
+                CHECK_FALSE(res.data);
+                REQUIRE(res.recovered);
+                CHECK(*res.recovered == payloads[lost]);
+                CHECK(dec.recovered_count == 1);
+
+                // A late arrival of the reconstructed datagram must not be delivered twice
+                auto late = dec.receive(framed[lost]);
+                CHECK_FALSE(late.data);
+                CHECK_FALSE(late.recovered);
+            }
+        }
+
+        SECTION("Parity arriving before the data")
+        {
+            fec_decoder dec{};
+            auto res = dec.receive(*parity);
+            CHECK_FALSE(res.data);
+            CHECK_FALSE(res.recovered);
+
+            for (int i = 1; i < K; ++i)
+            {
+                res = dec.receive(framed[i]);
+                REQUIRE(res.data);
+                CHECK(*res.data == payloads[i]);
+                if (i < K - 1)
+                    CHECK_FALSE(res.recovered);
+            }
+            REQUIRE(res.recovered);
+            CHECK(*res.recovered == payloads[0]);
+        }
+
+        SECTION("Two losses cannot be recovered")
+        {
+            fec_decoder dec{};
+            for (int i = 2; i < K; ++i)
+                REQUIRE(dec.receive(framed[i]).data);
+            auto res = dec.receive(*parity);
+            CHECK_FALSE(res.recovered);
+            CHECK(dec.recovered_count == 0);
+        }
+    }
+
+    TEST_CASE("014 - Datagram FEC: Flushed partial group", "[014][datagrams][fec][codec][flush]")
+    {
+        constexpr int K = 8;
+        constexpr int N = 3;
+        auto payloads = make_payloads(N + K);
+
+        fec_encoder enc{K};
+        CHECK_FALSE(enc.flush());
+
+        std::vector<bstring> framed(N);
+        for (int i = 0; i < N; ++i)
+            REQUIRE_FALSE(enc.encode(payloads[i], framed[i]));
+
+        auto parity = enc.flush();
+        REQUIRE(parity);
+        CHECK(enc.group == 1);
+        CHECK(enc.index == 0);
+        CHECK_FALSE(enc.flush());
+
+        // The next group is unaffected
+        std::vector<bstring> next(K);
+        std::optional<bstring> next_parity;
+        for (int i = 0; i < K; ++i)
+            next_parity = enc.encode(payloads[N + i], next[i]);
+        REQUIRE(next_parity);
+
+        for (bool parity_first : {false, true})
+        {
+            for (int lost = 0; lost < N; ++lost)
+            {
+                fec_decoder dec{};
+                std::optional<bstring> recovered;
+
+                if (parity_first)
+                    CHECK_FALSE(dec.receive(*parity).data);
+                for (int i = 0; i < N; ++i)
+                {
+                    if (i == lost)
+                        continue;
+                    auto res = dec.receive(framed[i]);
+                    REQUIRE(res.data);
+                    CHECK(*res.data == payloads[i]);
+                    if (res.recovered)
+                        recovered = std::move(res.recovered);
+                }
+                if (!parity_first)
+                {
+                    auto res = dec.receive(*parity);
+                    CHECK_FALSE(res.data);
+                    recovered = std::move(res.recovered);
+                }
+
+                REQUIRE(recovered);
+                CHECK(*recovered == payloads[lost]);
+                CHECK_FALSE(dec.receive(framed[lost]).data);
+
+                for (int i = 1; i < K; ++i)
+                    REQUIRE(dec.receive(next[i]).data);
+                auto res = dec.receive(*next_parity);
+                REQUIRE(res.recovered);
+                CHECK(*res.recovered == payloads[N]);
+                CHECK(dec.recovered_count == 2);
+            }
+        }
+    }
+
+    TEST_CASE("014 - Datagram FEC: Parity kernel", "[014][datagrams][fec][xor]")
+    {
+        // Lengths straddling the word-sized fast path and the bytewise tail
+        for (size_t len : {0, 1, 7, 8, 9, 63, 64, 65, 1200})
+        {
+            bstring a, b;
+            a.resize(len);
+            b.resize(len);
+            for (size_t i = 0; i < len; ++i)
+            {
+                a[i] = static_cast<std::byte>(i * 13 % 256);
+                b[i] = static_cast<std::byte>(i * 29 % 256);
+            }
+
+            auto x = a;
+            xor_into(x.data(), b.data(), len);
+            for (size_t i = 0; i < len; ++i)
+                REQUIRE(x[i] == (a[i] ^ b[i]));
+
+            xor_into(x.data(), b.data(), len);
+            REQUIRE(x == a);
+        }
+    }
+
+    TEST_CASE("014 - Datagram FEC: Execute", "[014][datagrams][fec][execute]")
+    {
+        auto client_established = callback_waiter{[](connection_interface&) {}};
+
+        Network test_net{};
+
+        constexpr int K = 4;
+        constexpr int n_msgs = 2 * K + 1;
+
+        std::atomic<int> data_counter{0};
+        std::atomic<bool> bad_data{false};
+
+        std::promise<void> data_promise;
+        std::future<void> data_future = data_promise.get_future();
+
+        auto payloads = make_payloads(n_msgs - 1);
+
+        dgram_data_callback recv_dgram_cb = [&](dgram_interface&, bstring data) {
+            auto i = data_counter++;
+            if (data == "final"_bs)
+                data_promise.set_value();
+            else if (i >= static_cast<int>(payloads.size()) || data != payloads[i])
+                bad_data = true;
+        };
+
+        Address server_local{};
+        Address client_local{};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        SECTION("Without packet splitting")
+        {
+            opt::enable_datagrams default_dgram{};
+            opt::datagram_fec fec{K};
+
+            auto server_endpoint = test_net.endpoint(server_local, default_dgram, fec, recv_dgram_cb);
+            REQUIRE_NOTHROW(server_endpoint->listen(server_tls));
+
+            RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+            auto client = test_net.endpoint(client_local, default_dgram, fec, client_established);
+            auto conn_interface = client->connect(client_remote, client_tls);
+
+            REQUIRE(client_established.wait());
+            REQUIRE(client->datagram_fec_group_size() == K);
+            REQUIRE(conn_interface->datagram_fec_group_size() == K);
+
+            for (auto& p : payloads)
+                conn_interface->send_datagram(bstring{p});
+            conn_interface->send_datagram("final"s);
+
+            require_future(data_future);
+            CHECK(data_counter == n_msgs);
+            CHECK_FALSE(bad_data);
+        }
+
+        SECTION("With packet splitting")
+        {
+            opt::enable_datagrams split_dgram{Splitting::ACTIVE};
+            opt::datagram_fec fec{K};
+
+            auto server_endpoint = test_net.endpoint(server_local, split_dgram, fec, recv_dgram_cb);
+            REQUIRE_NOTHROW(server_endpoint->listen(server_tls));
+
+            RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+            auto client = test_net.endpoint(client_local, split_dgram, fec, client_established);
+            auto conn_interface = client->connect(client_remote, client_tls);
+
+            REQUIRE(client_established.wait());
+            REQUIRE(conn_interface->packet_splitting_enabled());
+
+            std::this_thread::sleep_for(5ms);
+            auto max_size = conn_interface->get_max_datagram_size();
+
+            // Replace the last payload with one that has to be split, so that both layers are used at once
+            payloads.back().resize(max_size);
+
+            for (auto& p : payloads)
+                conn_interface->send_datagram(bstring{p});
+            conn_interface->send_datagram("final"s);
+
+            require_future(data_future);
+            CHECK(data_counter == n_msgs);
+            CHECK_FALSE(bad_data);
+        }
+    }
+}  // namespace oxen::quic::test
@@ -0,0 +1,217 @@
+#include <catch2/catch_test_macros.hpp>
+#include <future>
+#include <limits>
+#include <oxen/quic.hpp>
+#include <oxen/quic/gnutls_crypto.hpp>
+#include <thread>
+
+#include "utils.hpp"
+
+namespace oxen::quic::test
+{
+    using namespace std::literals;
+
+    TEST_CASE("015 - Coroutines: Loop calls", "[015][coroutines][loop]")
+    {
+        Network test_net{};
+
+        std::promise<std::tuple<bool, bool, int, bool>> result_prom;
+        auto result = result_prom.get_future();
+
+        auto coro = [&]() -> detached_task {
+            bool started_off_loop = !test_net.in_event_loop();
+            int value = co_await test_net.call_async([&] { return test_net.in_event_loop() ? 42 : -1; });
+            bool resumed_on_loop = test_net.in_event_loop();
+
+            bool caught = false;
+            try
+            {
+                co_await test_net.call_async([]() -> int { throw std::runtime_error{"oops"}; });
+            }
+            catch (const std::runtime_error&)
+            {
+                caught = true;
+            }
+
+            result_prom.set_value({started_off_loop, resumed_on_loop, value, caught});
+        };
+        coro();
+
+        require_future(result);
+        auto [started_off_loop, resumed_on_loop, value, caught] = result.get();
+        CHECK(started_off_loop);
+        CHECK(resumed_on_loop);
+        CHECK(value == 42);
+        CHECK(caught);
+    }
+
+    TEST_CASE("015 - Coroutines: Pipelined BTRequestStream commands", "[015][coroutines][bparser]")
+    {
+        Network test_net{};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{};
+        Address client_local{};
+
+        auto server_conn_est = [&](connection_interface& c) {
+            auto s = c.queue_incoming_stream<BTRequestStream>();
+            s->register_handler("incr"s, [](message m) { m.respond(std::to_string(std::stoi(m.body_str()) + 1)); });
+        };
+
+        auto server_endpoint = test_net.endpoint(server_local);
+        server_endpoint->listen(server_tls, server_conn_est);
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        auto client_endpoint = test_net.endpoint(client_local);
+        auto conn_interface = client_endpoint->connect(client_remote, client_tls);
+
+        auto client_bp = conn_interface->open_stream<BTRequestStream>();
+
+        constexpr int num_requests = 200;
+
+        std::promise<int> result_prom;
+        auto result = result_prom.get_future();
+
+        // Every request depends on the response to the previous one
+        auto coro = [&]() -> detached_task {
+            int value = 0;
+            for (int i = 0; i < num_requests; i++)
+            {
+                auto m = co_await client_bp->command_async("incr"s, std::to_string(value), 5s);
+                if (!m || !client_endpoint->in_event_loop())
+                    break;
+                value = std::stoi(m.body_str());
+            }
+            result_prom.set_value(value);
+        };
+        coro();
+
+        require_future(result, 10s);
+        CHECK(result.get() == num_requests);
+    }
+
+    TEST_CASE("015 - Coroutines: Stream reading and writing", "[015][coroutines][streams]")
+    {
+        Network test_net{};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{};
+        Address client_local{};
+
+        constexpr size_t total = 2'000'000;
+        constexpr size_t piece = 50'000;
+        constexpr size_t max_buffered = 200'000;
+
+        auto reader = std::make_shared<stream_reader>();
+
+        stream_constructor_callback server_constructor = [&](Connection& c, Endpoint& e, std::optional<int64_t>) {
+            return e.make_shared<Stream>(c, e, reader->data_callback(), reader->close_callback());
+        };
+
+        auto server_endpoint = test_net.endpoint(server_local);
+        server_endpoint->listen(server_tls, server_constructor);
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        auto client_endpoint = test_net.endpoint(client_local);
+        auto conn_interface = client_endpoint->connect(client_remote, client_tls);
+
+        auto client_stream = conn_interface->open_stream();
+
+        std::promise<std::pair<size_t, bool>> read_prom;
+        auto read_result = read_prom.get_future();
+
+        auto read_coro = [&]() -> detached_task {
+            size_t received = 0;
+            bool bad = false;
+            while (received < total)
+            {
+                auto data = co_await reader->read();
+                if (data.empty())
+                    break;
+                for (auto b : data)
+                    if (b != static_cast<std::byte>(received++ % 251))
+                        bad = true;
+            }
+            read_prom.set_value({received, bad});
+        };
+        read_coro();
+
+        std::promise<bool> write_prom;
+        auto write_result = write_prom.get_future();
+
+        auto write_coro = [&]() -> detached_task {
+            bool within_bound = true;
+            for (size_t sent = 0; sent < total; sent += piece)
+            {
+                co_await client_stream->writable(max_buffered);
+                if (client_stream->is_closing())
+                    break;
+                // We're on the event loop, so we can look at the buffer directly
+                if (TestHelper::stream_buffered(*client_stream) > max_buffered)
+                    within_bound = false;
+
+                bstring data;
+                data.resize(piece);
+                for (size_t i = 0; i < piece; i++)
+                    data[i] = static_cast<std::byte>((sent + i) % 251);
+                client_stream->send(std::move(data));
+            }
+            write_prom.set_value(within_bound);
+        };
+        write_coro();
+
+        require_future(write_result, 10s);
+        CHECK(write_result.get());
+
+        require_future(read_result, 10s);
+        auto [received, bad] = read_result.get();
+        CHECK(received == total);
+        CHECK_FALSE(bad);
+    }
+
+    TEST_CASE("015 - Coroutines: Awaiting immediately completed operations", "[015][coroutines][streams]")
+    {
+        Network test_net{};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{};
+        Address client_local{};
+
+        auto server_endpoint = test_net.endpoint(server_local);
+        server_endpoint->listen(server_tls);
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+        auto client_endpoint = test_net.endpoint(client_local);
+        auto conn_interface = client_endpoint->connect(client_remote, client_tls);
+
+        auto client_stream = conn_interface->open_stream();
+
+        // Every `writable()` after the first completes before it suspends; this would overflow the
+        // stack if each of those resumed the coroutine from inside the completion callback.
+        constexpr int iterations = 1'000'000;
+
+        std::promise<int> result_prom;
+        auto result = result_prom.get_future();
+
+        auto coro = [&]() -> detached_task {
+            int i = 0;
+            for (; i < iterations; i++)
+            {
+                co_await client_stream->writable(std::numeric_limits<size_t>::max());
+                if (!client_endpoint->in_event_loop())
+                    break;
+            }
+            result_prom.set_value(i);
+        };
+        coro();
+
+        require_future(result, 10s);
+        CHECK(result.get() == iterations);
+    }
+}  // namespace oxen::quic::test
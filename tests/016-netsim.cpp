@@ -0,0 +1,161 @@
+#include <catch2/catch_test_macros.hpp>
+#include <future>
+#include <oxen/quic.hpp>
+#include <oxen/quic/gnutls_crypto.hpp>
+
+#include "netsim.hpp"
+#include "utils.hpp"
+
+namespace oxen::quic::test
+{
+    using namespace std::literals;
+
+    namespace
+    {
+        bstring make_payload(size_t size)
+        {
+            bstring data;
+            data.resize(size);
+            for (size_t i = 0; i < size; i++)
+                data[i] = static_cast<std::byte>(i % 251);
+            return data;
+        }
+    }  // namespace
+
+    TEST_CASE("016 - Network simulator: Lossy link", "[016][netsim]")
+    {
+        Network test_net{};
+        NetworkSimulator sim{test_net, 42};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{"10.0.0.1", 4433};
+        Address client_local{"10.0.0.2", 5544};
+
+        link_config link;
+        link.latency = 5ms;
+        link.jitter = 2ms;
+        link.loss = 0.05;
+        link.reorder = 0.02;
+        sim.set_links(server_local, client_local, link);
+
+        constexpr size_t total = 200'000;
+        auto msg = make_payload(total);
+
+        std::promise<bool> d_promise;
+        auto d_future = d_promise.get_future();
+        bstring received;
+
+        stream_data_callback server_data_cb = [&](Stream&, bstring_view dat) {
+            received += dat;
+            if (received.size() == total)
+                d_promise.set_value(received == msg);
+        };
+
+        auto server_endpoint = sim.endpoint(server_local);
+        REQUIRE_NOTHROW(server_endpoint->listen(server_tls, server_data_cb));
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, server_local};
+
+        auto client_endpoint = sim.endpoint(client_local);
+        auto conn_interface = client_endpoint->connect(client_remote, client_tls);
+
+        auto client_stream = conn_interface->open_stream();
+        REQUIRE_NOTHROW(client_stream->send(bstring{msg}));
+
+        require_future(d_future, 20s);
+        CHECK(d_future.get());
+
+        auto up = sim.get_stats(client_local, server_local);
+        auto down = sim.get_stats(server_local, client_local);
+        CHECK(up.delivered > 0);
+        CHECK(up.lost + down.lost > 0);
+        CHECK(up.bytes_delivered > total);
+        CHECK(up.too_big == 0);
+    }
+
+    TEST_CASE("016 - Network simulator: Bandwidth limit", "[016][netsim]")
+    {
+        Network test_net{};
+        NetworkSimulator sim{test_net};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{"10.0.0.1", 4433};
+        Address client_local{"10.0.0.2", 5544};
+
+        // 100kB at 250kB/s should take at least 400ms
+        link_config link;
+        link.bandwidth = 250'000;
+        link.latency = 1ms;
+        sim.set_default_link(link);
+
+        constexpr size_t total = 100'000;
+
+        std::promise<void> d_promise;
+        auto d_future = d_promise.get_future();
+        size_t received = 0;
+
+        stream_data_callback server_data_cb = [&](Stream&, bstring_view dat) {
+            received += dat.size();
+            if (received == total)
+                d_promise.set_value();
+        };
+
+        auto server_endpoint = sim.endpoint(server_local);
+        REQUIRE_NOTHROW(server_endpoint->listen(server_tls, server_data_cb));
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, server_local};
+
+        auto client_endpoint = sim.endpoint(client_local);
+        auto conn_interface = client_endpoint->connect(client_remote, client_tls);
+
+        auto client_stream = conn_interface->open_stream();
+
+        auto started = std::chrono::steady_clock::now();
+        REQUIRE_NOTHROW(client_stream->send(make_payload(total)));
+
+        require_future(d_future, 10s);
+        CHECK(std::chrono::steady_clock::now() - started >= 400ms);
+    }
+
+    TEST_CASE("016 - Network simulator: MTU below the QUIC minimum", "[016][netsim]")
+    {
+        Network test_net{};
+        NetworkSimulator sim{test_net};
+
+        auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+        Address server_local{"10.0.0.1", 4433};
+        Address client_local{"10.0.0.2", 5544};
+
+        // QUIC requires paths to carry 1200-byte datagrams, and pads client Initials to that size
+        link_config link;
+        link.mtu = 1000;
+        sim.set_default_link(link);
+
+        auto server_endpoint = sim.endpoint(server_local);
+        REQUIRE_NOTHROW(server_endpoint->listen(server_tls));
+
+        RemoteAddress client_remote{defaults::SERVER_PUBKEY, server_local};
+
+        std::promise<bool> closed_promise;
+        auto closed_future = closed_promise.get_future();
+
+        auto client_established = callback_waiter{[](connection_interface&) {}};
+        connection_closed_callback client_closed = [&](connection_interface&, uint64_t) {
+            closed_promise.set_value(true);
+        };
+
+        auto client_endpoint = sim.endpoint(client_local);
+        client_endpoint->connect(
+                client_remote, client_tls, client_established, client_closed, opt::handshake_timeout{500ms});
+
+        require_future(closed_future, 5s);
+        CHECK_FALSE(client_established.is_ready());
+
+        auto up = sim.get_stats(client_local, server_local);
+        CHECK(up.too_big > 0);
+        CHECK(up.delivered == 0);
+    }
+}  // namespace oxen::quic::test
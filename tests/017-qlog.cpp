@@ -0,0 +1,148 @@
+#include <catch2/catch_test_macros.hpp>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <oxen/quic.hpp>
+#include <oxen/quic/gnutls_crypto.hpp>
+#include <random>
+
+#include "utils.hpp"
+
+namespace oxen::quic::test
+{
+    using namespace std::literals;
+
+    TEST_CASE("017 - qlog: Writer", "[017][qlog][writer]")
+    {
+        auto dir = std::filesystem::temp_directory_path() / "libquic-test-qlog-writer-{}"_format(
+                                                                     std::random_device{}());
+
+        {
+            // Smaller than the data we write, so the writer thread has to keep up
+            QlogWriter writer{dir, 4096};
+            auto a = writer.open("a.sqlog");
+            auto b = writer.open("b.sqlog");
+
+            for (int i = 0; i < 100; i++)
+            {
+                auto rec = "\x1e{{\"n\":{}}}\n"_format(i);
+                writer.write(i % 2 ? b : a, rec.data(), rec.size());
+                std::this_thread::sleep_for(1ms);
+            }
+            writer.write(a, "", 0, true);
+            CHECK(writer.dropped() == 0);
+        }
+
+        auto read = [&](const char* name) {
+            std::ifstream f{dir / name, std::ios::binary};
+            return std::string{std::istreambuf_iterator<char>{f}, {}};
+        };
+        auto a = read("a.sqlog"), b = read("b.sqlog");
+        CHECK(a.starts_with("\x1e{\"n\":0}\n"));
+        CHECK(a.ends_with("\x1e{\"n\":98}\n"));
+        CHECK(b.starts_with("\x1e{\"n\":1}\n"));
+        CHECK(b.ends_with("\x1e{\"n\":99}\n"));
+
+        std::filesystem::remove_all(dir);
+    }
+
+    TEST_CASE("017 - qlog: Ring overflow", "[017][qlog][writer][overflow]")
+    {
+        auto dir = std::filesystem::temp_directory_path() / "libquic-test-qlog-overflow-{}"_format(
+                                                                     std::random_device{}());
+
+#ifdef __linux__
+        auto open_fds = [] {
+            return std::distance(
+                    std::filesystem::directory_iterator{"/proc/self/fd"}, std::filesystem::directory_iterator{});
+        };
+        auto fds_before = open_fds();
+#endif
+
+        std::thread handed_off;
+        {
+            QlogWriter writer{dir, 4096, [&](std::thread& t) {
+                                  handed_off = std::move(t);
+                                  return true;
+                              }};
+
+            // Each file's records overflow the ring, so that most of their FIN records are dropped
+            std::string rec(3000, 'x');
+            for (int i = 0; i < 20; i++)
+            {
+                auto id = writer.open("{}.sqlog"_format(i));
+                writer.write(id, rec.data(), rec.size());
+                writer.write(id, rec.data(), rec.size(), true);
+            }
+            CHECK(writer.dropped() > 0);
+
+            // Give the writer thread time to catch up; the files must all be closed by then
+            std::this_thread::sleep_for(250ms);
+#ifdef __linux__
+            CHECK(open_fds() == fds_before);
+#endif
+        }
+
+        // The destructor handed the writer thread off rather than waiting for it
+        REQUIRE(handed_off.joinable());
+        handed_off.join();
+
+        std::filesystem::remove_all(dir);
+    }
+
+    TEST_CASE("017 - qlog: Connection traces", "[017][qlog][endpoint]")
+    {
+        auto client_established = callback_waiter{[](connection_interface&) {}};
+
+        auto dir = std::filesystem::temp_directory_path() / "libquic-test-qlog-{}"_format(std::random_device{}());
+
+        {
+            Network test_net{};
+
+            auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+            Address server_local{};
+            Address client_local{};
+
+            std::promise<void> d_promise;
+            auto d_future = d_promise.get_future();
+
+            stream_data_callback server_data_cb = [&](Stream&, bstring_view) { d_promise.set_value(); };
+
+            auto server_endpoint = test_net.endpoint(server_local, opt::qlog{dir});
+            REQUIRE_NOTHROW(server_endpoint->listen(server_tls, server_data_cb));
+
+            RemoteAddress client_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server_endpoint->local().port()};
+
+            auto client_endpoint = test_net.endpoint(client_local, client_established, opt::qlog{dir});
+            auto conn_interface = client_endpoint->connect(client_remote, client_tls);
+
+            CHECK(client_established.wait());
+
+            auto client_stream = conn_interface->open_stream();
+            client_stream->send("hello"s);
+
+            require_future(d_future);
+        }
+
+        // The endpoints, and with them the qlog writers, are gone, so the traces are complete
+        std::vector<std::string> traces;
+        for (const auto& entry : std::filesystem::directory_iterator{dir})
+        {
+            std::ifstream f{entry.path(), std::ios::binary};
+            traces.emplace_back(std::istreambuf_iterator<char>{f}, std::istreambuf_iterator<char>{});
+            CHECK(entry.path().extension() == ".sqlog");
+        }
+
+        REQUIRE(traces.size() == 2);
+        for (const auto& t : traces)
+        {
+            // JSON-SEQ: every record starts with an RS character
+            CHECK(t.starts_with('\x1e'));
+            CHECK(t.find("\"qlog_format\":\"JSON-SEQ\"") != std::string::npos);
+            CHECK(t.find("packet_sent") != std::string::npos);
+        }
+
+        std::filesystem::remove_all(dir);
+    }
+}  // namespace oxen::quic::test
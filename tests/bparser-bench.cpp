@@ -0,0 +1,138 @@
+/*
+    BTRequestStream parser microbenchmark
+
+    Feeds pre-encoded requests straight into a BTRequestStream's incoming request parser (bypassing
+    the network) in receive chunks of a configurable size, and reports the parsing throughput for
+    small and large requests.
+*/
+
+#include <CLI/Validators.hpp>
+#include <chrono>
+#include <oxen/quic.hpp>
+#include <oxen/quic/gnutls_crypto.hpp>
+
+#include "utils.hpp"
+
+using namespace oxen::quic;
+
+int main(int argc, char* argv[])
+{
+    CLI::App cli{"libQUIC BTRequestStream parser microbenchmark"};
+
+    std::string log_file, log_level;
+    add_log_opts(cli, log_file, log_level);
+
+    size_t small_size = 64;
+    cli.add_option("--small-size", small_size, "Body size of the small requests")
+            ->check(CLI::Range(size_t{1}, size_t{9'000'000}))
+            ->capture_default_str();
+
+    size_t large_size = 1'000'000;
+    cli.add_option("--large-size", large_size, "Body size of the large requests")
+            ->check(CLI::Range(size_t{1}, size_t{9'000'000}))
+            ->capture_default_str();
+
+    size_t chunk_size = 1200;
+    cli.add_option(
+               "-c,--chunk-size",
+               chunk_size,
+               "Size of the receive chunks the encoded requests are fed in; 0 feeds everything at once")
+            ->capture_default_str();
+
+    size_t total = 200'000'000;
+    cli.add_option("-S,--size", total, "Approximate amount of request data to parse for each request size")
+            ->capture_default_str();
+
+    try
+    {
+        cli.parse(argc, argv);
+    }
+    catch (const CLI::ParseError& e)
+    {
+        return cli.exit(e);
+    }
+
+    setup_logging(log_file, log_level);
+
+    Network net{};
+
+    auto [client_seed, client_pubkey] = generate_ed25519();
+    auto [server_seed, server_pubkey] = generate_ed25519();
+    auto client_tls = GNUTLSCreds::make_from_ed_keys(client_seed, client_pubkey);
+    auto server_tls = GNUTLSCreds::make_from_ed_keys(server_seed, server_pubkey);
+
+    Address server_local{}, client_local{};
+
+    auto client_established = callback_waiter{[](connection_interface&) {}};
+
+    auto server = net.endpoint(server_local);
+    server->listen(server_tls);
+
+    RemoteAddress server_remote{server_pubkey, "127.0.0.1"s, server->local().port()};
+
+    auto client = net.endpoint(client_local, client_established);
+    auto conn = client->connect(server_remote, client_tls);
+
+    if (!client_established.wait())
+    {
+        log::critical(test_cat, "Failed to establish connection");
+        return 1;
+    }
+
+    auto bp = conn->open_stream<BTRequestStream>();
+
+    // Only touched from inside the event loop
+    uint64_t handled = 0, body_bytes = 0;
+    bp->register_handler("bench", [&](message m) {
+        ++handled;
+        body_bytes += m.body().size();
+    });
+
+    auto run = [&](std::string_view name, size_t body_size) {
+        std::string body(body_size, 'z');
+        std::string encoded;
+        size_t n = std::max<size_t>(1, total / body_size);
+        for (size_t i = 0; i < n; ++i)
+        {
+            std::string list = "l1:Ci{}e5:bench{}:{}e"_format(i, body.size(), body);
+            encoded += "{}:{}"_format(list.size(), list);
+        }
+
+        handled = 0;
+        body_bytes = 0;
+        bstring_view data = convert_sv<std::byte>(std::string_view{encoded});
+
+        auto started_at = std::chrono::steady_clock::now();
+
+        client->call_get([&] {
+            // Feed everything from within a single event loop job so that we are timing the parser,
+            // not the job queue.
+            auto remaining = data;
+            while (!remaining.empty())
+            {
+                auto chunk = remaining.substr(0, chunk_size ? chunk_size : remaining.size());
+                remaining.remove_prefix(chunk.size());
+                TestHelper::bparser_receive(*bp, chunk);
+            }
+        });
+
+        auto elapsed = std::chrono::duration<double>{std::chrono::steady_clock::now() - started_at}.count();
+
+        if (handled != n)
+            log::critical(test_cat, "Parsed {} requests, expected {}!", handled, n);
+
+        fmt::print(
+                "{:>6} requests ({}B bodies): {} requests in {:.3f}s; {:.0f} req/s, {:.1f}MB/s\n",
+                name,
+                body_size,
+                handled,
+                elapsed,
+                handled / elapsed,
+                encoded.size() / 1'000'000.0 / elapsed);
+    };
+
+    run("small", small_size);
+    run("large", large_size);
+
+    return 0;
+}
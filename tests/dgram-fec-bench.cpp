@@ -0,0 +1,186 @@
+/*
+    Datagram FEC loss-simulation benchmark
+
+    Connects two manually-routed endpoints inside a single process, drops a configurable fraction
+    of the client->server packets once the handshake has completed, and reports how many of the
+    sent datagrams actually made it to the receiver with and without datagram FEC enabled.
+*/
+
+#include <oxenc/endian.h>
+
+#include <CLI/Validators.hpp>
+#include <chrono>
+#include <future>
+#include <oxen/quic.hpp>
+#include <oxen/quic/gnutls_crypto.hpp>
+#include <random>
+#include <thread>
+
+#include "utils.hpp"
+
+using namespace oxen::quic;
+
+struct bench_result
+{
+    uint64_t sent{0};
+    uint64_t received{0};
+    uint64_t packets{0};
+    uint64_t packets_dropped{0};
+    double elapsed{0};
+};
+
+int main(int argc, char* argv[])
+{
+    CLI::App cli{"libQUIC datagram FEC loss-simulation benchmark"};
+
+    std::string log_file, log_level;
+    add_log_opts(cli, log_file, log_level);
+
+    double loss = 0.05;
+    cli.add_option("--loss", loss, "Fraction of client->server packets to drop")
+            ->check(CLI::Range(0.0, 1.0))
+            ->capture_default_str();
+
+    int group_size = 8;
+    cli.add_option("-k,--group-size", group_size, "Number of datagrams protected by each FEC parity datagram")
+            ->check(CLI::Range(1, opt::datagram_fec::MAX_GROUP_SIZE))
+            ->capture_default_str();
+
+    uint64_t count = 20'000;
+    cli.add_option("-n,--count", count, "Number of datagrams to send per run")
+            ->check(CLI::PositiveNumber)
+            ->capture_default_str();
+
+    size_t dgram_size = 1000;
+    cli.add_option("--dgram-size", dgram_size, "Size of each datagram")->check(CLI::Range(8, 1100))->capture_default_str();
+
+    uint64_t seed = 42;
+    cli.add_option("--seed", seed, "Seed for the packet loss generator")->capture_default_str();
+
+    try
+    {
+        cli.parse(argc, argv);
+    }
+    catch (const CLI::ParseError& e)
+    {
+        return cli.exit(e);
+    }
+
+    setup_logging(log_file, log_level);
+
+    auto run = [&](int k) {
+        bench_result result{};
+
+        Network net{};
+
+        auto [client_seed, client_pubkey] = generate_ed25519();
+        auto [server_seed, server_pubkey] = generate_ed25519();
+        auto client_tls = GNUTLSCreds::make_from_ed_keys(client_seed, client_pubkey);
+        auto server_tls = GNUTLSCreds::make_from_ed_keys(server_seed, server_pubkey);
+
+        std::shared_ptr<Endpoint> client, server;
+        Address client_local{}, server_local{};
+
+        // Only touched from within the event loop
+        std::mt19937_64 rng{seed};
+        std::bernoulli_distribution drop{loss};
+        std::vector<bool> seen(count, false);
+
+        std::atomic<bool> lossy{false};
+        std::atomic<uint64_t> received{0}, packets{0}, packets_dropped{0};
+
+        opt::manual_routing client_sender{[&](const Path& p, bstring_view d) {
+            if (lossy)
+            {
+                ++packets;
+                if (drop(rng))
+                {
+                    ++packets_dropped;
+                    return;
+                }
+            }
+            server->manually_receive_packet(Packet{p.invert(), bstring{d}});
+        }};
+
+        opt::manual_routing server_sender{
+                [&](const Path& p, bstring_view d) { client->manually_receive_packet(Packet{p.invert(), bstring{d}}); }};
+
+        dgram_data_callback recv_dgram_cb = [&](dgram_interface&, bstring data) {
+            if (data.size() < sizeof(uint64_t))
+                return;
+            auto i = oxenc::load_little_to_host<uint64_t>(data.data());
+            if (i < count && !seen[i])
+            {
+                seen[i] = true;
+                ++received;
+            }
+        };
+
+        auto client_established = callback_waiter{[](connection_interface&) {}};
+
+        opt::enable_datagrams dgrams{};
+        std::optional<opt::datagram_fec> fec;
+        if (k > 0)
+            fec.emplace(k);
+
+        server = net.endpoint(server_local, server_sender, dgrams, fec, recv_dgram_cb);
+        server->listen(server_tls);
+
+        client = net.endpoint(client_local, client_sender, dgrams, fec, client_established);
+        auto client_ci = client->connect(RemoteAddress{server_pubkey, server_local}, client_tls);
+
+        if (!client_established.wait())
+            throw std::runtime_error{"Connection failed to establish"};
+
+        lossy = true;
+        auto started_at = std::chrono::steady_clock::now();
+
+        for (uint64_t i = 0; i < count; ++i)
+        {
+            bstring msg;
+            msg.resize(dgram_size);
+            oxenc::write_host_as_little(i, msg.data());
+            client_ci->send_datagram(std::move(msg));
+        }
+
+        // We can't rely on any end-of-data marker arriving, so wait for reception to go quiet
+        uint64_t last = 0;
+        do
+        {
+            last = received;
+            std::this_thread::sleep_for(500ms);
+        } while (received != last || (last == 0 && packets == 0));
+
+        result.elapsed = std::chrono::duration<double>{std::chrono::steady_clock::now() - started_at}.count();
+        result.sent = count;
+        result.received = received;
+        result.packets = packets;
+        result.packets_dropped = packets_dropped;
+
+        client->close_conns();
+        return result;
+    };
+
+    auto report = [](std::string_view name, const bench_result& r) {
+        fmt::print(
+                "{:>8}: received {}/{} datagrams; effective loss {:.3f}% (dropped {}/{} packets = {:.3f}%), {:.3f}s\n",
+                name,
+                r.received,
+                r.sent,
+                100.0 * (r.sent - r.received) / r.sent,
+                r.packets_dropped,
+                r.packets,
+                r.packets ? 100.0 * r.packets_dropped / r.packets : 0.0,
+                r.elapsed);
+    };
+
+    fmt::print("Simulating {:.2f}% packet loss for {} datagrams of {}B\n", 100 * loss, count, dgram_size);
+
+    auto plain = run(0);
+    report("no FEC", plain);
+
+    auto with_fec = run(group_size);
+    report("FEC k={}"_format(group_size), with_fec);
+
+    return 0;
+}
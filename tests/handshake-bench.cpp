@@ -0,0 +1,283 @@
+/*
+    Handshake rate and connection churn benchmark
+
+    Opens many short-lived connections from one or more client endpoints (each on its own Network,
+    and thus its own event loop thread) to a single server endpoint, keeping a configurable number
+    of handshakes in flight per client, and closing each connection as soon as it is established.
+    Reports the handshake rate, the handshake latency distribution, the peak memory used per open
+    connection, and the CPU time used by the server's event loop thread.  With --fresh-ticket-key
+    the server generates a new session ticket key for every accepted connection, approximating the
+    per-accept cost of not sharing the ticket key.
+
+    Clients resume the TLS session (without 0-RTT) of their earlier connections to the server
+    whenever they can, so most handshakes after the first few are resumed ones; the latencies of
+    full and resumed handshakes are reported separately.  --no-resumption disables resumption on
+    both sides, so that every handshake is a full one.
+*/
+
+#include <CLI/Validators.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <oxen/quic.hpp>
+#include <oxen/quic/gnutls_crypto.hpp>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+#include "utils.hpp"
+
+using namespace oxen::quic;
+
+namespace
+{
+    // Peak resident set size of the process, in bytes (0 if unavailable)
+    size_t peak_rss()
+    {
+#ifndef _WIN32
+        rusage ru{};
+        if (getrusage(RUSAGE_SELF, &ru) == 0)
+#ifdef __APPLE__
+            return ru.ru_maxrss;
+#else
+            return ru.ru_maxrss * 1024;
+#endif
+#endif
+        return 0;
+    }
+
+    // CPU time used by the calling thread (0 if unavailable)
+    std::chrono::nanoseconds thread_cpu_time()
+    {
+#ifndef _WIN32
+        timespec ts{};
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+            return std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+#endif
+        return 0ns;
+    }
+
+    struct churn_client
+    {
+        // Guards `in_flight`, which counts this client's handshakes still in progress
+        std::mutex m;
+        std::condition_variable cv;
+        size_t in_flight = 0;
+
+        Network net;
+        std::shared_ptr<Endpoint> ep;
+        std::thread runner;
+    };
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    CLI::App cli{"libQUIC handshake rate and connection churn benchmark"};
+
+    std::string log_file, log_level;
+    add_log_opts(cli, log_file, log_level);
+
+    size_t total = 2000;
+    cli.add_option("-n,--connections", total, "Number of connections to establish (across all client threads)")
+            ->check(CLI::Range(size_t{1}, size_t{10'000'000}))
+            ->capture_default_str();
+
+    size_t concurrency = 16;
+    cli.add_option("-c,--concurrency", concurrency, "Maximum number of handshakes in flight at once, per client thread")
+            ->check(CLI::Range(size_t{1}, size_t{10'000}))
+            ->capture_default_str();
+
+    size_t threads = 1;
+    cli.add_option("-t,--threads", threads, "Number of client threads, each with its own endpoint")
+            ->check(CLI::Range(size_t{1}, size_t{256}))
+            ->capture_default_str();
+
+    bool fresh_ticket_key = false;
+    cli.add_flag(
+            "--fresh-ticket-key",
+            fresh_ticket_key,
+            "Generate a new server session ticket key for every accepted connection");
+
+    bool no_resumption = false;
+    cli.add_flag("--no-resumption", no_resumption, "Disable TLS session resumption, making every handshake a full one");
+
+    try
+    {
+        cli.parse(argc, argv);
+    }
+    catch (const CLI::ParseError& e)
+    {
+        return cli.exit(e);
+    }
+
+    setup_logging(log_file, log_level);
+
+    Network server_net{};
+
+    auto [client_seed, client_pubkey] = generate_ed25519();
+    auto [server_seed, server_pubkey] = generate_ed25519();
+    auto client_tls = GNUTLSCreds::make_from_ed_keys(client_seed, client_pubkey);
+    auto server_tls = GNUTLSCreds::make_from_ed_keys(server_seed, server_pubkey);
+
+    if (no_resumption)
+    {
+        client_tls->set_session_resumption(false);
+        server_tls->set_session_resumption(false);
+    }
+
+    Address server_local{};
+
+    connection_established_callback server_established = [&](connection_interface&) {
+        if (fresh_ticket_key)
+            server_tls->rotate_ticket_key();
+    };
+
+    auto server = server_net.endpoint(server_local, server_established);
+    server->listen(server_tls);
+
+    RemoteAddress server_remote{server_pubkey, "127.0.0.1"s, server->local().port()};
+
+    std::mutex m;
+    size_t established = 0, alive = 0, peak_alive = 0;
+    // Latencies of full and of resumed handshakes
+    std::vector<std::chrono::nanoseconds> latencies, resumed_latencies;
+    latencies.reserve(total);
+    resumed_latencies.reserve(total);
+    bool failed = false;
+
+    connection_closed_callback client_closed = [&](connection_interface&, uint64_t) {
+        std::lock_guard lock{m};
+        --alive;
+    };
+
+    std::vector<std::unique_ptr<churn_client>> clients;
+    for (size_t i = 0; i < threads; ++i)
+    {
+        auto& c = clients.emplace_back(std::make_unique<churn_client>());
+        Address client_local{};
+        c->ep = c->net.endpoint(client_local, client_closed);
+    }
+
+    auto rss_before = peak_rss();
+    auto server_cpu_before = server_net.call_get([] { return thread_cpu_time(); });
+    auto started_at = std::chrono::steady_clock::now();
+
+    for (size_t t = 0; t < threads; ++t)
+    {
+        size_t count = total / threads + (t < total % threads);
+
+        clients[t]->runner = std::thread{[&, &client = *clients[t], count] {
+            for (size_t i = 0; i < count; ++i)
+            {
+                {
+                    std::unique_lock lock{client.m};
+                    if (!client.cv.wait_for(lock, 10s, [&] { return client.in_flight < concurrency; }))
+                    {
+                        log::critical(test_cat, "Timed out waiting for handshakes");
+                        std::lock_guard glock{m};
+                        failed = true;
+                        break;
+                    }
+                    ++client.in_flight;
+                }
+
+                connection_established_callback on_established =
+                        [&, start = std::chrono::steady_clock::now()](connection_interface& ci) {
+                            auto latency = std::chrono::steady_clock::now() - start;
+                            {
+                                std::lock_guard lock{m};
+                                ++established;
+                                (ci.is_resumed() ? resumed_latencies : latencies).push_back(latency);
+                            }
+                            {
+                                std::lock_guard lock{client.m};
+                                --client.in_flight;
+                            }
+                            client.cv.notify_one();
+
+                            // Don't close the connection from inside its own callback
+                            client.net.call_soon([wc = ci.weak_from_this()] {
+                                if (auto conn = wc.lock())
+                                    conn->close_connection();
+                            });
+                        };
+
+                {
+                    std::lock_guard lock{m};
+                    peak_alive = std::max(peak_alive, ++alive);
+                }
+                client.ep->connect(server_remote, client_tls, std::move(on_established));
+            }
+
+            std::unique_lock lock{client.m};
+            if (!client.cv.wait_for(lock, 10s, [&] { return client.in_flight == 0; }))
+            {
+                log::critical(test_cat, "Timed out waiting for handshakes");
+                std::lock_guard glock{m};
+                failed = true;
+            }
+        }};
+    }
+
+    for (auto& c : clients)
+        c->runner.join();
+
+    auto elapsed = std::chrono::duration<double>{std::chrono::steady_clock::now() - started_at}.count();
+    auto server_cpu = server_net.call_get([] { return thread_cpu_time(); }) - server_cpu_before;
+    auto rss_after = peak_rss();
+
+    // The client loops might still be closing connections
+    std::unique_lock lock{m};
+    auto full_results = std::exchange(latencies, {});
+    auto resumed_results = std::exchange(resumed_latencies, {});
+    auto final_peak_alive = peak_alive;
+    auto final_established = established;
+    bool final_failed = failed;
+    lock.unlock();
+
+    if (final_failed)
+    {
+        log::critical(test_cat, "Benchmark failed ({} of {} handshakes established)", final_established, total);
+        return 1;
+    }
+
+    auto us = [](std::chrono::nanoseconds ns) { return ns.count() / 1000.0; };
+
+    fmt::print(
+            "{} handshakes ({} client thread(s), {} in flight each{}{}) in {:.3f}s; {:.1f} handshakes/s\n",
+            final_established,
+            threads,
+            concurrency,
+            fresh_ticket_key ? ", fresh ticket key per accept" : "",
+            no_resumption ? ", no resumption" : "",
+            elapsed,
+            final_established / elapsed);
+    for (auto* results : {&full_results, &resumed_results})
+    {
+        if (results->empty())
+            continue;
+        std::sort(results->begin(), results->end());
+        fmt::print(
+                "{} handshake latency ({} handshakes): p50 {:.1f}µs, p99 {:.1f}µs, max {:.1f}µs\n",
+                results == &full_results ? "Full" : "Resumed",
+                results->size(),
+                us((*results)[results->size() / 2]),
+                us((*results)[results->size() * 99 / 100]),
+                us(results->back()));
+    }
+    fmt::print(
+            "Peak RSS growth: {:.1f}kiB per open connection (client and server side; peak {} open)\n",
+            final_peak_alive ? (rss_after - rss_before) / 1024.0 / final_peak_alive : 0.0,
+            final_peak_alive);
+    fmt::print(
+            "Server loop CPU: {:.3f}s ({:.1f}% of one core); {:.1f}µs per handshake\n",
+            server_cpu.count() / 1e9,
+            server_cpu.count() / 1e9 / elapsed * 100,
+            us(server_cpu) / final_established);
+
+    return 0;
+}
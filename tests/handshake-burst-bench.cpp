@@ -0,0 +1,227 @@
+/*
+    Handshake burst latency benchmark
+
+    Measures the request latency of an already-established connection while the same server
+    endpoint is hit by a burst of new connections.  The server's key verify callback spins for a
+    configurable time to simulate an expensive verifier; with --verify-threads it runs on a worker
+    pool (see GNUTLSCreds::set_key_verify_pool) rather than on the server's event loop.  The
+    request latency is reported both without and during the burst.
+*/
+
+#include <CLI/Validators.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <oxen/quic.hpp>
+#include <oxen/quic/gnutls_crypto.hpp>
+#include <thread>
+
+#include "utils.hpp"
+
+using namespace oxen::quic;
+
+namespace
+{
+    struct pinger
+    {
+        std::shared_ptr<BTRequestStream> stream;
+        std::vector<std::chrono::nanoseconds> latencies;
+        bool running = false;
+
+        // Called in the event loop; sends the next ping once the previous one returns
+        void ping()
+        {
+            if (!running)
+                return;
+            auto sent = std::chrono::steady_clock::now();
+            stream->command("ping"s, ""s, [this, sent](message m) {
+                if (!m)
+                {
+                    log::warning(test_cat, "Ping failed{}", m.timed_out ? " (timed out)" : "");
+                    running = false;
+                    return;
+                }
+                latencies.push_back(std::chrono::steady_clock::now() - sent);
+                ping();
+            });
+        }
+    };
+
+    void print_latencies(std::string_view label, std::vector<std::chrono::nanoseconds> l)
+    {
+        if (l.empty())
+        {
+            fmt::print("{}: no pings completed\n", label);
+            return;
+        }
+        std::sort(l.begin(), l.end());
+        auto us = [](std::chrono::nanoseconds ns) { return ns.count() / 1000.0; };
+        fmt::print(
+                "{}: {} pings; p50 {:.1f}µs, p99 {:.1f}µs, max {:.1f}µs\n",
+                label,
+                l.size(),
+                us(l[l.size() / 2]),
+                us(l[l.size() * 99 / 100]),
+                us(l.back()));
+    }
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    CLI::App cli{"libQUIC handshake burst latency benchmark"};
+
+    std::string log_file, log_level;
+    add_log_opts(cli, log_file, log_level);
+
+    size_t total = 500;
+    cli.add_option("-n,--connections", total, "Number of connections in the burst")
+            ->check(CLI::Range(size_t{1}, size_t{10'000'000}))
+            ->capture_default_str();
+
+    size_t concurrency = 32;
+    cli.add_option("-c,--concurrency", concurrency, "Maximum number of burst handshakes in flight at once")
+            ->check(CLI::Range(size_t{1}, size_t{10'000}))
+            ->capture_default_str();
+
+    int64_t verify_us = 2000;
+    cli.add_option("--verify-us", verify_us, "CPU time spent by the server key verify callback, in microseconds")
+            ->check(CLI::Range(int64_t{0}, int64_t{1'000'000}))
+            ->capture_default_str();
+
+    size_t verify_threads = 0;
+    cli.add_option(
+               "--verify-threads",
+               verify_threads,
+               "Run the key verify callback on a worker pool of this many threads (0 = on the event loop)")
+            ->check(CLI::Range(size_t{0}, size_t{256}))
+            ->capture_default_str();
+
+    int baseline_ms = 1000;
+    cli.add_option("--baseline-ms", baseline_ms, "How long to measure latency before starting the burst")
+            ->check(CLI::Range(0, 60'000))
+            ->capture_default_str();
+
+    try
+    {
+        cli.parse(argc, argv);
+    }
+    catch (const CLI::ParseError& e)
+    {
+        return cli.exit(e);
+    }
+
+    setup_logging(log_file, log_level);
+
+    // Outlives the networks, as a ping response callback may still be pending during shutdown
+    pinger p;
+
+    // Separate loops for the server, the pinging client, and the burst clients, so that only the
+    // server loop is shared between the pings and the burst.
+    Network server_net{}, ping_net{}, burst_net{};
+
+    auto [client_seed, client_pubkey] = generate_ed25519();
+    auto [server_seed, server_pubkey] = generate_ed25519();
+    auto client_tls = GNUTLSCreds::make_from_ed_keys(client_seed, client_pubkey);
+    auto server_tls = GNUTLSCreds::make_from_ed_keys(server_seed, server_pubkey);
+
+    server_tls->set_key_verify_callback([verify_us](const ustring_view&, const ustring_view&) {
+        auto until = std::chrono::steady_clock::now() + std::chrono::microseconds{verify_us};
+        while (std::chrono::steady_clock::now() < until)
+            ;
+        return true;
+    });
+    if (verify_threads > 0)
+        server_tls->set_key_verify_pool(std::make_shared<WorkerPool>(verify_threads));
+
+    Address server_local{}, client_local{};
+
+    auto server_est = [](connection_interface& c) {
+        auto s = c.queue_incoming_stream<BTRequestStream>();
+        s->register_handler("ping"s, [](message m) { m.respond(""s); });
+    };
+
+    auto server = server_net.endpoint(server_local);
+    server->listen(server_tls, server_est);
+
+    RemoteAddress server_remote{server_pubkey, "127.0.0.1"s, server->local().port()};
+
+    // The established connection that we measure
+    auto ping_ep = ping_net.endpoint(client_local);
+    auto ping_conn = ping_ep->connect(server_remote, client_tls);
+    p.stream = ping_conn->open_stream<BTRequestStream>();
+
+    ping_net.call([&] {
+        p.running = true;
+        p.ping();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds{baseline_ms});
+    auto baseline = ping_net.call_get([&] { return std::exchange(p.latencies, {}); });
+
+    std::mutex m;
+    std::condition_variable cv;
+    size_t in_flight = 0, established = 0;
+
+    connection_established_callback burst_established = [&](connection_interface& c) {
+        {
+            std::lock_guard lock{m};
+            --in_flight;
+            ++established;
+        }
+        cv.notify_one();
+
+        // Don't close the connection from inside its own callback
+        burst_net.call_soon([wc = c.weak_from_this()] {
+            if (auto conn = wc.lock())
+                conn->close_connection();
+        });
+    };
+
+    auto burst_ep = burst_net.endpoint(client_local, burst_established);
+
+    auto started_at = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < total; ++i)
+    {
+        {
+            std::unique_lock lock{m};
+            if (!cv.wait_for(lock, 10s, [&] { return in_flight < concurrency; }))
+            {
+                log::critical(test_cat, "Timed out waiting for handshakes ({} established)", established);
+                return 1;
+            }
+            ++in_flight;
+        }
+        burst_ep->connect(server_remote, client_tls);
+    }
+
+    {
+        std::unique_lock lock{m};
+        if (!cv.wait_for(lock, 10s, [&] { return in_flight == 0; }))
+        {
+            log::critical(test_cat, "Timed out waiting for handshakes ({} established)", established);
+            return 1;
+        }
+    }
+
+    auto elapsed = std::chrono::duration<double>{std::chrono::steady_clock::now() - started_at}.count();
+
+    auto during = ping_net.call_get([&] {
+        p.running = false;
+        p.stream.reset();
+        return std::exchange(p.latencies, {});
+    });
+
+    fmt::print(
+            "{} handshakes ({} in flight, {}µs key verify {}) in {:.3f}s; {:.1f} handshakes/s\n",
+            established,
+            concurrency,
+            verify_us,
+            verify_threads > 0 ? fmt::format("on {} worker thread(s)", verify_threads) : "on the event loop"s,
+            elapsed,
+            established / elapsed);
+    print_latencies("Latency before burst", std::move(baseline));
+    print_latencies("Latency during burst", std::move(during));
+
+    return 0;
+}
@@ -0,0 +1,167 @@
+/*
+    Idle connection memory footprint benchmark
+
+    Establishes a number of connections between a client and a server endpoint, lets them sit idle,
+    and reports the memory held per connection end (i.e. per Connection object; each connection
+    has one on each side).  Two figures are reported: memory allocated through the global operator
+    new, which is everything libquic itself allocates, and (with glibc) the growth of the whole
+    malloc heap, which additionally includes ngtcp2 and GnuTLS state.
+
+    Run with and without --slim to see the effect of opt::idle_slimming.
+*/
+
+#include <CLI/Validators.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <oxen/quic.hpp>
+#include <oxen/quic/gnutls_crypto.hpp>
+#include <thread>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "utils.hpp"
+
+using namespace oxen::quic;
+
+namespace
+{
+    std::atomic<int64_t> live_bytes{0};
+
+    // Every allocation carries a header recording its size, so that frees can be accounted
+    constexpr size_t header_size = alignof(std::max_align_t);
+
+    int64_t heap_bytes()
+    {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+        return mallinfo2().uordblks;
+#else
+        return -1;
+#endif
+    }
+}  // namespace
+
+void* operator new(size_t size)
+{
+    auto* p = static_cast<std::byte*>(std::malloc(size + header_size));
+    if (!p)
+        throw std::bad_alloc{};
+    *reinterpret_cast<size_t*>(p) = size;
+    live_bytes.fetch_add(size, std::memory_order_relaxed);
+    return p + header_size;
+}
+
+void operator delete(void* ptr) noexcept
+{
+    if (!ptr)
+        return;
+    auto* p = static_cast<std::byte*>(ptr) - header_size;
+    live_bytes.fetch_sub(*reinterpret_cast<size_t*>(p), std::memory_order_relaxed);
+    std::free(p);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+int main(int argc, char* argv[])
+{
+    CLI::App cli{"libQUIC idle connection memory footprint benchmark"};
+
+    std::string log_file, log_level;
+    add_log_opts(cli, log_file, log_level);
+
+    size_t n_conns = 1000;
+    cli.add_option("-n,--connections", n_conns, "Number of connections to establish")
+            ->check(CLI::Range(size_t{1}, size_t{1'000'000}))
+            ->capture_default_str();
+
+    double idle = 6.0;
+    cli.add_option("-i,--idle", idle, "How long (in seconds) to leave the connections idle before measuring")
+            ->check(CLI::NonNegativeNumber)
+            ->capture_default_str();
+
+    bool slim = false;
+    cli.add_flag("--slim", slim, "Enable opt::idle_slimming on both endpoints");
+
+    double slim_after = 5.0;
+    cli.add_option("--slim-after", slim_after, "The opt::idle_slimming idle time, in seconds")
+            ->check(CLI::PositiveNumber)
+            ->capture_default_str();
+
+    bool datagrams = false;
+    cli.add_flag("-D,--datagrams", datagrams, "Enable datagrams (with packet splitting) on both endpoints");
+
+    try
+    {
+        cli.parse(argc, argv);
+    }
+    catch (const CLI::ParseError& e)
+    {
+        return cli.exit(e);
+    }
+
+    setup_logging(log_file, log_level);
+
+    Network net{};
+
+    auto [client_tls, server_tls] = defaults::tls_creds_from_ed_keys();
+
+    std::optional<opt::idle_slimming> slimming;
+    if (slim)
+        slimming.emplace(std::chrono::milliseconds{static_cast<int64_t>(slim_after * 1000)});
+    std::optional<opt::enable_datagrams> dgrams;
+    if (datagrams)
+        dgrams.emplace(Splitting::ACTIVE);
+
+    std::atomic<size_t> established{0}, closed{0};
+
+    Address server_local{}, client_local{};
+
+    auto server = net.endpoint(server_local, slimming, dgrams);
+    server->listen(server_tls);
+
+    RemoteAddress server_remote{defaults::SERVER_PUBKEY, "127.0.0.1"s, server->local().port()};
+
+    connection_established_callback on_established = [&](connection_interface&) { ++established; };
+    connection_closed_callback on_closed = [&](connection_interface&, uint64_t) { ++closed; };
+
+    auto client = net.endpoint(client_local, slimming, dgrams, on_established, on_closed);
+
+    // Let everything settle before taking the baseline
+    std::this_thread::sleep_for(100ms);
+    auto base_live = live_bytes.load();
+    auto base_heap = heap_bytes();
+
+    auto started_at = std::chrono::steady_clock::now();
+    std::vector<std::shared_ptr<connection_interface>> conns;
+    conns.reserve(n_conns);
+    for (size_t i = 0; i < n_conns; i++)
+        conns.push_back(client->connect(server_remote, client_tls));
+
+    while (established + closed < n_conns)
+        std::this_thread::sleep_for(10ms);
+
+    fmt::print(
+            "{} connections established in {:.3f}s ({} failed)\n",
+            established.load(),
+            std::chrono::duration<double>{std::chrono::steady_clock::now() - started_at}.count(),
+            closed.load());
+    if (established == 0)
+        return 1;
+
+    fmt::print("Idling for {:.1f}s (idle slimming: {})...\n", idle, slim ? "after {:.1f}s"_format(slim_after) : "off");
+    std::this_thread::sleep_for(std::chrono::duration<double>{idle});
+
+    // Both the client and server side of each connection are included
+    const auto ends = 2 * static_cast<int64_t>(established.load());
+    fmt::print("libquic (operator new) bytes per connection end: {}\n", (live_bytes.load() - base_live) / ends);
+    if (base_heap >= 0)
+        fmt::print("total heap bytes per connection end: {}\n", (heap_bytes() - base_heap) / ends);
+
+    return 0;
+}
@@ -0,0 +1,395 @@
+/*
+    Internal data structure microbenchmarks
+
+    Times the hot-path internals that the end-to-end speedtests exercise only indirectly: stream
+    send buffer bookkeeping, stream object churn, send keep-alives, split datagram reassembly and
+    send queueing, request parsing, receive batch processing, address and connection ID hashing and
+    lookups, and the event loop job queue.  Each benchmark is run once to warm up and then timed; the results are printed
+    one per line as
+
+        <name> <operations> <ns/op> <allocs/op>
+
+    where allocs/op counts calls to the global operator new made by any thread during the timed
+    run.  The benchmark names and the output format are kept stable so that results can be compared
+    across releases.
+
+    The stream, datagram and request parsing benchmarks run through the hot-path trace/debug log
+    statements, so comparing the results of builds with -DLIBQUIC_MAX_LOG_LEVEL=trace and =info
+    shows what compiling those statements out saves.
+*/
+
+#include <CLI/Validators.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+#include <oxen/quic.hpp>
+#include <oxen/quic/gnutls_crypto.hpp>
+#include <thread>
+#include <unordered_map>
+
+#include "utils.hpp"
+
+using namespace oxen::quic;
+
+namespace
+{
+    std::atomic<uint64_t> allocations{0};
+
+    // Results are accumulated here so that the benchmarked work can't be optimized away
+    volatile uint64_t sink = 0;
+
+    class bench_runner
+    {
+        std::string filter;
+        double scale;
+
+      public:
+        bench_runner(std::string filter, double scale) : filter{std::move(filter)}, scale{scale}
+        {
+            fmt::print("{:<40} {:>12} {:>12} {:>10}\n", "benchmark", "ops", "ns/op", "allocs/op");
+        }
+
+        // `f(n)` must perform `n` operations of the benchmark, and must be repeatable
+        template <typename Callable>
+        void run(std::string_view name, uint64_t ops, Callable&& f)
+        {
+            if (!filter.empty() && name.find(filter) == std::string_view::npos)
+                return;
+
+            ops = std::max<uint64_t>(1, ops * scale);
+            f(std::max<uint64_t>(1, ops / 10));
+
+            auto allocs_before = allocations.load();
+            auto started_at = std::chrono::steady_clock::now();
+            f(ops);
+            auto elapsed = std::chrono::steady_clock::now() - started_at;
+            auto allocs = allocations.load() - allocs_before;
+
+            fmt::print(
+                    "{:<40} {:>12} {:>12.1f} {:>10.2f}\n",
+                    name,
+                    ops,
+                    std::chrono::duration<double, std::nano>{elapsed}.count() / ops,
+                    static_cast<double>(allocs) / ops);
+        }
+    };
+}  // namespace
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept
+{
+    std::free(p);
+}
+
+int main(int argc, char* argv[])
+{
+    CLI::App cli{"libQUIC internal data structure microbenchmarks"};
+
+    std::string log_file, log_level;
+    add_log_opts(cli, log_file, log_level);
+
+    std::string filter;
+    cli.add_option("-f,--filter", filter, "Only run the benchmarks whose name contains this string");
+
+    double scale = 1.0;
+    cli.add_option("-s,--scale", scale, "Multiplier applied to the number of operations of every benchmark")
+            ->check(CLI::PositiveNumber)
+            ->capture_default_str();
+
+    try
+    {
+        cli.parse(argc, argv);
+    }
+    catch (const CLI::ParseError& e)
+    {
+        return cli.exit(e);
+    }
+
+    setup_logging(log_file, log_level);
+
+    // A real connection, for the benchmarks of per-connection internals
+    Network net{};
+
+    auto [client_seed, client_pubkey] = generate_ed25519();
+    auto [server_seed, server_pubkey] = generate_ed25519();
+    auto client_tls = GNUTLSCreds::make_from_ed_keys(client_seed, client_pubkey);
+    auto server_tls = GNUTLSCreds::make_from_ed_keys(server_seed, server_pubkey);
+
+    Address server_local{}, client_local{};
+
+    auto client_established = callback_waiter{[](connection_interface&) {}};
+
+    auto server = net.endpoint(server_local, opt::enable_datagrams{Splitting::ACTIVE});
+    server->listen(server_tls);
+
+    RemoteAddress server_remote{server_pubkey, "127.0.0.1"s, server->local().port()};
+
+    auto client = net.endpoint(client_local, client_established, opt::enable_datagrams{Splitting::ACTIVE});
+    auto conn = client->connect(server_remote, client_tls);
+
+    if (!client_established.wait())
+    {
+        log::critical(test_cat, "Failed to establish connection");
+        return 1;
+    }
+
+    auto stream = conn->open_stream();
+    auto bp = conn->open_stream<BTRequestStream>();
+
+    // Only touched from inside the event loop
+    uint64_t handled = 0;
+    bp->register_handler("bench", [&](message) { ++handled; });
+
+    bench_runner bench{filter, scale};
+
+    // Stream send buffers: each op is one `pending()` call over the given number of buffers, plus
+    // writing and acknowledging the first of them and appending a replacement.
+    const bstring chunk(1200, std::byte{'x'});
+    for (size_t nbufs : {size_t{16}, size_t{256}})
+    {
+        bench.run("stream pending+ack ({} bufs)"_format(nbufs), 16'000'000 / nbufs, [&](uint64_t n) {
+            client->call_get([&] {
+                for (size_t i = 0; i < nbufs; i++)
+                    TestHelper::stream_buffer_data(*stream, chunk);
+                for (uint64_t i = 0; i < n; i++)
+                {
+                    auto vecs = TestHelper::stream_pending(*stream);
+                    TestHelper::stream_wrote(*stream, vecs.front().len);
+                    TestHelper::stream_acknowledge(*stream, vecs.front().len);
+                    TestHelper::stream_buffer_data(*stream, chunk);
+                }
+                auto rest = TestHelper::stream_buffered(*stream);
+                TestHelper::stream_wrote(*stream, rest);
+                TestHelper::stream_acknowledge(*stream, rest);
+            });
+        });
+    }
+
+    // Stream churn, as seen with one request per stream: each op creates a stream object, queues
+    // one buffer on it, acknowledges it, and destroys the stream.
+    auto* client_conn = TestHelper::get_conn(client, conn);
+    bench.run("stream create+send+destroy", 2'000'000, [&](uint64_t n) {
+        client->call_get([&] {
+            for (uint64_t i = 0; i < n; i++)
+            {
+                auto s = client->make_shared<Stream>(*client_conn, *client);
+                TestHelper::stream_buffer_data(*s, chunk);
+                TestHelper::stream_wrote(*s, chunk.size());
+                TestHelper::stream_acknowledge(*s, chunk.size());
+            }
+        });
+    });
+
+    // Send keep-alives: each op moves a freshly built 64-byte bstring into a keep-alive, as the
+    // `send(bstring&&)` convenience overloads do, and then drops it.
+    const bstring small(64, std::byte{'k'});
+    bench.run("keep-alive make (std::shared_ptr)", 5'000'000, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++)
+        {
+            std::shared_ptr<void> ka = std::make_shared<bstring>(small);
+            sink = sink + static_cast<bstring*>(ka.get())->size();
+        }
+    });
+    bench.run("keep-alive make (shared_buffer)", 5'000'000, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++)
+        {
+            auto ka = shared_buffer::make<bstring>(stream->buffer_pool(), small);
+            sink = sink + ka.view().size();
+        }
+    });
+
+    // Stream sends of owned data: each op sends a 64-byte bstring through `send(bstring&&)` on a
+    // (not yet ready) stream, and acknowledges it.
+    bench.run("stream send+ack (owned bstring)", 2'000'000, [&](uint64_t n) {
+        client->call_get([&] {
+            auto s = client->make_shared<Stream>(*client_conn, *client);
+            for (uint64_t i = 0; i < n; i++)
+            {
+                s->send(bstring{small});
+                TestHelper::stream_wrote(*s, small.size());
+                TestHelper::stream_acknowledge(*s, small.size());
+            }
+        });
+    });
+
+    // Split datagrams: each op rejoins one datagram from its two halves
+    const bstring half(600, std::byte{'d'});
+    uint16_t next_dgid = 0;
+    bench.run("rotating_buffer receive (split pair)", 2'000'000, [&](uint64_t n) {
+        client->call_get([&] {
+            for (uint64_t i = 0; i < n; i++)
+            {
+                auto id = static_cast<uint16_t>(next_dgid++ << 2);
+                TestHelper::datagram_receive_split(*conn, half, id | 2);
+                if (auto whole = TestHelper::datagram_receive_split(*conn, half, id | 3))
+                    sink = sink + whole->size();
+            }
+        });
+    });
+
+    // Datagram send queue: each op queues one datagram behind 64 others, and prepares and drops the
+    // one at the front
+    buffer_que que;
+    bench.run("buffer_que prepare (64 queued)", 5'000'000, [&](uint64_t n) {
+        for (uint16_t i = 0; i < 64; i++)
+            que.emplace(half, i << 2, shared_buffer{}, dgram::STANDARD);
+        for (uint64_t i = 0; i < n; i++)
+        {
+            que.emplace(half, static_cast<uint16_t>(i << 2), shared_buffer{}, dgram::STANDARD);
+            auto d = que.prepare(false, 1);
+            sink = sink + d.bufs_len;
+            que.drop_front(false);
+        }
+        while (!que.empty())
+            que.drop_front(false);
+    });
+
+    // BTRequestStream parsing: each op is one complete 64-byte-body request, received on its own
+    std::string encoded;
+    std::vector<std::pair<size_t, size_t>> requests;
+    for (int i = 0; i < 1000; i++)
+    {
+        std::string list = "l1:Ci{}e5:bench64:{}e"_format(i, std::string(64, 'z'));
+        std::string req = "{}:{}"_format(list.size(), list);
+        requests.emplace_back(encoded.size(), req.size());
+        encoded += req;
+    }
+    bench.run("BTRequestStream process_incoming", 1'000'000, [&](uint64_t n) {
+        auto data = convert_sv<std::byte>(std::string_view{encoded});
+        client->call_get([&] {
+            for (uint64_t i = 0; i < n; i++)
+            {
+                auto [offset, size] = requests[i % requests.size()];
+                TestHelper::bparser_receive(*bp, data.substr(offset, size));
+            }
+        });
+    });
+    if (client->call_get([&] { return handled; }) == 0)
+        log::warning(test_cat, "BTRequestStream benchmark handled no requests!");
+
+    // Receive batches: each op feeds one batch of packets (duplicates, after the first run) of a
+    // single connection into an endpoint, as a recvmmsg batch from its socket would be, including
+    // the one flush of the connection at the end of the batch.  The packets come from a second,
+    // manually routed connection whose client keeps a copy of everything it sends.
+    bool rx_capture = false;  // Only touched from inside the event loop
+    std::vector<std::pair<Path, bstring>> rx_captured;
+    std::shared_ptr<Endpoint> rx_server, rx_client;
+
+    opt::manual_routing rx_client_sender{[&](const Path& p, bstring_view d) {
+        if (rx_capture)
+            rx_captured.emplace_back(p.invert(), d);
+        rx_server->manually_receive_packet(Packet{p.invert(), d});
+    }};
+    opt::manual_routing rx_server_sender{[&](const Path& p, bstring_view d) {
+        rx_client->manually_receive_packet(Packet{p.invert(), d});
+    }};
+
+    Address rx_server_local{}, rx_client_local{};
+    auto rx_established = callback_waiter{[](connection_interface&) {}};
+
+    rx_server = net.endpoint(rx_server_local, rx_server_sender);
+    rx_server->listen(server_tls);
+    rx_client = net.endpoint(rx_client_local, rx_client_sender, rx_established);
+    auto rx_conn = rx_client->connect(RemoteAddress{server_pubkey, rx_server_local}, client_tls);
+
+    if (!rx_established.wait())
+    {
+        log::critical(test_cat, "Failed to establish manually routed connection");
+        return 1;
+    }
+
+    rx_client->call_get([&] { rx_capture = true; });
+    auto rx_stream = rx_conn->open_stream();
+    rx_stream->send(bstring(32'000, std::byte{'r'}));
+    for (int i = 0; i < 100 && rx_client->call_get([&] { return rx_captured.size(); }) < 16; i++)
+        std::this_thread::sleep_for(10ms);
+    rx_client->call_get([&] { rx_capture = false; });
+
+    for (size_t npkts : {size_t{1}, size_t{16}})
+    {
+        std::vector<Packet> batch;
+        for (size_t i = 0; i < npkts && i < rx_captured.size(); i++)
+            batch.emplace_back(rx_captured[i].first, bstring_view{rx_captured[i].second});
+        if (batch.size() < npkts)
+            log::warning(test_cat, "Only captured {} packets for the receive batch benchmark", batch.size());
+
+        bench.run("receive batch ({} pkts)"_format(npkts), 2'000'000 / npkts, [&](uint64_t n) {
+            rx_server->call_get([&] {
+                for (uint64_t i = 0; i < n; i++)
+                    sink = sink + TestHelper::receive_batch(*rx_server, batch);
+            });
+        });
+    }
+
+    // Address and Path hashing
+    std::vector<Address> addrs;
+    std::vector<Path> paths;
+    for (int i = 0; i < 1024; i++)
+    {
+        addrs.emplace_back(i % 2 ? "10.{}.{}.1"_format(i / 256, i % 256) : "fd00::{:x}"_format(i), 1000 + i);
+        if (i > 0)
+            paths.emplace_back(addrs[i - 1], addrs[i]);
+    }
+    bench.run("Address hash", 20'000'000, [&](uint64_t n) {
+        std::hash<Address> h;
+        for (uint64_t i = 0; i < n; i++)
+            sink = sink + h(addrs[i % addrs.size()]);
+    });
+    bench.run("Path hash", 20'000'000, [&](uint64_t n) {
+        std::hash<Path> h;
+        for (uint64_t i = 0; i < n; i++)
+            sink = sink + h(paths[i % paths.size()]);
+    });
+
+    // Connection ID lookups, in a map like Endpoint's with 10k connection IDs
+    std::unordered_map<quic_cid, ConnectionID> conn_lookup;
+    std::vector<quic_cid> present, absent;
+    for (uint64_t i = 0; i < 10'000; i++)
+    {
+        auto& cid = present.emplace_back(quic_cid::random());
+        conn_lookup.emplace(cid, ConnectionID{i});
+        absent.push_back(quic_cid::random());
+    }
+    bench.run("conn_lookup find (hit)", 20'000'000, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++)
+            if (auto it = conn_lookup.find(present[i % present.size()]); it != conn_lookup.end())
+                sink = sink + it->second.id;
+    });
+    bench.run("conn_lookup find (miss)", 20'000'000, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; i++)
+            sink = sink + conn_lookup.count(absent[i % absent.size()]);
+    });
+
+    // Event loop job queue: each op is one job, queued from outside of the loop or from within it
+    auto loop = std::make_shared<Loop>();
+    bench.run("Loop call_soon (from another thread)", 2'000'000, [&](uint64_t n) {
+        uint64_t count = 0;
+        for (uint64_t i = 0; i < n; i++)
+            loop->call_soon([&count] { ++count; });
+        // Jobs run in order, so all of the above are done once this returns
+        sink = sink + loop->call_get([&count] { return count; });
+    });
+    bench.run("Loop call_soon (from the loop)", 2'000'000, [&](uint64_t n) {
+        uint64_t count = 0;
+        loop->call_get([&] {
+            for (uint64_t i = 0; i < n; i++)
+                loop->call_soon([&count] { ++count; });
+        });
+        sink = sink + loop->call_get([&count] { return count; });
+    });
+
+    return 0;
+}
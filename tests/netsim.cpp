@@ -0,0 +1,152 @@
+#include "netsim.hpp"
+
+#include <algorithm>
+#include <map>
+#include <random>
+
+#include "utils.hpp"
+
+namespace oxen::quic
+{
+    struct NetworkSimulator::state
+    {
+        struct link
+        {
+            link_config config;
+            // When the link finishes transmitting the packets already queued for it
+            std::chrono::steady_clock::time_point busy_until{};
+            link_stats stats;
+        };
+
+        std::mt19937_64 rng;
+        link_config default_link;
+        std::map<Address, std::weak_ptr<Endpoint>> endpoints;
+        std::map<std::pair<Address, Address>, link> links;
+
+        explicit state(uint64_t seed) : rng{seed} {}
+
+        link& get_link(const Address& from, const Address& to)
+        {
+            auto [it, inserted] = links.try_emplace({from, to});
+            if (inserted)
+                it->second.config = default_link;
+            return it->second;
+        }
+
+        bool chance(double p) { return p > 0 && std::uniform_real_distribution<double>{}(rng) < p; }
+    };
+
+    NetworkSimulator::NetworkSimulator(Network& net, uint64_t seed) :
+            net{net}, _state{std::make_shared<state>(seed)}
+    {}
+
+    void NetworkSimulator::add_endpoint(const std::shared_ptr<Endpoint>& ep)
+    {
+        net.call_get([&] {
+            auto [it, inserted] = _state->endpoints.emplace(ep->local(), ep);
+            if (!inserted)
+                throw std::invalid_argument{"NetworkSimulator already has an endpoint at {}"_format(ep->local())};
+        });
+    }
+
+    void NetworkSimulator::set_default_link(link_config config)
+    {
+        net.call_get([&] { _state->default_link = std::move(config); });
+    }
+
+    void NetworkSimulator::set_link(const Address& from, const Address& to, link_config config)
+    {
+        net.call_get([&] { _state->get_link(from, to).config = std::move(config); });
+    }
+
+    void NetworkSimulator::set_links(const Address& a, const Address& b, const link_config& config)
+    {
+        set_link(a, b, config);
+        set_link(b, a, config);
+    }
+
+    link_stats NetworkSimulator::get_stats(const Address& from, const Address& to)
+    {
+        return net.call_get([&] { return _state->get_link(from, to).stats; });
+    }
+
+    opt::manual_routing NetworkSimulator::make_router()
+    {
+        // Invoked in the event loop by the sending endpoint
+        opt::manual_routing::batch_send_handler_t send =
+                [&net = net, st = _state](
+                        const Path& path, const std::byte* bufs, const size_t* bufsize, uint8_t ecn, size_t n_pkts) {
+                    auto& l = st->get_link(path.local, path.remote);
+                    auto& cfg = l.config;
+                    auto now = std::chrono::steady_clock::now();
+
+                    for (size_t i = 0; i < n_pkts; bufs += bufsize[i++])
+                    {
+                        auto size = bufsize[i];
+                        l.stats.sent++;
+
+                        if (cfg.mtu && size > cfg.mtu)
+                        {
+                            l.stats.too_big++;
+                            continue;
+                        }
+                        if (st->chance(cfg.loss))
+                        {
+                            l.stats.lost++;
+                            continue;
+                        }
+
+                        auto arrival = now;
+                        if (cfg.bandwidth)
+                        {
+                            auto start = std::max(now, l.busy_until);
+                            if (cfg.queue_limit &&
+                                std::chrono::duration<double>{start - now}.count() * cfg.bandwidth > cfg.queue_limit)
+                            {
+                                l.stats.queue_dropped++;
+                                continue;
+                            }
+                            l.busy_until = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                           std::chrono::duration<double>{double(size) / cfg.bandwidth});
+                            arrival = l.busy_until;
+                        }
+
+                        if (!st->chance(cfg.reorder))
+                        {
+                            arrival += cfg.latency;
+                            if (cfg.jitter > 0us)
+                                arrival += std::chrono::microseconds{std::uniform_int_distribution<int64_t>{
+                                        0, cfg.jitter.count()}(st->rng)};
+                        }
+
+                        Packet pkt{path.invert(), bstring{bufs, size}};
+                        pkt.pkt_info.ecn = ecn;
+
+                        auto deliver = [st, pkt = std::move(pkt)]() mutable {
+                            auto& dest = pkt.path.local;
+                            auto it = st->endpoints.find(dest);
+                            auto ep = it != st->endpoints.end() ? it->second.lock() : nullptr;
+                            if (!ep)
+                            {
+                                log::trace(test_cat, "NetworkSimulator: no endpoint at {}; dropping packet", dest);
+                                return;
+                            }
+                            auto& stats = st->get_link(pkt.path.remote, dest).stats;
+                            stats.delivered++;
+                            stats.bytes_delivered += pkt.data().size();
+                            ep->manually_receive_packet(std::move(pkt));
+                        };
+
+                        auto delay = std::chrono::ceil<std::chrono::microseconds>(arrival - now);
+                        if (delay > 0us)
+                            net.call_later(delay, std::move(deliver));
+                        else
+                            net.call_soon(std::move(deliver));
+                    }
+
+                    return std::pair{io_result{}, n_pkts};
+                };
+
+        return opt::manual_routing{std::move(send)};
+    }
+}  // namespace oxen::quic
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <oxen/quic.hpp>
+
+#include <chrono>
+#include <memory>
+
+namespace oxen::quic
+{
+    /// Properties of one direction of a simulated link between two addresses.
+    struct link_config
+    {
+        // Link rate in bytes per second; packets queue for the link while it is busy.  0 means
+        // unlimited.
+        uint64_t bandwidth{0};
+        // One-way propagation delay
+        std::chrono::microseconds latency{0};
+        // Additional per-packet delay, uniformly distributed between 0 and this (which, as with
+        // netem, reorders packets sent less than `jitter` apart)
+        std::chrono::microseconds jitter{0};
+        // Probability of dropping each packet
+        double loss{0};
+        // Probability of a packet skipping the propagation delay, overtaking the packets before it
+        double reorder{0};
+        // Largest UDP payload the link carries; larger packets are dropped.  0 means unlimited.
+        size_t mtu{0};
+        // Maximum number of bytes queued waiting for a bandwidth-limited link; packets that would
+        // exceed it are dropped.  0 means unlimited.
+        size_t queue_limit{0};
+    };
+
+    struct link_stats
+    {
+        uint64_t sent{0};
+        uint64_t delivered{0};
+        uint64_t bytes_delivered{0};
+        uint64_t lost{0};
+        uint64_t too_big{0};
+        uint64_t queue_dropped{0};
+    };
+
+    /// In-process network connecting Endpoints through opt::manual_routing rather than UDP sockets,
+    /// with configurable per-direction link properties.  Loss, jitter and reordering decisions come
+    /// from a seeded generator, so a given sequence of packets always meets the same fate.
+    ///
+    /// Packets are delivered (via Endpoint::manually_receive_packet) from the Network's event loop
+    /// after the simulated delay, so the endpoints experience it in real time; all of the
+    /// simulator's endpoints must therefore belong to the Network it was given.  Packets to an
+    /// address without a simulator endpoint are dropped.
+    class NetworkSimulator
+    {
+      public:
+        explicit NetworkSimulator(Network& net, uint64_t seed = 1);
+
+        /// Creates an endpoint at `local`, which must be a specific (non-any) address unique within
+        /// the simulator, routed through the simulator.  Other endpoint options are passed through.
+        template <typename... Opt>
+        std::shared_ptr<Endpoint> endpoint(const Address& local, Opt&&... opts)
+        {
+            auto ep = net.endpoint(local, make_router(), std::forward<Opt>(opts)...);
+            add_endpoint(ep);
+            return ep;
+        }
+
+        /// Sets the link properties used for every direction not configured with set_link
+        void set_default_link(link_config config);
+
+        /// Sets the link properties for packets from `from` to `to`
+        void set_link(const Address& from, const Address& to, link_config config);
+
+        /// Sets the link properties for both directions between `a` and `b`
+        void set_links(const Address& a, const Address& b, const link_config& config);
+
+        link_stats get_stats(const Address& from, const Address& to);
+
+      private:
+        struct state;
+
+        Network& net;
+        std::shared_ptr<state> _state;
+
+        opt::manual_routing make_router();
+        void add_endpoint(const std::shared_ptr<Endpoint>& ep);
+    };
+}  // namespace oxen::quic
@@ -1,6 +1,7 @@
 #include "utils.hpp"
 
 #include <nettle/eddsa.h>
+#include <oxen/quic/datagram.hpp>
 
 namespace oxen::quic
 {
@@ -112,6 +113,79 @@ namespace oxen::quic
         ep._next_rid += by;
     }
 
+    void TestHelper::bparser_receive(BTRequestStream& s, bstring_view data)
+    {
+        s.endpoint.call_get([&s, data] { s.receive(data); });
+    }
+
+    size_t TestHelper::stream_buffered(Stream& s)
+    {
+        assert(s.endpoint.in_event_loop());
+        return s.size();
+    }
+
+    void TestHelper::stream_buffer_data(Stream& s, bstring_view data)
+    {
+        assert(s.endpoint.in_event_loop());
+        s.user_buffers.emplace_back(data, shared_buffer{});
+    }
+
+    std::vector<ngtcp2_vec> TestHelper::stream_pending(Stream& s)
+    {
+        return s.pending();
+    }
+
+    void TestHelper::stream_wrote(Stream& s, size_t bytes)
+    {
+        s.wrote(bytes);
+    }
+
+    void TestHelper::stream_acknowledge(Stream& s, size_t bytes)
+    {
+        s.acknowledge(bytes);
+    }
+
+    std::optional<bstring> TestHelper::datagram_receive_split(connection_interface& ci, bstring_view data, uint16_t dgid)
+    {
+        auto& conn = static_cast<Connection&>(ci);
+        assert(conn._endpoint.in_event_loop() && conn.datagrams);
+        return conn.datagrams->to_buffer(data, dgid);
+    }
+
+    bool TestHelper::send_buffer_allocated(connection_interface& ci)
+    {
+        auto& conn = static_cast<Connection&>(ci);
+        assert(conn._endpoint.in_event_loop());
+        return conn.send_buffer != nullptr;
+    }
+
+    bool TestHelper::datagram_buffer_allocated(connection_interface& ci)
+    {
+        auto& conn = static_cast<Connection&>(ci);
+        assert(conn._endpoint.in_event_loop());
+        return conn.datagrams && !conn.datagrams->recv_buffer.buf[0].empty();
+    }
+
+    size_t TestHelper::receive_batch(Endpoint& ep, const std::vector<Packet>& pkts, std::function<void()> mid_batch)
+    {
+        return ep.call_get([&] {
+            for (size_t i = 0; i < pkts.size(); i++)
+            {
+                ep.handle_socket_packet(Packet{pkts[i]});
+                if (i == 0 && mid_batch)
+                    mid_batch();
+            }
+            return ep.finish_rx_batch();
+        });
+    }
+
+    void TestHelper::close_connection_now(connection_interface& ci)
+    {
+        auto& conn = static_cast<Connection&>(ci);
+        assert(conn._endpoint.in_event_loop());
+        conn._endpoint._close_connection(conn, io_error{uint64_t{0}}, "closed by test");
+    }
+
     std::pair<std::shared_ptr<GNUTLSCreds>, std::shared_ptr<GNUTLSCreds>> test::defaults::tls_creds_from_ed_keys()
     {
         auto client = GNUTLSCreds::make_from_ed_keys(CLIENT_SEED, CLIENT_PUBKEY);
@@ -8,6 +8,7 @@
 #include <optional>
 #include <oxen/log.hpp>
 #include <oxen/log/format.hpp>
+#include <oxen/quic/btstream.hpp>
 #include <oxen/quic/endpoint.hpp>
 #include <oxen/quic/format.hpp>
 #include <oxen/quic/gnutls_crypto.hpp>
@@ -54,6 +55,46 @@ namespace oxen::quic
         static void increment_ref_id(Endpoint& ep, uint64_t by = 1);
 
         static Connection* get_conn(std::shared_ptr<Endpoint>& ep, std::shared_ptr<connection_interface>& conn);
+
+        // Feeds `data` into the stream's incoming request parser (from within the event loop) as if
+        // it had just been received from the remote.
+        static void bparser_receive(BTRequestStream& s, bstring_view data);
+
+        // Returns the number of bytes sent on the stream that have not been acknowledged yet.  Must
+        // be called from within the event loop.
+        static size_t stream_buffered(Stream& s);
+
+        // Direct access to a stream's send buffer bookkeeping, for microbenchmarking it.  These must
+        // be called from within the event loop, and bypass the connection entirely: the data added
+        // with `stream_buffer_data` is never actually sent, so it must all be acknowledged again
+        // (via `stream_wrote` and `stream_acknowledge`) before leaving the event loop.
+        static void stream_buffer_data(Stream& s, bstring_view data);
+        static std::vector<ngtcp2_vec> stream_pending(Stream& s);
+        static void stream_wrote(Stream& s, size_t bytes);
+        static void stream_acknowledge(Stream& s, size_t bytes);
+
+        // Hands one half of a split datagram to the connection's split datagram receive buffer,
+        // returning the rejoined datagram if this completes one.  The connection must have been
+        // created with split datagrams enabled.  Must be called from within the event loop.
+        static std::optional<bstring> datagram_receive_split(connection_interface& conn, bstring_view data, uint16_t dgid);
+
+        // Returns whether the connection currently has its packet send buffer allocated (see
+        // opt::idle_slimming).  Must be called from within the event loop.
+        static bool send_buffer_allocated(connection_interface& conn);
+
+        // Returns whether the connection currently has the rows of its split datagram reassembly
+        // buffer allocated (see opt::idle_slimming).  Must be called from within the event loop.
+        static bool datagram_buffer_allocated(connection_interface& conn);
+
+        // Feeds `pkts` into the endpoint (from within the event loop) as one batch of packets
+        // received on its socket, and returns the number of connections flushed at the end of the
+        // batch.  If given, `mid_batch` is called once the first packet has been processed.
+        static size_t receive_batch(
+                Endpoint& ep, const std::vector<Packet>& pkts, std::function<void()> mid_batch = nullptr);
+
+        // Closes the connection right away, rather than from the next event loop iteration as
+        // close_connection() does.  Must be called from within the event loop.
+        static void close_connection_now(connection_interface& conn);
     };
 
     namespace test::defaults